@@ -0,0 +1,21 @@
+#version 150
+
+// Refer to the lambert shader files for useful comments.
+// Transforms the terrain exactly as lambert.vert.glsl and
+// hexbounds.vert.glsl do and nothing else, for the depth pre-pass.
+// gl_Position is invariant in all three, so the shading pass lands on
+// the very depths written here.
+
+in vec4 vs_Pos;
+in vec3 vs_ChunkOrigin;     // Where the Chunk being drawn sits; zero for anything else
+
+uniform mat4 u_Model;
+#include "frameuniforms.glsl"
+
+invariant gl_Position;
+
+void main()
+{
+    vec4 modelposition = u_Model * (vs_Pos + vec4(vs_ChunkOrigin, 0));
+    gl_Position = u_ViewProj * modelposition;
+}
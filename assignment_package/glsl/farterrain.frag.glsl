@@ -0,0 +1,55 @@
+#version 330
+
+#include "frameuniforms.glsl"
+uniform vec4 u_NearBounds;  // (min x, min z, max x, max z) of the loaded Chunks
+uniform vec2 u_FarFade;     // The band inside u_NearBounds over which the far terrain fades in,
+                            // and the distance by which it has faded into the sky
+
+in vec4 fs_Pos;
+in vec4 fs_Nor;
+in vec4 fs_Col;
+
+layout(location = 0) out vec4 out_Col;
+layout(location = 1) out vec4 out_HexMask;
+
+const vec4 lightDir = normalize(vec4(0.5, 1, 0.75, 0)); // Matches lambert.vert.glsl
+const vec3 skyColor = vec3(0.37, 0.74, 1.0);             // Matches MyGL's clear color
+
+// A 4x4 ordered dither threshold in (0, 1)
+float bayer4(vec2 p)
+{
+    ivec2 i = ivec2(mod(p, 4.0));
+    int index = i.x + 4 * i.y;
+    const float m[16] = float[](0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5);
+    return (m[index] + 0.5) / 16.0;
+}
+
+float sdfHex(vec2 p, float s)
+{
+    const vec3 k = vec3(-0.866025404,0.5,0.577350269);
+    p = abs(p);
+    p -= 2.0*min(dot(k.xy,p),0.0)*k.xy;
+    p -= vec2(clamp(p.x, -k.z*s, k.z*s), s);
+    return length(p)*sign(p.y);
+}
+
+void main()
+{
+    // Fade in across the outer band of the loaded area, under the real Chunks
+    vec2 inside = min(fs_Pos.xz - u_NearBounds.xy, u_NearBounds.zw - fs_Pos.xz);
+    float coverage = 1.0 - clamp(min(inside.x, inside.y) / u_FarFade.x, 0.0, 1.0);
+    if (coverage <= bayer4(gl_FragCoord.xy)) {
+        discard;
+    }
+
+    float diffuseTerm = clamp(dot(normalize(fs_Nor), lightDir), 0, 1);
+    vec3 color = fs_Col.rgb * (diffuseTerm + 0.2);
+
+    // Fade out into the sky toward the edge of the far terrain
+    float dist = length(fs_Pos.xz - u_Camera.xz);
+    float fog = smoothstep(0.6 * u_FarFade.y, u_FarFade.y, dist);
+    out_Col = vec4(mix(color, skyColor, fog), 1);
+
+    float hex = sdfHex(u_HexCenter - fs_Pos.xz, u_HexRadius * cos(radians(30.f)));
+    out_HexMask = vec4(vec3(step(0, hex)), 1.0);
+}
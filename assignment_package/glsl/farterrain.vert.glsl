@@ -0,0 +1,25 @@
+#version 150
+
+// Draws the coarse heightmap tiles of FarTerrain. Each vertex carries its
+// biome's colour rather than texture coordinates.
+
+uniform mat4 u_Model;
+#include "frameuniforms.glsl"
+
+in vec4 vs_Pos;
+in vec4 vs_Nor;
+in vec4 vs_Col;
+in vec3 vs_ChunkOrigin;     // The lower-left corner of the tile being drawn
+
+out vec4 fs_Pos;
+out vec4 fs_Nor;
+out vec4 fs_Col;
+
+void main()
+{
+    fs_Pos = u_Model * (vs_Pos + vec4(vs_ChunkOrigin, 0));
+    fs_Nor = vs_Nor;
+    fs_Col = vs_Col;
+
+    gl_Position = u_ViewProj * fs_Pos;
+}
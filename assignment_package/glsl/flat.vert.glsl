@@ -4,7 +4,7 @@
 // Refer to the lambert shader files for useful comments
 
 uniform mat4 u_Model;
-uniform mat4 u_ViewProj;
+#include "frameuniforms.glsl"
 
 in vec4 vs_Pos;
 in vec4 vs_Col;
@@ -0,0 +1,15 @@
+// The state every shader shares within a frame. MyGL fills it once a
+// frame, in one uniform buffer (see FrameUniforms), rather than setting
+// each uniform on each program. Pulled into a shader with
+//     #include "frameuniforms.glsl"
+// which ShaderProgram expands. Must match FrameUniforms::Data.
+layout(std140) uniform FrameUniforms {
+    mat4 u_ViewProj;        // The camera's view-projection
+    mat4 u_CascadeMVP[3];   // The light's view-projection for each shadow cascade, nearest first
+    vec3 u_Camera;          // The camera's position in world space
+    float u_Time;           // Seconds since the game started, for animation
+    vec2 u_HexCenter;       // The hex's center as (x, z)
+    float u_HexRadius;
+    int u_CascadeCount;     // How many shadow cascades are in use; 0 means no shadows
+    ivec2 u_Dimensions;     // The size of the frame buffer the terrain is drawn to
+};
@@ -0,0 +1,24 @@
+// Timeline effect: the dystopian timeline's channel-split glitch outside
+// the hex. Spliced into a post-processing shader by PostProcessComposer,
+// which declares u_Hexture, u_Time and sceneColor(). Reads the scene
+// around fs_UV, not just at it.
+
+vec4 applyTimeline(vec2 fs_UV)
+{
+    float time = u_Time * 1.5f;
+    time *= 2;
+
+    vec4 orig_col = sceneColor(fs_UV);
+    vec4 hex_col = texture(u_Hexture, fs_UV);
+
+    float amountx = fract(sin(time)) *step(0.9,smoothstep(0.5,0.9,sin(time))) * 0.01;
+    float amounty = fract(sin(time + 1.f)) *step(0.9,smoothstep(0.5,0.9,sin(time + 1.f))) * 0.03;
+    vec4 col;
+    col.r = sceneColor( vec2(fs_UV.x + amountx,fs_UV.y - amounty) ).r;
+    col.g = orig_col.g;
+    col.b = sceneColor( vec2(fs_UV.x - amountx,fs_UV.y + amounty) ).b;
+    col *= (1.0 - amountx * 0.5);
+    col.a = orig_col.a;
+
+    return mix(col, orig_col, hex_col.r);
+}
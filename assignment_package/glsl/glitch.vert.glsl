@@ -3,21 +3,18 @@
 
 uniform mat4 u_Model;
 uniform mat4 u_ModelInvTr;
-uniform mat4 u_ViewProj;
-uniform float u_Time;
-uniform vec2 u_HexCenter;
-uniform float u_HexRadius;
-uniform mat4 u_DepthMVP;      // MVP transformation matrix from light's POV
+#include "frameuniforms.glsl"
 
 in vec4 vs_Pos;
 in vec4 vs_Nor;
 in vec4 vs_Col;
+in vec3 vs_ChunkOrigin;    // Where the Chunk being drawn sits; zero for anything else
 
+out vec4 fs_Pos;
 out vec4 fs_Nor;
 out vec4 fs_LightVec;
 out vec4 fs_Col;
 const vec4 lightDir = normalize(vec4(0.5, 1, 0.75, 0));
-out vec4 fs_LightDepth;
 
 float sdfHex(vec2 p, float s)
 {
@@ -35,7 +32,8 @@ void main()
     mat3 invTranspose = mat3(u_ModelInvTr);
     fs_Nor = vec4(invTranspose * vec3(vs_Nor), 0);
 
-    vec4 modelposition = u_Model * vs_Pos;
+    vec4 modelposition = u_Model * (vs_Pos + vec4(vs_ChunkOrigin, 0));
+    fs_Pos = modelposition; // undisplaced, so the hex mask doesn't jitter with the glitch
     float dist  = sdfHex(u_HexCenter - modelposition.xz, u_HexRadius * cos(radians(30.f)));
     float noise =  sin(u_Time * 35.f + modelposition.x) * fract(sin(modelposition.y)) / clamp(mod(modelposition.x, 3), 2, 10);
     int factor = int(clamp(mod(modelposition.z, 3), 0, 2));
@@ -45,8 +43,6 @@ void main()
 
     fs_LightVec = (lightDir);  // Compute the direction in which the light source lies
 
-    fs_LightDepth = u_DepthMVP * vec4(vec3(modelposition), 1);
-
     gl_Position = u_ViewProj * modelposition;// gl_Position is a built-in variable of OpenGL which is
                                              // used to render the final positions of the geometry's vertices
 
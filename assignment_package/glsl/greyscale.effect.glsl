@@ -0,0 +1,12 @@
+// Timeline effect: the 60s, in black and white outside the hex.
+// Spliced into a post-processing shader by PostProcessComposer, which
+// declares u_Hexture and sceneColor(). Only reads the scene at fs_UV.
+
+vec4 applyTimeline(vec2 fs_UV)
+{
+    vec4 orig_col = sceneColor(fs_UV);
+    vec4 hex_col = texture(u_Hexture, fs_UV);
+    float grey = 0.21 * orig_col.r + 0.72 * orig_col.g + 0.07 * orig_col.b;
+    vec4 grey_col = vec4(vec3(grey), orig_col.a);
+    return mix(grey_col, orig_col, hex_col.r);
+}
@@ -3,12 +3,11 @@
 in vec4 vs_Pos;
 in vec4 vs_Col;
 in vec4 vs_Nor;
+in vec3 vs_ChunkOrigin;    // Where the Chunk being drawn sits; zero for anything else
 
 uniform mat4 u_Model;
 uniform mat4 u_ModelInvTr;
-uniform  mat4 u_ViewProj;
-uniform vec2 u_HexCenter;
-uniform float u_HexRadius;
+#include "frameuniforms.glsl"
 
 out vec4 fs_Col;
 out vec4 fs_Nor;
@@ -16,6 +15,8 @@ out vec4 fs_LightVec;
 out float dist;
 const vec4 lightDir = normalize(vec4(0.5, 1, 0.75, 0));
 
+invariant gl_Position;     // Matches depth.vert.glsl, for the depth pre-pass
+
 float sdfHex(vec2 p, float s)
 {
     const vec3 k = vec3(-0.866025404,0.5,0.577350269);
@@ -30,7 +31,7 @@ void main()
     fs_Col = vs_Col;
     mat3 invTranspose = mat3(u_ModelInvTr);
     fs_Nor = vec4(invTranspose * vec3(vs_Nor), 0);
-    vec4 modelposition = u_Model * vs_Pos;
+    vec4 modelposition = u_Model * (vs_Pos + vec4(vs_ChunkOrigin, 0));
     fs_LightVec = (lightDir);
 
     gl_Position = u_ViewProj * modelposition;
@@ -1,9 +1,10 @@
 #version 330
 // ^ Change this to version 130 if you have compatibility issues
-uniform float u_Time;
+#include "frameuniforms.glsl"
 in vec4 fs_Pos;
 in vec4 fs_Col;
-out vec4 out_Col;
+layout(location = 0) out vec4 out_Col;
+layout(location = 1) out vec4 out_HexMask;
 
 vec3 random3( vec2 p ) {
     return fract(sin(vec3(dot(p,vec2(127.1, 311.7)),
@@ -16,4 +17,6 @@ void main()
 {
     out_Col = vec4(random3(10.f * fs_Pos.xz + sin(u_Time)), 0.8f) + vec4(0.5f, 0.05f, 0.05f, 0.f);
     clamp(out_Col, 0, 1);
+    // Zero alpha, so blending leaves the mask of the terrain behind the walls untouched
+    out_HexMask = vec4(0.f);
 }
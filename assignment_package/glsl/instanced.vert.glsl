@@ -7,10 +7,8 @@
 //This simultaneous transformation allows your program to run much faster, especially when rendering
 //geometry with millions of vertices.
 
-uniform mat4 u_ViewProj;    // The matrix that defines the camera's transformation.
-                            // We've written a static matrix for you to use for HW2,
-                            // but in HW3 you'll have to generate one yourself
-uniform mat4 u_DepthMVP;    // MVP transformation matrix from light's POV
+#include "frameuniforms.glsl"
+uniform mat4 u_Model;       // Sizes and centres the cube, shared by every instance
 
 in vec4 vs_Pos;             // The array of vertex positions passed to the shader
 in vec4 vs_Nor;             // The array of vertex normals passed to the shader
@@ -22,14 +20,13 @@ out vec4 fs_Pos;
 out vec4 fs_Nor;            // The array of normals that has been transformed by u_ModelInvTr. This is implicitly passed to the fragment shader.
 out vec4 fs_LightVec;       // The direction in which our virtual light lies, relative to each vertex. This is implicitly passed to the fragment shader.
 out vec4 fs_Col;            // The color of each vertex. This is implicitly passed to the fragment shader.
-out vec4 fs_LightDepth;     // distance fragment is from the light source
 
 const vec4 lightDir = normalize(vec4(0.5, 1, 0.75, 0));  // The direction of our virtual light, which is used to compute the shading of
                                         // the geometry in the fragment shader.
 
 void main()
 {
-    vec4 offsetPos = vs_Pos + vec4(vs_OffsetInstanced, 0.);
+    vec4 offsetPos = u_Model * vs_Pos + vec4(vs_OffsetInstanced, 0.);
     fs_Pos = offsetPos;
     fs_Col = vec4(vs_ColInstanced, 1.);                         // Pass the vertex colors to the fragment shader for interpolation
 
@@ -37,8 +34,6 @@ void main()
 
     fs_LightVec = (lightDir);  // Compute the direction in which the light source lies
 
-    fs_LightDepth = vec4(0);
-
     gl_Position = u_ViewProj * offsetPos;// gl_Position is a built-in variable of OpenGL which is
                                              // used to render the final positions of the geometry's vertices
 }
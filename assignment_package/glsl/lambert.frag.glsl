@@ -11,21 +11,21 @@
 // can compute what color to apply to its pixel based on things like vertex
 // position, light position, and vertex color.
 
-uniform sampler2D u_Texture; // The texture to be read from by this shader
+uniform sampler2DArray u_Texture; // The block textures, one tile per layer
 uniform vec4 u_Color; // The color with which to render this instance of geometry.
-uniform float u_Time; // Time for animation !!
-uniform sampler2D u_ShadowMap; // shadow mapping moment
+#include "frameuniforms.glsl"
+uniform sampler2DArray u_ShadowMap; // shadow mapping moment, one layer per cascade
 
 // These are the interpolated values out of the rasterizer, so you can't know
 // their specific values without knowing the vertices that contributed to them
 in vec4 fs_Pos;
 in vec4 fs_Nor;
 in vec4 fs_LightVec;
-in vec4 fs_Col;
-in vec4 fs_LightDepth;
+in vec4 fs_Col;             // The UV within the block's texture, its layer, and 1 if it scrolls
 
-out vec4 out_Col; // This is the final output color that you will see on your
-                  // screen for the pixel that is currently being processed.
+layout(location = 0) out vec4 out_Col; // This is the final output color that you will see on your
+                                       // screen for the pixel that is currently being processed.
+layout(location = 1) out vec4 out_HexMask; // White outside the hex, black inside. Read by the timeline pass.
 
 float random1(vec3 p) {
     return fract(sin(dot(p,vec3(127.1, 311.7, 191.999)))
@@ -72,19 +72,41 @@ float fbm(vec3 p) {
     return sum;
 }
 
+float sdfHex(vec2 p, float s)
+{
+    const vec3 k = vec3(-0.866025404,0.5,0.577350269);
+    p = abs(p);
+    p -= 2.0*min(dot(k.xy,p),0.0)*k.xy;
+    p -= vec2(clamp(p.x, -k.z*s, k.z*s), s);
+    return length(p)*sign(p.y);
+}
+
 const vec2 poissonDisk[4] = vec2[](vec2(-0.6, -0.2), vec2(0.6, -0.4), vec2(-0, -0.6), vec2(0.2, 0.1));
 
 void main()
 {
     // calculate shadows
     float visibility = 1.0;
-    vec4 shadowCoords = fs_LightDepth;
-    shadowCoords = shadowCoords * 0.5 + 0.5;
-
-    float bias = max(0.05 * (1.0 - dot(fs_Nor, fs_LightVec)), 0.005);
-    for (int i = 0; i < 4; i++){
-        if (texture(u_ShadowMap, shadowCoords.xy + poissonDisk[i]/700.0).r < shadowCoords.z - bias) {
-            visibility -= 0.2;
+    if (u_CascadeCount > 0) {
+        // use the nearest (sharpest) cascade that covers this fragment,
+        // with a margin for the poisson samples
+        int cascade = u_CascadeCount - 1;
+        for (int i = 0; i < u_CascadeCount - 1; i++) {
+            vec4 lightPos = u_CascadeMVP[i] * fs_Pos;
+            if (all(lessThan(abs(lightPos.xy), vec2(0.98)))) {
+                cascade = i;
+                break;
+            }
+        }
+        vec4 shadowCoords = u_CascadeMVP[cascade] * fs_Pos;
+        shadowCoords = shadowCoords * 0.5 + 0.5;
+
+        float bias = max(0.05 * (1.0 - dot(fs_Nor, fs_LightVec)), 0.005);
+        for (int i = 0; i < 4; i++){
+            vec3 uv = vec3(shadowCoords.xy + poissonDisk[i]/700.0, cascade);
+            if (texture(u_ShadowMap, uv).r < shadowCoords.z - bias) {
+                visibility -= 0.2;
+            }
         }
     }
 
@@ -93,12 +115,12 @@ void main()
     // Avoid negative lighting values
     diffuseTerm = clamp(diffuseTerm, 0, 1);
 
-    vec4 baseColor = texture(u_Texture, fs_Col.rg);
+    vec4 baseColor = texture(u_Texture, fs_Col.xyz);
 
-    // animate if animation flag is 1.f
-    if (fs_Col.b == 1.f) {
-        float newUV_r = fs_Col.r + mod(u_Time * 0.02f, 1.f / 16.f);
-        baseColor = texture(u_Texture, vec2(newUV_r, fs_Col.g));
+    // animate if animation flag is 1.f, scrolling into the next layer along
+    if (fs_Col.w == 1.f) {
+        float u = fs_Col.x + mod(u_Time * 0.32f, 1.f);
+        baseColor = texture(u_Texture, vec3(fract(u), fs_Col.y, fs_Col.z + floor(u)));
     }
 
     float ambientTerm = 0.2;
@@ -112,4 +134,7 @@ void main()
     // Compute final shaded color
     //out_Col = vec4(diffuseColor.rgb * lightIntensity, diffuseColor.a);
     out_Col = vec4(baseColor.rgb * lightIntensity, baseColor.a);
+
+    float dist = sdfHex(u_HexCenter - fs_Pos.xz, u_HexRadius * cos(radians(30.f)));
+    out_HexMask = vec4(vec3(step(0, dist)), 1.0);
 }
@@ -16,32 +16,31 @@ uniform mat4 u_ModelInvTr;  // The inverse transpose of the model matrix.
                             // This allows us to transform the object's normals properly
                             // if the object has been non-uniformly scaled.
 
-uniform mat4 u_ViewProj;    // The matrix that defines the camera's transformation.
-                            // We've written a static matrix for you to use for HW2,
-                            // but in HW3 you'll have to generate one yourself
-uniform float u_Time;
+#include "frameuniforms.glsl"
 uniform vec4 u_Color;       // When drawing the cube instance, we'll set our uniform color to represent different block types.
 
-uniform mat4 u_DepthMVP;      // MVP transformation matrix from light's POV
-
 in vec4 vs_Pos;             // The array of vertex positions passed to the shader
 
 in vec4 vs_Nor;             // The array of vertex normals passed to the shader
 
 in vec4 vs_Col;             // The array of vertex colors passed to the shader.
 
+in vec3 vs_ChunkOrigin;     // Where the Chunk being drawn sits in the world, added before
+                            // u_Model. Zero for anything that isn't a Chunk.
+
 out vec4 fs_Pos;
 out vec4 fs_Nor;            // The array of normals that has been transformed by u_ModelInvTr. This is implicitly passed to the fragment shader.
 out vec4 fs_LightVec;       // The direction in which our virtual light lies, relative to each vertex. This is implicitly passed to the fragment shader.
 out vec4 fs_Col;            // The color of each vertex. This is implicitly passed to the fragment shader.
-out vec4 fs_LightDepth;     // distance fragment is from the light source
 
 const vec4 lightDir = normalize(vec4(0.5, 1, 0.75, 0));  // The direction of our virtual light, which is used to compute the shading of
                                         // the geometry in the fragment shader.
 
+invariant gl_Position;      // Matches depth.vert.glsl bit for bit, for the depth pre-pass
+
 void main()
 {
-    fs_Pos = u_Model * vs_Pos;
+    fs_Pos = u_Model * (vs_Pos + vec4(vs_ChunkOrigin, 0));
     fs_Col = vs_Col;//u_Color;                         // Pass the vertex colors to the fragment shader for interpolation
 
     mat3 invTranspose = mat3(u_ModelInvTr);
@@ -53,9 +52,7 @@ void main()
 
     fs_LightVec = (lightDir);  // Compute the direction in which the light source lies
 
-    vec4 modelposition = u_Model * vs_Pos;   // Temporarily store the transformed vertex positions for use below
-
-    fs_LightDepth = u_DepthMVP * vec4(vec3(modelposition), 1);
+    vec4 modelposition = fs_Pos;             // Temporarily store the transformed vertex positions for use below
 
     gl_Position = u_ViewProj * modelposition;// gl_Position is a built-in variable of OpenGL which is
                                              // used to render the final positions of the geometry's vertices
@@ -1,15 +1,6 @@
-#version 150
-// ^ Change this to version 130 if you have compatibility issues
-
-// Refer to the lambert shader files for useful comments
-
-in vec2 fs_UV;
-
-uniform sampler2D u_RenderedTexture;
-
-uniform float u_Time;
-
-out vec4 out_Col;
+// Medium effect: the rippling red glow seen from inside lava.
+// Spliced into a post-processing shader by PostProcessComposer, which
+// declares u_RenderedTexture and u_Time.
 
 vec2 random2(vec2 p) {
     return fract(sin(vec2(dot(p,vec2(127.1, 311.7)),
@@ -43,10 +34,9 @@ float perlin(vec2 p) {
     return surfletSum;
 }
 
-void main()
+vec4 applyMedium(vec2 fs_UV)
 {
     float perlinNoise = perlin(vec2(12.f * fs_UV.x + cos(u_Time * 0.2f), 10.f * fs_UV.y - sin(u_Time * 0.5f)));
     vec2 uv = perlinNoise/35.f + fs_UV;
-    out_Col = texture(u_RenderedTexture, uv) + vec4(0.8, 0.2, 0.2, 0);
-    normalize(out_Col);
+    return texture(u_RenderedTexture, uv) + vec4(0.8, 0.2, 0.2, 0);
 }
@@ -0,0 +1,28 @@
+#version 330
+// ^ Change this to version 130 if you have compatibility issues
+
+// Lays the transparent faces accumulated by weightedblend.frag.glsl
+// over the opaque scene, drawn as a full-screen quad with
+// glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA). Both targets are
+// the size of the one drawn to, so they are read texel for texel.
+
+uniform sampler2D u_RenderedTexture; // The accumulation target
+uniform sampler2D u_Hexture;         // The revealage target
+
+layout(location = 0) out vec4 out_Col;
+layout(location = 1) out vec4 out_HexMask;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float revealage = texelFetch(u_Hexture, texel, 0).r;
+    // Nothing transparent covers this pixel
+    if (revealage >= 1.0) {
+        discard;
+    }
+    vec4 accum = texelFetch(u_RenderedTexture, texel, 0);
+    vec3 average = accum.rgb / max(accum.a, 1e-5);
+    out_Col = vec4(average, 1.0 - revealage);
+    // Zero alpha, so blending leaves the mask of the terrain beneath untouched
+    out_HexMask = vec4(0.f);
+}
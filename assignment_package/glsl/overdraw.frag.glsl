@@ -0,0 +1,15 @@
+#version 330
+
+// Adds the same small amount of grey for every fragment drawn, so with
+// additive blending each pixel's brightness counts how many times it
+// was shaded. White is 16 or more.
+
+layout(location = 0) out vec4 out_Col;
+layout(location = 1) out vec4 out_HexMask;
+
+void main()
+{
+    out_Col = vec4(vec3(1.f / 16.f), 1.f);
+    // Zero, so blending leaves the mask untouched
+    out_HexMask = vec4(0.f);
+}
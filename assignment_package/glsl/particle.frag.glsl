@@ -0,0 +1,23 @@
+#version 330
+// ^ Change this to version 130 if you have compatibility issues
+
+// Refer to the lambert shader files for useful comments.
+// Shades the particles drawn by instanced.vert.glsl in their own colour.
+uniform vec4 u_Color;       // Only the alpha is used, the same for every particle of a type
+
+in vec4 fs_Pos;
+in vec4 fs_Nor;
+in vec4 fs_LightVec;
+in vec4 fs_Col;
+
+layout(location = 0) out vec4 out_Col;
+layout(location = 1) out vec4 out_HexMask;
+
+void main()
+{
+    float diffuseTerm = clamp(dot(normalize(fs_Nor), normalize(fs_LightVec)), 0, 1);
+    float ambientTerm = 0.3;
+    out_Col = vec4(fs_Col.rgb * (diffuseTerm + ambientTerm), u_Color.a);
+    // Zero alpha, so blending leaves the mask of the terrain behind the particles untouched
+    out_HexMask = vec4(0.f);
+}
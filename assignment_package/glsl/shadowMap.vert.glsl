@@ -2,12 +2,13 @@
 // Input vertex data, different for all executions of this shader.
 // layout (location = 0) in vec3 vs_Pos;
 in vec4 vs_Pos;
+in vec3 vs_ChunkOrigin;     // Where the Chunk being drawn sits; zero for anything else
 
+#include "frameuniforms.glsl"
 uniform mat4 u_Model;
-// Values that stay constant for the whole mesh.
-uniform mat4 u_DepthMVP;
+uniform int u_Cascade;      // The shadow cascade being rendered, indexing u_CascadeMVP
 
 void main()
 {
-    gl_Position = u_DepthMVP * vec4(vec3(u_Model * vs_Pos), 1.0);
+    gl_Position = u_CascadeMVP[u_Cascade] * vec4(vec3(u_Model * (vs_Pos + vec4(vs_ChunkOrigin, 0))), 1.0);
 }
@@ -1,27 +1,27 @@
 #version 330
 // ^ Change this to version 130 if you have compatibility issues
 
-uniform sampler2D u_Texture; // The texture to be read from by this shader
-uniform float u_Time; // Time for animation !!
+uniform sampler2DArray u_Texture; // The block textures, one tile per layer
+#include "frameuniforms.glsl"
 
 in vec4 fs_Nor;
 in vec4 fs_LightVec;
-in vec4 fs_Col;
-out vec4 out_Col;
+in vec4 fs_Col;             // The UV within the block's texture, its layer, and 1 if it scrolls
 in float dist;
+layout(location = 0) out vec4 out_Col;
+layout(location = 1) out vec4 out_HexMask; // White outside the hex, black inside. Read by the timeline pass.
 
 void main()
 {
     //for toon shading with a texture, we will map each pixel's colour to the
     //nearest corner of its square on the texture grid. This way we'll get a
     //flat-shaded square to give the artificial toon-like look.
-    vec2 corner_UV = vec2(int(16 * fs_Col.r)/16.f, int(16 * fs_Col.g)/16.f);
-    vec4 baseColor = texture(u_Texture, corner_UV);
+    vec4 baseColor = texelFetch(u_Texture, ivec3(0, 0, int(fs_Col.z + 0.5)), 0);
 
-    // animate if animation flag is 1.f
-    if (fs_Col.b == 1.f) {
-        float newUV_r = fs_Col.r + mod(u_Time * 0.02f, 1.f / 16.f);
-        baseColor = texture(u_Texture, vec2(newUV_r, fs_Col.g));
+    // animate if animation flag is 1.f, scrolling into the next layer along
+    if (fs_Col.w == 1.f) {
+        float u = fs_Col.x + mod(u_Time * 0.32f, 1.f);
+        baseColor = texture(u_Texture, vec3(fract(u), fs_Col.y, fs_Col.z + floor(u)));
     }
 
     //borrowed from lambertian shader
@@ -31,7 +31,7 @@ void main()
     float lightIntensity = diffuseTerm + ambientTerm;
 
     //lambertian shading color
-    vec4 lambertian_base = texture(u_Texture, fs_Col.rg);
+    vec4 lambertian_base = texture(u_Texture, fs_Col.xyz);
     vec4 lambertian_col = vec4(lambertian_base.rgb * lightIntensity, baseColor.a);
 
     //toon shading
@@ -48,4 +48,5 @@ void main()
     //final color - deciding b/w lambertian VS toon based on the b/w hex map
     float insideOrOutsideHex = step(0, dist);
     out_Col = mix(toon_col, lambertian_col, insideOrOutsideHex);
+    out_HexMask = vec4(vec3(insideOrOutsideHex), 1.0);
 }
@@ -0,0 +1,48 @@
+#version 330
+// ^ Change this to version 130 if you have compatibility issues
+
+// Refer to toon.frag.glsl for useful comments.
+// Shades the terrain's transparent faces like toon.frag.glsl, for the
+// weighted blended transparency pass (see weightedblend.frag.glsl), so
+// water outside the hex is toon shaded like the ground beneath it. The
+// hex mask is left to the opaque faces behind.
+
+uniform sampler2DArray u_Texture; // The block textures, one tile per layer
+#include "frameuniforms.glsl"
+
+in vec4 fs_Nor;
+in vec4 fs_LightVec;
+in vec4 fs_Col;             // The UV within the block's texture, its layer, and 1 if it scrolls
+in float dist;
+
+#include "weightedblend.glsl"
+
+void main()
+{
+    vec4 baseColor = texelFetch(u_Texture, ivec3(0, 0, int(fs_Col.z + 0.5)), 0);
+
+    // animate if animation flag is 1.f, scrolling into the next layer along
+    if (fs_Col.w == 1.f) {
+        float u = fs_Col.x + mod(u_Time * 0.32f, 1.f);
+        baseColor = texture(u_Texture, vec3(fract(u), fs_Col.y, fs_Col.z + floor(u)));
+    }
+
+    float diffuseTerm = clamp(dot(normalize(fs_Nor), normalize(fs_LightVec)), 0, 1);
+    float ambientTerm = 0.2;
+    float lightIntensity = diffuseTerm + ambientTerm;
+
+    vec4 lambertian_base = texture(u_Texture, fs_Col.xyz);
+    vec4 lambertian_col = vec4(lambertian_base.rgb * lightIntensity, lambertian_base.a);
+
+    vec4 toonShade;
+    if (lightIntensity > 0.95)      toonShade = vec4(1.0, 1.0, 1.0, 1.0);
+    else if (lightIntensity > 0.75) toonShade = vec4(0.8, 0.8, 0.8, 1.0);
+    else if (lightIntensity > 0.50) toonShade = vec4(0.6, 0.6, 0.6, 1.0);
+    else if (lightIntensity > 0.25) toonShade = vec4(0.4, 0.4, 0.4, 1.0);
+    else                            toonShade = vec4(0.2, 0.2, 0.2, 1.0);
+
+    vec4 toon_col = baseColor * toonShade;
+
+    float insideOrOutsideHex = step(0, dist);
+    writeWeightedBlend(mix(toon_col, lambertian_col, insideOrOutsideHex));
+}
@@ -1,15 +1,6 @@
-#version 150
-// ^ Change this to version 130 if you have compatibility issues
-
-// Refer to the lambert shader files for useful comments
-
-in vec2 fs_UV;
-
-uniform sampler2D u_RenderedTexture;
-
-uniform float u_Time;
-
-out vec4 out_Col;
+// Medium effect: the wavy blue haze seen from underwater.
+// Spliced into a post-processing shader by PostProcessComposer, which
+// declares u_RenderedTexture and u_Time.
 
 vec2 random2(vec2 p) {
     return fract(sin(vec2(dot(p,vec2(127.1, 311.7)),
@@ -112,11 +103,10 @@ float fbm1D(float n) {
 }
 
 
-void main()
-{    
+vec4 applyMedium(vec2 fs_UV)
+{
 //    float perlinNoise = perlin(vec2(fbm1D(13.f * fs_UV.y + sin(u_Time)), fbm1D(15.f * fs_UV.x + cos(u_Time))));
     float perlinInturbedFbmNoise = fbm2D(vec2(3.f * perlin(fs_UV) + sin(u_Time), 5.f * perlin(vec2(fs_UV.y, fs_UV.x)) + cos(u_Time)));
     vec2 uv = perlinInturbedFbmNoise/45.f + fs_UV;
-    out_Col = texture(u_RenderedTexture, uv) + vec4(0, 0, 0.4, 0);
-    normalize(out_Col);
+    return texture(u_RenderedTexture, uv) + vec4(0, 0, 0.4, 0);
 }
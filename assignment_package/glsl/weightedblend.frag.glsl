@@ -0,0 +1,68 @@
+#version 330
+// ^ Change this to version 130 if you have compatibility issues
+
+// Refer to the lambert shader files for useful comments.
+// Shades the terrain's transparent faces like lambert.frag.glsl, for
+// weighted blended order-independent transparency (McGuire and Bavoil,
+// 2013). Every fragment adds its premultiplied colour, scaled by a
+// weight that falls off with depth, to the accumulation target, and
+// multiplies the revealage target by how much it lets through. As
+// addition and multiplication don't care for order, neither does this
+// pass. oitcomposite.frag.glsl then lays the average over the scene.
+// Also drawn with glitch.vert.glsl in the dystopian timeline.
+
+uniform sampler2DArray u_Texture; // The block textures, one tile per layer
+#include "frameuniforms.glsl"
+uniform sampler2DArray u_ShadowMap; // shadow mapping moment, one layer per cascade
+
+in vec4 fs_Pos;
+in vec4 fs_Nor;
+in vec4 fs_LightVec;
+in vec4 fs_Col;             // The UV within the block's texture, its layer, and 1 if it scrolls
+
+#include "weightedblend.glsl"
+
+const vec2 poissonDisk[4] = vec2[](vec2(-0.6, -0.2), vec2(0.6, -0.4), vec2(-0, -0.6), vec2(0.2, 0.1));
+
+float shadowVisibility()
+{
+    float visibility = 1.0;
+    if (u_CascadeCount > 0) {
+        int cascade = u_CascadeCount - 1;
+        for (int i = 0; i < u_CascadeCount - 1; i++) {
+            vec4 lightPos = u_CascadeMVP[i] * fs_Pos;
+            if (all(lessThan(abs(lightPos.xy), vec2(0.98)))) {
+                cascade = i;
+                break;
+            }
+        }
+        vec4 shadowCoords = u_CascadeMVP[cascade] * fs_Pos;
+        shadowCoords = shadowCoords * 0.5 + 0.5;
+
+        float bias = max(0.05 * (1.0 - dot(fs_Nor, fs_LightVec)), 0.005);
+        for (int i = 0; i < 4; i++){
+            vec3 uv = vec3(shadowCoords.xy + poissonDisk[i]/700.0, cascade);
+            if (texture(u_ShadowMap, uv).r < shadowCoords.z - bias) {
+                visibility -= 0.2;
+            }
+        }
+    }
+    return visibility;
+}
+
+void main()
+{
+    vec4 baseColor = texture(u_Texture, fs_Col.xyz);
+    // animate if animation flag is 1.f, scrolling into the next layer along
+    if (fs_Col.w == 1.f) {
+        float u = fs_Col.x + mod(u_Time * 0.32f, 1.f);
+        baseColor = texture(u_Texture, vec3(fract(u), fs_Col.y, fs_Col.z + floor(u)));
+    }
+
+    float diffuseTerm = clamp(dot(normalize(fs_Nor), normalize(fs_LightVec)), 0, 1);
+    float ambientTerm = 0.2;
+    float lightIntensity = (diffuseTerm + ambientTerm) * shadowVisibility();
+    vec4 color = vec4(baseColor.rgb * lightIntensity, baseColor.a);
+
+    writeWeightedBlend(color);
+}
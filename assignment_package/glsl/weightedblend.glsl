@@ -0,0 +1,21 @@
+// Writes a shaded fragment for weighted blended order-independent
+// transparency (McGuire and Bavoil, 2013), see weightedblend.frag.glsl.
+// Included by every fragment shader the transparency pass draws with.
+//
+// The blending this expects, set by MyGL:
+//   location 0: glBlendFunci(0, GL_ONE, GL_ONE)
+//   location 1: glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR)
+
+layout(location = 0) out vec4 out_Accum;     // Weighted premultiplied colour, and weighted alpha
+layout(location = 1) out vec4 out_Revealage; // Alpha, in the red channel
+
+void writeWeightedBlend(vec4 color)
+{
+    // The paper's equation (10): near and opaque fragments outweigh far
+    // and faint ones. Clamped so the sums stay within half floats.
+    float a = color.a;
+    float weight = clamp(pow(min(1.0, a * 10.0) + 0.01, 3.0) * 1e8 *
+                         pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+    out_Accum = vec4(color.rgb * a, a) * weight;
+    out_Revealage = vec4(a);
+}
@@ -1,4 +1,4 @@
-QT += core widgets openglwidgets
+QT += core widgets opengl openglwidgets
 
 TARGET = MiniMinecraft
 TEMPLATE = app
@@ -3,5 +3,7 @@
 ChunkVBOData::ChunkVBOData(Chunk* c) :
     mp_chunk(c),
     m_vboDataOpaque{}, m_vboDataTransparent{},
-    m_idxDataOpaque{}, m_idxDataTransparent{}
+    m_idxDataOpaque{}, m_idxDataTransparent{},
+    m_minY(0), m_maxY(255), m_occluderSpans(),
+    m_sectionRanges(), m_sectionConnectivity()
 {}
@@ -11,8 +11,16 @@ private:
     Chunk* mp_chunk;
     vector<glm::vec4> m_vboDataOpaque, m_vboDataTransparent;
     vector<GLuint> m_idxDataOpaque, m_idxDataTransparent;
+    // The lowest and highest y of any non-EMPTY block in the Chunk.
+    int m_minY, m_maxY;
+    // See Chunk::m_occluderSpans.
+    std::array<glm::ivec2, 4> m_occluderSpans;
+    // See Chunk::m_sectionRanges and Chunk::m_sectionConnectivity.
+    std::array<glm::ivec2, 16> m_sectionRanges;
+    std::array<SectionConnectivity, 16> m_sectionConnectivity;
 
     friend class Terrain;
+    friend class RegionFile;
 
 public:
     ChunkVBOData(Chunk* c);
@@ -2,9 +2,11 @@
 #include <iostream>
 
 FrameBuffer::FrameBuffer(OpenGLContext *context,
-                         unsigned int width, unsigned int height, unsigned int devicePixelRatio)
+                         unsigned int width, unsigned int height, unsigned int devicePixelRatio,
+                         bool hasMask, bool hasDepth, bool floatColor)
     : mp_context(context), m_frameBuffer(-1),
-      m_outputTexture(-1), m_depthRenderBuffer(-1),
+      m_outputTexture(-1), m_maskTexture(-1), m_depthRenderBuffer(-1), m_hasMask(hasMask), m_hasDepth(hasDepth),
+      m_floatColor(floatColor),
       m_width(width), m_height(height), m_devicePixelRatio(devicePixelRatio), m_created(false)
 {}
 
@@ -18,34 +20,54 @@ void FrameBuffer::create() {
     // Initialize the frame buffers and render textures
     mp_context->glGenFramebuffers(1, &m_frameBuffer);
     mp_context->glGenTextures(1, &m_outputTexture);
-    mp_context->glGenRenderbuffers(1, &m_depthRenderBuffer);
 
     mp_context->glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
     // Bind our texture so that all functions that deal with textures will interact with this one
     mp_context->glBindTexture(GL_TEXTURE_2D, m_outputTexture);
     // Give an empty image to OpenGL ( the last "0" )
-    mp_context->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, m_width * m_devicePixelRatio, m_height * m_devicePixelRatio, 0, GL_RGB, GL_UNSIGNED_BYTE, (void*)0);
+    if(m_floatColor) {
+        mp_context->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, m_width * m_devicePixelRatio, m_height * m_devicePixelRatio, 0, GL_RGBA, GL_FLOAT, (void*)0);
+    } else {
+        mp_context->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, m_width * m_devicePixelRatio, m_height * m_devicePixelRatio, 0, GL_RGB, GL_UNSIGNED_BYTE, (void*)0);
+    }
 
     // Set the render settings for the texture we've just created.
-    // Essentially zero filtering on the "texture" so it appears exactly as rendered
-    mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    // Linear, so a frame buffer smaller than the screen (see QualityGovernor)
+    // is smoothly scaled up. At full size every pixel lands on a texel
+    // centre, so it appears exactly as rendered.
+    mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     // Clamp the colors at the edge of our texture
     mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    // Initialize our depth buffer
-    mp_context->glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderBuffer);
-    mp_context->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, m_width, m_height);
-    mp_context->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderBuffer);
+    if(m_hasDepth) {
+        // Initialize our depth buffer
+        mp_context->glGenRenderbuffers(1, &m_depthRenderBuffer);
+        mp_context->glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderBuffer);
+        mp_context->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, m_width, m_height);
+        mp_context->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderBuffer);
+    }
 
     // Set m_renderedTexture as the color output of our frame buffer
     mp_context->glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_outputTexture, 0);
 
+    if(m_hasMask) {
+        // The mask only needs one channel, so it is stored as GL_R8
+        mp_context->glGenTextures(1, &m_maskTexture);
+        mp_context->glBindTexture(GL_TEXTURE_2D, m_maskTexture);
+        mp_context->glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, m_width * m_devicePixelRatio, m_height * m_devicePixelRatio, 0, GL_RED, GL_UNSIGNED_BYTE, (void*)0);
+        mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        mp_context->glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, m_maskTexture, 0);
+    }
+
     // Sets the color output of the fragment shader to be stored in GL_COLOR_ATTACHMENT0,
-    // which we previously set to m_renderedTexture
-    GLenum drawBuffers[1] = {GL_COLOR_ATTACHMENT0};
-    mp_context->glDrawBuffers(1, drawBuffers); // "1" is the size of drawBuffers
+    // which we previously set to m_renderedTexture, and location 1 to the mask if we have one
+    GLenum drawBuffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    mp_context->glDrawBuffers(m_hasMask ? 2 : 1, drawBuffers);
 
     m_created = true;
     if(mp_context->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
@@ -61,12 +83,17 @@ void FrameBuffer::destroy() {
         m_created = false;
         mp_context->glDeleteFramebuffers(1, &m_frameBuffer);
         mp_context->glDeleteTextures(1, &m_outputTexture);
-        mp_context->glDeleteRenderbuffers(1, &m_depthRenderBuffer);
+        if(m_hasMask) {
+            mp_context->glDeleteTextures(1, &m_maskTexture);
+        }
+        if(m_hasDepth) {
+            mp_context->glDeleteRenderbuffers(1, &m_depthRenderBuffer);
+        }
     }
 }
 
-void FrameBuffer::bindFrameBuffer() {
-    mp_context->glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
+void FrameBuffer::bindFrameBuffer(GLenum target) {
+    mp_context->glBindFramebuffer(target, m_frameBuffer);
 }
 
 void FrameBuffer::bindToTextureSlot(unsigned int slot) {
@@ -75,14 +102,20 @@ void FrameBuffer::bindToTextureSlot(unsigned int slot) {
     mp_context->glBindTexture(GL_TEXTURE_2D, m_outputTexture);
 }
 
+void FrameBuffer::bindMaskToTextureSlot(unsigned int slot) {
+    mp_context->glActiveTexture(GL_TEXTURE0 + slot);
+    mp_context->glBindTexture(GL_TEXTURE_2D, m_maskTexture);
+}
+
 unsigned int FrameBuffer::getTextureSlot() const {
     return m_textureSlot;
 }
 
-ShadowMapFBO::ShadowMapFBO(OpenGLContext *context, unsigned int width, unsigned int height, unsigned int devicePixelRatio)
+ShadowMapFBO::ShadowMapFBO(OpenGLContext *context, unsigned int width, unsigned int height, unsigned int devicePixelRatio,
+                           unsigned int layers)
     : mp_context(context), m_fbo(-1), m_shadowMap(-1),
       m_width(width), m_height(height),
-      m_devicePixelRatio(devicePixelRatio), m_created(false)
+      m_devicePixelRatio(devicePixelRatio), m_layers(layers), m_created(false)
 {}
 
 void ShadowMapFBO::resize(unsigned int width, unsigned int height, unsigned int devicePixelRatio) {
@@ -91,6 +124,10 @@ void ShadowMapFBO::resize(unsigned int width, unsigned int height, unsigned int
     m_devicePixelRatio = devicePixelRatio;
 }
 
+void ShadowMapFBO::setLayerCount(unsigned int layers) {
+    m_layers = layers;
+}
+
 void ShadowMapFBO::create() {
     // Initialize the frame buffers and depth texture
     mp_context->glGenFramebuffers(1, &m_fbo);
@@ -98,20 +135,20 @@ void ShadowMapFBO::create() {
 
     mp_context->glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
     // Bind our texture so that all functions that deal with textures will interact with this one
-    mp_context->glBindTexture(GL_TEXTURE_2D, m_shadowMap);
-    // Give an empty image to OpenGL ( the last "0" )
-    mp_context->glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, m_width * m_devicePixelRatio, m_height * m_devicePixelRatio, 0, GL_DEPTH_COMPONENT, GL_FLOAT, (void*)0);
+    mp_context->glBindTexture(GL_TEXTURE_2D_ARRAY, m_shadowMap);
+    // Give an empty image to OpenGL ( the last "0" ), one layer per cascade
+    mp_context->glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT, m_width * m_devicePixelRatio, m_height * m_devicePixelRatio, m_layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, (void*)0);
 
     // Set the render settings for the texture we've just created.
     // Essentially zero filtering on the "texture" so it appears exactly as rendered
-    mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    mp_context->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    mp_context->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     // Clamp the colors at the edge of our texture
-    mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    mp_context->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    mp_context->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    // Set m_shadowMap as the depth texture output of our frame buffer
-    mp_context->glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_shadowMap, 0);
+    // Set the first layer of m_shadowMap as the depth texture output of our frame buffer
+    mp_context->glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_shadowMap, 0, 0);
 
     // No color buffer is drawn to.
     mp_context->glDrawBuffers(GL_NONE, NULL);
@@ -134,14 +171,15 @@ void ShadowMapFBO::destroy() {
     }
 }
 
-void ShadowMapFBO::bindFrameBuffer() {
+void ShadowMapFBO::bindFrameBuffer(unsigned int layer) {
     mp_context->glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    mp_context->glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_shadowMap, 0, layer);
 }
 
 void ShadowMapFBO::bindToDepthTexture(unsigned int slot) {
     m_textureSlot = slot;
     mp_context->glActiveTexture(GL_TEXTURE0 + slot);
-    mp_context->glBindTexture(GL_TEXTURE_2D, m_shadowMap);
+    mp_context->glBindTexture(GL_TEXTURE_2D_ARRAY, m_shadowMap);
 }
 
 unsigned int ShadowMapFBO::getTextureSlot() const {
@@ -6,7 +6,12 @@
 // Stores three GPU handles: one to a frame buffer object, one to
 // a texture object that will store the frame buffer's contents,
 // and one to a depth buffer needed to properly render to the frame
-// buffer.
+// buffer. A FrameBuffer may also carry a single-channel mask texture
+// as a second colour attachment, written by fragment shaders through
+// `layout(location = 1) out`, so one pass can produce both images,
+// and may leave out the depth buffer if nothing drawn to it needs one.
+// Its colour texture may be GL_RGBA16F rather than 8-bit GL_RGB, to
+// hold sums that would overflow or band at 8 bits.
 // Redirect your render output to a FrameBuffer by invoking
 // bindFrameBuffer() before ShaderProgram::draw, and read
 // from the frame buffer's output texture by invoking
@@ -17,7 +22,11 @@ private:
     OpenGLContext *mp_context;
     GLuint m_frameBuffer;
     GLuint m_outputTexture;
+    GLuint m_maskTexture;
     GLuint m_depthRenderBuffer;
+    bool m_hasMask;
+    bool m_hasDepth;
+    bool m_floatColor;
 
     unsigned int m_width, m_height, m_devicePixelRatio;
     bool m_created;
@@ -25,7 +34,8 @@ private:
     unsigned int m_textureSlot;
 
 public:
-    FrameBuffer(OpenGLContext *context, unsigned int width, unsigned int height, unsigned int devicePixelRatio);
+    FrameBuffer(OpenGLContext *context, unsigned int width, unsigned int height, unsigned int devicePixelRatio,
+                bool hasMask = false, bool hasDepth = true, bool floatColor = false);
     // Make sure to call resize from MyGL::resizeGL to keep your frame buffer up to date with
     // your screen dimensions
     void resize(unsigned int width, unsigned int height, unsigned int devicePixelRatio);
@@ -33,12 +43,20 @@ public:
     void create();
     // Deallocate all GPU-side data
     void destroy();
-    void bindFrameBuffer();
+    // Draw to (and read from) this frame buffer, or only one of the
+    // two given GL_DRAW_FRAMEBUFFER or GL_READ_FRAMEBUFFER
+    void bindFrameBuffer(GLenum target = GL_FRAMEBUFFER);
     // Associate our output texture with the indicated texture slot
     void bindToTextureSlot(unsigned int slot);
+    // Associate our mask texture with the indicated texture slot.
+    // Only valid if the FrameBuffer was constructed with hasMask.
+    void bindMaskToTextureSlot(unsigned int slot);
     unsigned int getTextureSlot() const;
 };
 
+// A depth-only frame buffer for shadow mapping. Its depth texture is a
+// GL_TEXTURE_2D_ARRAY with one layer per shadow cascade; bindFrameBuffer()
+// selects the layer rendered to, and shaders read it as a sampler2DArray.
 class ShadowMapFBO {
 private:
     OpenGLContext *mp_context;
@@ -46,20 +64,25 @@ private:
     GLuint m_shadowMap;
 
     unsigned int m_width, m_height, m_devicePixelRatio;
+    unsigned int m_layers;
     bool m_created;
 
     unsigned int m_textureSlot;
 
 public:
-    ShadowMapFBO(OpenGLContext *context, unsigned int width, unsigned int height, unsigned int devicePixelRatio);
+    ShadowMapFBO(OpenGLContext *context, unsigned int width, unsigned int height, unsigned int devicePixelRatio,
+                 unsigned int layers = 1);
     // Make sure to call resize from MyGL::resizeGL to keep your frame buffer up to date with
     // your screen dimensions
     void resize(unsigned int width, unsigned int height, unsigned int devicePixelRatio);
+    // Like resize(), takes effect the next time create() is called
+    void setLayerCount(unsigned int layers);
     // Initialize all GPU-side data required
     void create();
     // Deallocate all GPU-side data
     void destroy();
-    void bindFrameBuffer();
+    // Render to the given layer of the depth texture
+    void bindFrameBuffer(unsigned int layer = 0);
     void bindToDepthTexture(unsigned int slot);
     unsigned int getTextureSlot() const;
 };
@@ -0,0 +1,35 @@
+#include "frameuniforms.h"
+
+static_assert(sizeof(FrameUniforms::Data) == 304, "FrameUniforms::Data must match the std140 layout of the block");
+
+FrameUniforms::Data::Data()
+    : viewProj(1.f), cascadeMVP{glm::mat4(1.f), glm::mat4(1.f), glm::mat4(1.f)}, camera(0.f), time(0.f),
+      hexCenter(0.f), hexRadius(0.f), cascadeCount(0), dimensions(0), padding{0, 0}
+{}
+
+FrameUniforms::FrameUniforms(OpenGLContext *context)
+    : mp_context(context), m_buffer(0), m_created(false), data()
+{}
+
+void FrameUniforms::create() {
+    mp_context->glGenBuffers(1, &m_buffer);
+    mp_context->glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    mp_context->glBufferData(GL_UNIFORM_BUFFER, sizeof(Data), &data, GL_DYNAMIC_DRAW);
+    mp_context->labelObject(GL_BUFFER, m_buffer, "Frame uniforms");
+    // Stays bound here, whatever else is bound to GL_UNIFORM_BUFFER
+    mp_context->glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, m_buffer);
+    m_created = true;
+}
+
+void FrameUniforms::destroy() {
+    if (m_created) {
+        m_created = false;
+        mp_context->glDeleteBuffers(1, &m_buffer);
+    }
+}
+
+void FrameUniforms::upload() {
+    mp_context->glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    // Orphans last frame's storage, so this never waits on draws still reading it
+    mp_context->glBufferData(GL_UNIFORM_BUFFER, sizeof(Data), &data, GL_DYNAMIC_DRAW);
+}
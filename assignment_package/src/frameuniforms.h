@@ -0,0 +1,42 @@
+#pragma once
+#include "openglcontext.h"
+#include "glm_includes.h"
+
+// The state every shader shares within a frame (the camera, the shadow
+// cascades, the time and the hex), kept in one std140 uniform buffer.
+// It is uploaded once a frame and read by every program through the
+// FrameUniforms block in glsl/frameuniforms.glsl, instead of being set
+// again on each program with a glUseProgram apiece.
+class FrameUniforms {
+public:
+    // The uniform buffer binding point the block is read from
+    static const GLuint BINDING = 0;
+
+    // Laid out as std140 lays out the GLSL block, member for member
+    struct Data {
+        glm::mat4 viewProj;
+        glm::mat4 cascadeMVP[3];
+        glm::vec3 camera;
+        float time;
+        glm::vec2 hexCenter;
+        float hexRadius;
+        int cascadeCount;
+        glm::ivec2 dimensions;
+        int padding[2];         // std140 rounds the block up to a whole vec4
+        Data();
+    };
+
+private:
+    OpenGLContext *mp_context;
+    GLuint m_buffer;
+    bool m_created;
+
+public:
+    Data data;  // Written by the caller, then sent to the GPU by upload()
+
+    FrameUniforms(OpenGLContext *context);
+    void create();
+    void destroy();
+    // Sends data to the GPU. Programs read it from then on.
+    void upload();
+};
@@ -0,0 +1,60 @@
+#include "freelistallocator.h"
+#include <iterator>
+#include <stdexcept>
+
+FreeListAllocator::FreeListAllocator(unsigned int capacity)
+    : m_free(), m_capacity(capacity), m_used(0)
+{
+    if (capacity > 0) {
+        m_free[0] = capacity;
+    }
+}
+
+unsigned int FreeListAllocator::allocate(unsigned int length) {
+    if (length == 0) {
+        throw std::invalid_argument("FreeListAllocator::allocate: length must be positive");
+    }
+    for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+        if (it->second < length) {
+            continue;
+        }
+        unsigned int start = it->first, remaining = it->second - length;
+        m_free.erase(it);
+        if (remaining > 0) {
+            m_free[start + length] = remaining;
+        }
+        m_used += length;
+        return start;
+    }
+    return INVALID;
+}
+
+void FreeListAllocator::release(unsigned int start, unsigned int length) {
+    if (length == 0 || start + length > m_capacity) {
+        throw std::out_of_range("FreeListAllocator::release: range lies outside the span");
+    }
+    m_used -= length;
+
+    // Merge with the free range after this one, then the one before
+    auto next = m_free.lower_bound(start);
+    if (next != m_free.end() && next->first == start + length) {
+        length += next->second;
+        next = m_free.erase(next);
+    }
+    if (next != m_free.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == start) {
+            prev->second += length;
+            return;
+        }
+    }
+    m_free[start] = length;
+}
+
+unsigned int FreeListAllocator::getCapacity() const {
+    return m_capacity;
+}
+
+unsigned int FreeListAllocator::getUsed() const {
+    return m_used;
+}
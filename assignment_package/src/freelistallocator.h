@@ -0,0 +1,28 @@
+#pragma once
+#include <map>
+
+// Hands out ranges of a fixed-size span of units, e.g. the vertices of
+// a GPU buffer, taking the first free range that fits and merging freed
+// ranges with their free neighbours.
+// Touches no OpenGL state.
+class FreeListAllocator {
+private:
+    // Start -> length of every free range, none of them adjacent
+    std::map<unsigned int, unsigned int> m_free;
+    unsigned int m_capacity;
+    unsigned int m_used;
+
+public:
+    // Returned by allocate() when no free range is long enough
+    static const unsigned int INVALID = ~0u;
+
+    FreeListAllocator(unsigned int capacity);
+
+    // The start of a newly reserved range of the given length, or INVALID.
+    unsigned int allocate(unsigned int length);
+    // Frees a range previously returned by allocate().
+    void release(unsigned int start, unsigned int length);
+
+    unsigned int getCapacity() const;
+    unsigned int getUsed() const;
+};
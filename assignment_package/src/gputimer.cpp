@@ -0,0 +1,72 @@
+#include "gputimer.h"
+
+GpuTimer::GpuTimer(OpenGLContext *context, GLenum target)
+    : mp_context(context), m_target(target), m_queries(), m_pending(), m_next(0),
+      m_running(false), m_created(false), m_average(0.f), m_hasReading(false)
+{}
+
+void GpuTimer::create() {
+    mp_context->glGenQueries(QUERY_COUNT, m_queries.data());
+    m_pending.fill(false);
+    m_created = true;
+}
+
+void GpuTimer::destroy() {
+    if(m_created) {
+        m_created = false;
+        mp_context->glDeleteQueries(QUERY_COUNT, m_queries.data());
+    }
+}
+
+void GpuTimer::collect() {
+    for (int i = 0; i < QUERY_COUNT; i++) {
+        if (!m_pending[i]) {
+            continue;
+        }
+        GLuint available = GL_FALSE;
+        mp_context->glGetQueryObjectuiv(m_queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            continue;
+        }
+        GLuint reading = 0;
+        mp_context->glGetQueryObjectuiv(m_queries[i], GL_QUERY_RESULT, &reading);
+        m_pending[i] = false;
+
+        m_average = m_hasReading ? m_average + 0.05f * (reading - m_average) : reading;
+        m_hasReading = true;
+    }
+}
+
+void GpuTimer::begin() {
+    m_running = false;
+    if (!m_created) {
+        return;
+    }
+    collect();
+    // If the GPU is so far behind that every query is still in flight,
+    // skip this measurement rather than wait.
+    if (m_pending[m_next]) {
+        return;
+    }
+    mp_context->glBeginQuery(m_target, m_queries[m_next]);
+    m_running = true;
+}
+
+void GpuTimer::end() {
+    if (!m_running) {
+        return;
+    }
+    mp_context->glEndQuery(m_target);
+    m_pending[m_next] = true;
+    m_next = (m_next + 1) % QUERY_COUNT;
+    m_running = false;
+}
+
+float GpuTimer::getAverageMs() const {
+    // GL_TIME_ELAPSED is in nanoseconds
+    return m_average / 1e6f;
+}
+
+float GpuTimer::getAverage() const {
+    return m_average;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "openglcontext.h"
+
+#include <array>
+
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+
+// Measures how long the GPU spends on the commands issued between
+// begin() and end(), using GL_TIME_ELAPSED queries. Given
+// GL_SAMPLES_PASSED instead, it counts the samples they draw.
+// Results are read back a few frames late, and only once the GPU
+// reports them available, so timing never stalls the CPU.
+// Timers of the same target may not be nested or overlap.
+class GpuTimer {
+private:
+    static const int QUERY_COUNT = 4;
+
+    OpenGLContext *mp_context;
+    GLenum m_target;
+    std::array<GLuint, QUERY_COUNT> m_queries;
+    std::array<bool, QUERY_COUNT> m_pending;  // Issued but not yet read back
+    int m_next;         // The query the next begin() will use
+    bool m_running;     // Did the last begin() start a query?
+    bool m_created;
+
+    float m_average;    // Exponential moving average of the readings
+    bool m_hasReading;
+
+    // Reads back every query the GPU has finished
+    void collect();
+
+public:
+    GpuTimer(OpenGLContext *context, GLenum target = GL_TIME_ELAPSED);
+    void create();
+    void destroy();
+
+    void begin();
+    void end();
+    // Smoothed GPU time between begin() and end(), in milliseconds.
+    // Zero until the first reading comes back.
+    float getAverageMs() const;
+    // Smoothed reading, in the query's own units
+    float getAverage() const;
+};
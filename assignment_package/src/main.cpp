@@ -1,8 +1,10 @@
 #include <mainwindow.h>
+#include "openglcontext.h"
 
 #include <QApplication>
 #include <QSurfaceFormat>
 #include <QDebug>
+#include <cstring>
 
 void debugFormatVersion()
 {
@@ -23,11 +25,21 @@ int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
 
+    // GL diagnostics: debug context, KHR_debug callback and object labels
+    bool diagnostics = qgetenv("MINIMINECRAFT_GL_DEBUG") != nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--gl-debug") == 0) {
+            diagnostics = true;
+        }
+    }
+    OpenGLContext::setDiagnosticsEnabled(diagnostics);
+
     // Set OpenGL 4.0 and, optionally, 4-sample multisampling
     QSurfaceFormat format;
     format.setVersion(4, 0);
     format.setOption(QSurfaceFormat::DeprecatedFunctions, false);
     format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setOption(QSurfaceFormat::DebugContext, diagnostics);
     //format.setSamples(4);  // Uncomment for nice antialiasing. Not always supported.
 
     /*** AUTOMATIC TESTING: DO NOT MODIFY ***/
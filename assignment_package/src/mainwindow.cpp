@@ -18,6 +18,9 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->mygl, SIGNAL(sig_sendPlayerLook(QString)), &playerInfoWindow, SLOT(slot_setLookText(QString)));
     connect(ui->mygl, SIGNAL(sig_sendPlayerChunk(QString)), &playerInfoWindow, SLOT(slot_setChunkText(QString)));
     connect(ui->mygl, SIGNAL(sig_sendPlayerTerrainZone(QString)), &playerInfoWindow, SLOT(slot_setZoneText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendTerrainPassStats(QString)), &playerInfoWindow, SLOT(slot_setTerrainPassText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendShadowPassStats(QString)), &playerInfoWindow, SLOT(slot_setShadowPassText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendQualityStats(QString)), &playerInfoWindow, SLOT(slot_setQualityText(QString)));
 }
 
 MainWindow::~MainWindow()
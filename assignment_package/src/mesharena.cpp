@@ -0,0 +1,214 @@
+#include "mesharena.h"
+#include "shaderprogram.h"
+#include <QOpenGLFunctions_3_2_Core>
+#include <QOpenGLVersionFunctionsFactory>
+#include <algorithm>
+
+MeshAllocation::MeshAllocation()
+    : page(-1), firstVertex(0), vertexCount(0), firstIndex(0), indexCount(0)
+{}
+
+bool MeshAllocation::isEmpty() const {
+    return page < 0;
+}
+
+MeshArena::Page::Page(unsigned int vertexCapacity, unsigned int indexCapacity)
+    : vao(0), vbo(0), ibo(0), vertices(vertexCapacity), indices(indexCapacity)
+{}
+
+MeshArena::MeshArena(OpenGLContext *context, unsigned int pageVertices, unsigned int pageIndices)
+    : mp_context(context), mp_functions(nullptr), m_pages(),
+      m_pageVertices(pageVertices), m_pageIndices(pageIndices),
+      m_boundPage(-1), m_previousVAO(0), m_counts(), m_offsets(), m_baseVertices()
+{}
+
+void MeshArena::createPage(int index, unsigned int vertexCapacity, unsigned int indexCapacity) {
+    uPtr<Page> page = mkU<Page>(vertexCapacity, indexCapacity);
+    const GLsizei stride = FLOATS_PER_VERTEX * sizeof(float);
+
+    GLint previousVAO = 0;
+    mp_context->glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVAO);
+
+    mp_context->glGenVertexArrays(1, &page->vao);
+    mp_context->glBindVertexArray(page->vao);
+
+    mp_context->glGenBuffers(1, &page->vbo);
+    mp_context->glBindBuffer(GL_ARRAY_BUFFER, page->vbo);
+    mp_context->glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(vertexCapacity) * stride, nullptr, GL_STATIC_DRAW);
+    mp_context->glEnableVertexAttribArray(ShaderProgram::ATTRIB_POS);
+    mp_context->glVertexAttribPointer(ShaderProgram::ATTRIB_POS, 4, GL_FLOAT, false, stride, (void*)0);
+    mp_context->glEnableVertexAttribArray(ShaderProgram::ATTRIB_NOR);
+    mp_context->glVertexAttribPointer(ShaderProgram::ATTRIB_NOR, 4, GL_FLOAT, false, stride, (void*)(4 * sizeof(float)));
+    mp_context->glEnableVertexAttribArray(ShaderProgram::ATTRIB_COL);
+    mp_context->glVertexAttribPointer(ShaderProgram::ATTRIB_COL, 4, GL_FLOAT, false, stride, (void*)(8 * sizeof(float)));
+
+    // The element buffer binding is part of the VAO
+    mp_context->glGenBuffers(1, &page->ibo);
+    mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->ibo);
+    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(indexCapacity) * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+
+    if (mp_context->isDebugLogging()) {
+        QString name = QString::asprintf("Mesh arena page %d", index);
+        mp_context->labelObject(GL_VERTEX_ARRAY, page->vao, name);
+        mp_context->labelObject(GL_BUFFER, page->vbo, name + " vertices");
+        mp_context->labelObject(GL_BUFFER, page->ibo, name + " indices");
+    }
+
+    mp_context->glBindVertexArray(previousVAO);
+    m_boundPage = -1;
+    if (index == int(m_pages.size())) {
+        m_pages.push_back(std::move(page));
+    } else {
+        m_pages[index] = std::move(page);
+    }
+}
+
+void MeshArena::deletePage(int index) {
+    Page &page = *m_pages[index];
+    mp_context->glDeleteVertexArrays(1, &page.vao);
+    mp_context->glDeleteBuffers(1, &page.vbo);
+    mp_context->glDeleteBuffers(1, &page.ibo);
+    m_pages[index] = nullptr;
+    if (m_boundPage == index) {
+        m_boundPage = -1;
+    }
+}
+
+MeshAllocation MeshArena::upload(const std::vector<glm::vec4> &interleaved, const std::vector<GLuint> &indices) {
+    MeshAllocation mesh;
+    if (indices.empty()) {
+        return mesh;
+    }
+    unsigned int vertexCount = interleaved.size() * 4 / FLOATS_PER_VERTEX;
+    unsigned int indexCount = indices.size();
+
+    // First fit across the pages, adding one if none has room, in the
+    // first slot a deleted page left
+    for (unsigned int i = 0; i <= m_pages.size(); i++) {
+        if (i == m_pages.size()) {
+            auto freeSlot = std::find(m_pages.begin(), m_pages.end(), nullptr);
+            i = freeSlot - m_pages.begin();
+            createPage(i, std::max(vertexCount, m_pageVertices), std::max(indexCount, m_pageIndices));
+        } else if (m_pages[i] == nullptr) {
+            continue;
+        }
+        Page &page = *m_pages[i];
+        unsigned int firstVertex = page.vertices.allocate(vertexCount);
+        if (firstVertex == FreeListAllocator::INVALID) {
+            continue;
+        }
+        unsigned int firstIndex = page.indices.allocate(indexCount);
+        if (firstIndex == FreeListAllocator::INVALID) {
+            page.vertices.release(firstVertex, vertexCount);
+            continue;
+        }
+        mesh.page = i;
+        mesh.firstVertex = firstVertex;
+        mesh.vertexCount = vertexCount;
+        mesh.firstIndex = firstIndex;
+        mesh.indexCount = indexCount;
+        break;
+    }
+
+    // Written through the copy target, so no VAO's element binding changes
+    Page &page = *m_pages[mesh.page];
+    mp_context->glBindBuffer(GL_COPY_WRITE_BUFFER, page.vbo);
+    mp_context->glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(mesh.firstVertex) * FLOATS_PER_VERTEX * sizeof(float),
+                                interleaved.size() * sizeof(glm::vec4), interleaved.data());
+    mp_context->glBindBuffer(GL_COPY_WRITE_BUFFER, page.ibo);
+    mp_context->glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(mesh.firstIndex) * sizeof(GLuint),
+                                indices.size() * sizeof(GLuint), indices.data());
+    mp_context->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return mesh;
+}
+
+void MeshArena::release(MeshAllocation &mesh) {
+    if (mesh.isEmpty()) {
+        return;
+    }
+    Page &page = *m_pages[mesh.page];
+    page.vertices.release(mesh.firstVertex, mesh.vertexCount);
+    page.indices.release(mesh.firstIndex, mesh.indexCount);
+    // Kept when it's the last page, so the next upload needn't make one
+    if (page.vertices.getUsed() == 0 && getPageCount() > 1) {
+        deletePage(mesh.page);
+    }
+    mesh = MeshAllocation();
+}
+
+void MeshArena::destroy() {
+    for (unsigned int i = 0; i < m_pages.size(); i++) {
+        if (m_pages[i] != nullptr) {
+            deletePage(i);
+        }
+    }
+    m_pages.clear();
+    m_boundPage = -1;
+}
+
+void MeshArena::beginDraws() {
+    mp_context->glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &m_previousVAO);
+    m_boundPage = -1;
+    if (mp_functions == nullptr) {
+        mp_functions = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_3_2_Core>(mp_context->context());
+    }
+}
+
+void MeshArena::endDraws() {
+    if (m_boundPage >= 0) {
+        mp_context->glBindVertexArray(m_previousVAO);
+        m_boundPage = -1;
+    }
+}
+
+void MeshArena::bindPage(int page) {
+    if (m_boundPage != page) {
+        mp_context->glBindVertexArray(m_pages[page]->vao);
+        m_boundPage = page;
+    }
+}
+
+void MeshArena::draw(const MeshAllocation &mesh, const glm::ivec2 *ranges, int rangeCount) {
+    if (mesh.isEmpty() || rangeCount == 0) {
+        return;
+    }
+    bindPage(mesh.page);
+    m_counts.clear();
+    m_offsets.clear();
+    for (int i = 0; i < rangeCount; i++) {
+        m_counts.push_back(ranges[i].y);
+        m_offsets.push_back((void*)(size_t(mesh.firstIndex + ranges[i].x) * sizeof(GLuint)));
+    }
+    m_baseVertices.assign(rangeCount, mesh.firstVertex);
+    mp_functions->glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_counts.data(), GL_UNSIGNED_INT, m_offsets.data(),
+                                                rangeCount, m_baseVertices.data());
+}
+
+void MeshArena::draw(const MeshAllocation &mesh) {
+    if (mesh.isEmpty()) {
+        return;
+    }
+    bindPage(mesh.page);
+    mp_functions->glDrawElementsBaseVertex(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT,
+                                           (void*)(size_t(mesh.firstIndex) * sizeof(GLuint)), mesh.firstVertex);
+}
+
+std::size_t MeshArena::getByteSize(const MeshAllocation &mesh) {
+    return std::size_t(mesh.vertexCount) * FLOATS_PER_VERTEX * sizeof(float) +
+           std::size_t(mesh.indexCount) * sizeof(GLuint);
+}
+
+int MeshArena::getPageCount() const {
+    return std::count_if(m_pages.begin(), m_pages.end(), [](const uPtr<Page> &page) { return page != nullptr; });
+}
+
+std::size_t MeshArena::getPageBytes() const {
+    std::size_t bytes = 0;
+    for (const uPtr<Page> &page : m_pages) {
+        if (page != nullptr) {
+            bytes += std::size_t(page->vertices.getCapacity()) * FLOATS_PER_VERTEX * sizeof(float) +
+                     std::size_t(page->indices.getCapacity()) * sizeof(GLuint);
+        }
+    }
+    return bytes;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "openglcontext.h"
+#include "freelistallocator.h"
+#include "smartpointerhelp.h"
+#include <glm_includes.h>
+
+#include <vector>
+
+class QOpenGLFunctions_3_2_Core;
+
+// Where one mesh lives inside a MeshArena. A mesh with no indices
+// is never uploaded, and has no page.
+struct MeshAllocation {
+    int page;
+    unsigned int firstVertex, vertexCount;
+    unsigned int firstIndex, indexCount;
+    MeshAllocation();
+    bool isEmpty() const;
+};
+
+// Stores many small meshes, such as those of Chunks, in a few large
+// GPU buffers instead of a VBO and an IBO apiece.
+// Each page pairs a vertex buffer with an index buffer and a VAO that
+// has the attributes set up once, at the fixed locations in
+// ShaderProgram, so drawing a mesh never rebinds buffers or
+// re-specifies attributes. Indices stay relative to their own mesh and
+// are offset by the mesh's first vertex when drawn. A page is deleted
+// once its last mesh is released, unless it is the only page left, so
+// the GPU memory taken shrinks back as meshes are freed.
+//
+// Vertices are interleaved as position, normal and color vec4s.
+class MeshArena {
+private:
+    struct Page {
+        GLuint vao, vbo, ibo;
+        FreeListAllocator vertices, indices;
+        Page(unsigned int vertexCapacity, unsigned int indexCapacity);
+    };
+
+    OpenGLContext *mp_context;
+    // GL 3.2 entry points QOpenGLExtraFunctions lacks, e.g. base-vertex draws
+    QOpenGLFunctions_3_2_Core *mp_functions;
+    std::vector<uPtr<Page>> m_pages; // Null where a page was deleted, reused before adding another
+    unsigned int m_pageVertices, m_pageIndices;
+
+    int m_boundPage;        // The page whose VAO is bound, or -1
+    GLint m_previousVAO;    // The VAO bound when beginDraws() was called
+
+    // Scratch space for draw(), kept to save allocating every call
+    std::vector<GLsizei> m_counts;
+    std::vector<const void*> m_offsets;
+    std::vector<GLint> m_baseVertices;
+
+    void createPage(int index, unsigned int vertexCapacity, unsigned int indexCapacity);
+    void deletePage(int index);
+    void bindPage(int page);
+
+public:
+    static const int FLOATS_PER_VERTEX = 12;
+
+    // Pages hold this many vertices and indices, or more for a mesh that won't fit.
+    MeshArena(OpenGLContext *context, unsigned int pageVertices, unsigned int pageIndices);
+
+    // Copies a mesh into the arena.
+    MeshAllocation upload(const std::vector<glm::vec4> &interleaved, const std::vector<GLuint> &indices);
+    // Frees the mesh's space for reuse and leaves the allocation empty,
+    // deleting its page if nothing else is left in it.
+    void release(MeshAllocation &mesh);
+    // Deletes every page's GL objects.
+    void destroy();
+
+    // Call around a batch of draw() calls, which leave
+    // a page's VAO bound until endDraws() restores the previous one.
+    void beginDraws();
+    void endDraws();
+    // Draws the given [x, x + y) ranges of the mesh's indices with the
+    // program in use, in a single call.
+    void draw(const MeshAllocation &mesh, const glm::ivec2 *ranges, int rangeCount);
+    // Draws all of the mesh's indices.
+    void draw(const MeshAllocation &mesh);
+
+    // The GPU memory the mesh's vertices and indices take up
+    static std::size_t getByteSize(const MeshAllocation &mesh);
+
+    // The pages in use, and the GPU memory they take up, free space included
+    int getPageCount() const;
+    std::size_t getPageBytes() const;
+};
@@ -0,0 +1,104 @@
+#include "meshresidency.h"
+
+MeshResidency::MeshResidency(std::size_t budget)
+    : m_entries(), m_evicted(), m_budget(budget), m_residentBytes(0), m_evictedBytes(0)
+{}
+
+void MeshResidency::setBytes(int64_t key, std::size_t bytes) {
+    auto found = m_entries.find(key);
+    if (found == m_entries.end()) {
+        m_entries[key] = Entry{bytes, false, m_evicted.end()};
+        m_residentBytes += bytes;
+        return;
+    }
+    Entry &entry = found->second;
+    m_residentBytes += bytes - entry.bytes;
+    if (entry.evicted) {
+        m_evictedBytes += bytes - entry.bytes;
+    }
+    entry.bytes = bytes;
+}
+
+void MeshResidency::forget(int64_t key) {
+    auto found = m_entries.find(key);
+    if (found == m_entries.end()) {
+        return;
+    }
+    Entry &entry = found->second;
+    m_residentBytes -= entry.bytes;
+    if (entry.evicted) {
+        m_evictedBytes -= entry.bytes;
+        m_evicted.erase(entry.inEvicted);
+    }
+    m_entries.erase(found);
+}
+
+void MeshResidency::evict(int64_t key) {
+    auto found = m_entries.find(key);
+    if (found == m_entries.end()) {
+        found = m_entries.emplace(key, Entry{0, false, m_evicted.end()}).first;
+    }
+    Entry &entry = found->second;
+    if (entry.evicted) {
+        return;
+    }
+    entry.evicted = true;
+    entry.inEvicted = m_evicted.insert(m_evicted.end(), key);
+    m_evictedBytes += entry.bytes;
+}
+
+bool MeshResidency::restore(int64_t key) {
+    auto found = m_entries.find(key);
+    if (found == m_entries.end()) {
+        return false;
+    }
+    Entry &entry = found->second;
+    if (entry.evicted) {
+        entry.evicted = false;
+        m_evicted.erase(entry.inEvicted);
+        entry.inEvicted = m_evicted.end();
+        m_evictedBytes -= entry.bytes;
+    }
+    return true;
+}
+
+bool MeshResidency::isEvicted(int64_t key) const {
+    auto found = m_entries.find(key);
+    return found != m_entries.end() && found->second.evicted;
+}
+
+bool MeshResidency::takeOverBudget(int64_t *key, const std::function<bool(int64_t)> &canFree) {
+    if (m_residentBytes <= m_budget) {
+        return false;
+    }
+    for (int64_t evicted : m_evicted) {
+        if (canFree(evicted)) {
+            *key = evicted;
+            forget(evicted);
+            return true;
+        }
+    }
+    return false;
+}
+
+void MeshResidency::setBudget(std::size_t budget) {
+    m_budget = budget;
+}
+
+std::size_t MeshResidency::getBudget() const {
+    return m_budget;
+}
+
+std::size_t MeshResidency::getResidentBytes() const {
+    return m_residentBytes;
+}
+
+std::size_t MeshResidency::getEvictedBytes() const {
+    return m_evictedBytes;
+}
+
+void MeshResidency::clear() {
+    m_entries.clear();
+    m_evicted.clear();
+    m_residentBytes = m_evictedBytes = 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+// Keeps count of the GPU memory each Chunk's meshes take up, and decides
+// which meshes to free when there is too much of it. A Chunk that falls
+// out of range is only marked evicted, keeping its meshes; should it come
+// back before they're freed, it can be drawn again at no cost. Once the
+// meshes of every Chunk together pass the budget, those of the evicted
+// Chunks go, least recently evicted first. Meshes in use are never
+// freed, even over budget.
+// Touches no OpenGL state; the caller frees what takeOverBudget() names.
+// The budget is of the meshes' own bytes, so where they are packed into
+// larger buffers, the space those have free is not counted against it.
+class MeshResidency {
+private:
+    struct Entry {
+        std::size_t bytes;
+        bool evicted;
+        std::list<int64_t>::iterator inEvicted; // Only valid while evicted
+    };
+
+    std::unordered_map<int64_t, Entry> m_entries; // By Chunk key
+    std::list<int64_t> m_evicted;   // Least recently evicted first
+    std::size_t m_budget;
+    std::size_t m_residentBytes;    // Of every entry
+    std::size_t m_evictedBytes;     // Of the evicted entries alone
+
+public:
+    MeshResidency(std::size_t budget);
+
+    // The Chunk's meshes were uploaded, taking this many bytes. A Chunk
+    // that was evicted stays evicted.
+    void setBytes(int64_t key, std::size_t bytes);
+    // The Chunk's meshes were freed.
+    void forget(int64_t key);
+    // The Chunk left range. Its meshes stay until the budget needs them.
+    // A Chunk whose meshes are still being built is evicted as soon as
+    // they arrive.
+    void evict(int64_t key);
+    // The Chunk came back into range. Returns whether it still had its
+    // meshes to come back with.
+    bool restore(int64_t key);
+    bool isEvicted(int64_t key) const;
+    // Removes and returns the least recently evicted Chunk canFree
+    // accepts, if the meshes exceed the budget and there is one; else
+    // returns false. Those it turns down keep their place in line.
+    // Call until it returns false, freeing each Chunk's meshes.
+    bool takeOverBudget(int64_t *key, const std::function<bool(int64_t)> &canFree);
+
+    void setBudget(std::size_t budget);
+    std::size_t getBudget() const;
+    std::size_t getResidentBytes() const;
+    std::size_t getEvictedBytes() const;
+    // Forgets every Chunk
+    void clear();
+};
@@ -1,7 +1,9 @@
 #include "mygl.h"
+#include "programcache.h"
 #include "scene/sceneutils.h"
 #include <glm_includes.h>
 
+#include <chrono>
 #include <iostream>
 #include <QApplication>
 #include <QKeyEvent>
@@ -9,20 +11,32 @@
 MyGL::MyGL(QWidget *parent)
     : OpenGLContext(parent),
       m_worldAxes(this),
-      m_progLambert(this), m_progFlat(this), m_progInstanced(this), m_progHexBounds(this), m_progToon(this), m_progSurfaceGlitch(this),
-      m_progHexWalls(this), m_progShadow(this), m_progPostnoOp(this), m_progWater(this), m_progLava(this),
-      m_progGreyscale(this), m_progPostGlitch(this),
-      currentSurfaceShader(nullptr),
-      currentPostProcessShader(nullptr), m_terrain(this),
+      m_progLambert(this), m_progFlat(this), m_progInstanced(this), m_progToon(this), m_progSurfaceGlitch(this),
+      m_progHexWalls(this), m_progShadow(this), m_progFarTerrain(this), m_progDepth(this), m_progOverdraw(this),
+      m_progWeightedBlend(this), m_progToonBlend(this), m_progGlitchBlend(this), m_progTransparencyComposite(this), m_postProcess(this), m_frameUniforms(this),
+      currentSurfaceShader(nullptr), m_blockTextures(this), m_terrain(this),
       m_player(glm::vec3(48.f, 129.f, 48.f), m_terrain),
+      m_farTerrain(this, m_terrain),
+      m_particles(this),
       m_currentMSecsSinceEpoch(QDateTime::currentMSecsSinceEpoch()),
       m_currentSecsPassed(0.f),
+      m_occlusionWorker(m_occlusionBuffer),
+      m_shadowCascadesCached(0),
       m_geomQuad(this),
       m_hex(this, 1.5f),
-      terrainFrameBuffer(this, this->width(), this->height(), this->devicePixelRatio()),
-      hexMapFrameBuffer(this, this->width(), this->height(), this->devicePixelRatio()),
-      overlayFrameBuffer(this, this->width(), this->height(), this->devicePixelRatio()),
-      shadowMapBuffer(this, 2048, 2048, 1.f)
+      m_renderGraph(this),
+      shadowMapBuffer(this, 2048, 2048, 1.f),
+      m_shadowCascades(1),
+      m_shadowPassTimer(this),
+      m_framePassTimer(this),
+      m_shadedSamples(this, GL_SAMPLES_PASSED),
+      m_depthPrePass(true),
+      m_overdrawMode(false),
+      m_quality(14.f),
+      m_frameNumber(0),
+      m_tickMs(0.f),
+      m_launchTime(std::chrono::steady_clock::now()),
+      m_shaderMs(0.f)
 {
     // Connect the timer to a function so that when the timer ticks the function is executed
     connect(&m_timer, SIGNAL(timeout()), this, SLOT(tick()));
@@ -32,11 +46,27 @@ MyGL::MyGL(QWidget *parent)
 
     setMouseTracking(true); // MyGL will track the mouse's movements even if a mouse button is not pressed
     setCursor(Qt::BlankCursor); // Make the cursor invisible
+
+    // How much GPU memory the terrain's meshes may keep, in MB
+    bool validBudget = false;
+    unsigned int budgetMb = qgetenv("MINIMINECRAFT_MESH_BUDGET_MB").toUInt(&validBudget);
+    if (validBudget) {
+        m_terrain.setMeshBudget(std::size_t(budgetMb) << 20);
+    }
 }
 
 MyGL::~MyGL() {
     makeCurrent();
     glDeleteVertexArrays(1, &vao);
+    m_shadowPassTimer.destroy();
+    m_framePassTimer.destroy();
+    m_shadedSamples.destroy();
+    m_terrain.destroyMeshes();
+    m_farTerrain.destroy();
+    m_particles.destroyVBOdata();
+    m_blockTextures.destroy();
+    m_frameUniforms.destroy();
+    m_renderGraph.destroy();
 }
 
 void MyGL::moveMouseToCenter() {
@@ -50,6 +80,8 @@ void MyGL::initializeGL()
     initializeOpenGLFunctions();
     // Print out some information about the current OpenGL context
     debugContextVersion();
+    // Only does anything in diagnostics mode, see main()
+    startDiagnostics();
 
     // Set a few settings/modes in OpenGL rendering
     glEnable(GL_DEPTH_TEST);
@@ -71,41 +103,76 @@ void MyGL::initializeGL()
     //Create the instance of the world axes
     m_worldAxes.createVBOdata();
 
+    // the cube every particle is drawn as
+    m_particles.createVBOdata();
+
     //instantiate the screen-spanning quadrangle used to draw our scene with post-processing pipeline
     m_geomQuad.createVBOdata();        
 
-    //create the frame buffer for post-process shaders (milestone 2)
-    terrainFrameBuffer.create();
-    hexMapFrameBuffer.create();
-    overlayFrameBuffer.create();
+    // the frame buffers for post-process shaders are created by
+    // m_renderGraph once a frame needs them
 
     // create additional frame buffer for shadow mapping (pt 1)
+    shadowMapBuffer.resize(m_shadowCascades.getResolution(), m_shadowCascades.getResolution(), 1.f);
+    shadowMapBuffer.setLayerCount(m_shadowCascades.getCascadeCount());
     shadowMapBuffer.create();
+    m_shadowPassTimer.create();
+    m_framePassTimer.create();
+    m_shadedSamples.create();
 
-    // create surface shaders
-    m_progLambert.create(":/glsl/lambert.vert.glsl",  ":/glsl/lambert.frag.glsl");
-    m_progFlat.create(":/glsl/flat.vert.glsl", ":/glsl/flat.frag.glsl");
-    m_progInstanced.create(":/glsl/instanced.vert.glsl", ":/glsl/lambert.frag.glsl");
-    m_progHexBounds.create(":/glsl/hexbounds.vert.glsl", ":/glsl/hexbounds.frag.glsl");
-    m_progToon.create(":/glsl/hexbounds.vert.glsl", ":/glsl/toon.frag.glsl");
-    m_progSurfaceGlitch.create(":/glsl/glitch.vert.glsl",  ":/glsl/lambert.frag.glsl");
-    m_progHexWalls.create(":/glsl/flat.vert.glsl", ":/glsl/hexwalls.frag.glsl");
-    m_progShadow.create(":/glsl/shadowMap.vert.glsl",  ":/glsl/shadowMap.frag.glsl");
-
-    // create post processing shaders
-    m_progPostnoOp.create(":/glsl/noOp.vert.glsl", ":/glsl/noOp.frag.glsl");
-    m_progWater.create(":/glsl/noOp.vert.glsl", ":/glsl/water.frag.glsl");
-    m_progLava.create(":/glsl/noOp.vert.glsl", ":/glsl/lava.frag.glsl");
-    m_progGreyscale.create(":/glsl/noOp.vert.glsl", ":/glsl/greyscale.frag.glsl");
-    m_progPostGlitch.create(":/glsl/noOp.vert.glsl", ":/glsl/glitch.frag.glsl");
+    // every program reads the per-frame state from here
+    m_frameUniforms.create();
 
+    // Every program is submitted before any is finished, so a driver
+    // with parallel shader compilation can build them all at once.
+    // Programs linked on an earlier launch come from the ProgramCache.
+    auto shaderStart = std::chrono::steady_clock::now();
+    enableParallelShaderCompile();
+
+    // create surface shaders
+    m_progLambert.submit(":/glsl/lambert.vert.glsl",  ":/glsl/lambert.frag.glsl");
+    m_progFlat.submit(":/glsl/flat.vert.glsl", ":/glsl/flat.frag.glsl");
+    m_progInstanced.submit(":/glsl/instanced.vert.glsl", ":/glsl/particle.frag.glsl");
+    m_progToon.submit(":/glsl/hexbounds.vert.glsl", ":/glsl/toon.frag.glsl");
+    m_progSurfaceGlitch.submit(":/glsl/glitch.vert.glsl",  ":/glsl/lambert.frag.glsl");
+    m_progHexWalls.submit(":/glsl/flat.vert.glsl", ":/glsl/hexwalls.frag.glsl");
+    m_progShadow.submit(":/glsl/shadowMap.vert.glsl",  ":/glsl/shadowMap.frag.glsl");
+    m_progFarTerrain.submit(":/glsl/farterrain.vert.glsl", ":/glsl/farterrain.frag.glsl");
+    m_progDepth.submit(":/glsl/depth.vert.glsl", ":/glsl/shadowMap.frag.glsl");
+    m_progOverdraw.submit(":/glsl/lambert.vert.glsl", ":/glsl/overdraw.frag.glsl");
+    m_progWeightedBlend.submit(":/glsl/lambert.vert.glsl", ":/glsl/weightedblend.frag.glsl");
+    m_progToonBlend.submit(":/glsl/hexbounds.vert.glsl", ":/glsl/toonblend.frag.glsl");
+    m_progGlitchBlend.submit(":/glsl/glitch.vert.glsl", ":/glsl/weightedblend.frag.glsl");
+    m_progTransparencyComposite.submit(":/glsl/noOp.vert.glsl", ":/glsl/oitcomposite.frag.glsl");
+    // create post processing shaders up front, so stepping into water
+    // never stalls a frame on compiling one
+    m_postProcess.submitAll();
+
+    m_progLambert.finish();
+    m_progFlat.finish();
+    m_progInstanced.finish();
+    m_progToon.finish();
+    m_progSurfaceGlitch.finish();
+    m_progHexWalls.finish();
+    m_progShadow.finish();
+    m_progFarTerrain.finish();
+    m_progDepth.finish();
+    m_progOverdraw.finish();
+    m_progWeightedBlend.finish();
+    m_progToonBlend.finish();
+    m_progGlitchBlend.finish();
+    m_progTransparencyComposite.finish();
+    m_postProcess.finishAll();
+    m_shaderMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - shaderStart).count();
+
+    m_progFarTerrain.setFarFade(FarTerrain::FADE_WIDTH, FarTerrain::RADIUS);
 
     m_progLambert.setModelMatrix(glm::mat4());
 
-    std::shared_ptr<Texture> minecraftTextures = std::make_shared<Texture>(this);
-    minecraftTextures->create(":/textures/minecraft_textures_all.png");
-    minecraftTextures->load(0);
-    m_textures.push_back(minecraftTextures);
+    m_shadowCascades.update(vec3(m_player.mcr_position.x, 129, m_player.mcr_position.z));
+
+    m_blockTextures.create(":/textures/minecraft_textures_all.png", 16);
+    m_blockTextures.load(0);
 
     // Set a color with which to draw geometry.
     // This will ultimately not be used when you change
@@ -114,7 +181,6 @@ void MyGL::initializeGL()
     // m_progLambert.setGeometryColor(glm::vec4(0,1,0,1));
 
     currentSurfaceShader = &m_progLambert;
-    currentPostProcessShader = &m_progPostnoOp;
 
     // We have to have a VAO bound in OpenGL 3.2 Core. But if we're not
     // using multiple VAOs, we can just bind one once.
@@ -130,36 +196,9 @@ void MyGL::resizeGL(int w, int h) {
     //This code sets the concatenated view and perspective projection matrices used for
     //our scene's camera view.
     m_player.setCameraWidthHeight(static_cast<unsigned int>(w), static_cast<unsigned int>(h));
-    glm::mat4 viewproj = m_player.mcr_camera.getViewProj();
-
-    // Upload the view-projection matrix to our shaders (i.e. onto the graphics card)
 
-    m_progLambert.setViewProjMatrix(viewproj);
-    m_progFlat.setViewProjMatrix(viewproj);
-    m_progHexBounds.setViewProjMatrix(viewproj);
-    m_progToon.setViewProjMatrix(viewproj);
-    m_progSurfaceGlitch.setViewProjMatrix(viewproj);
-    m_progHexWalls.setViewProjMatrix(viewproj);
-
-    terrainFrameBuffer.resize(w, h, 1.);
-    terrainFrameBuffer.destroy();
-    terrainFrameBuffer.create();
-
-    hexMapFrameBuffer.resize(w, h, 1.);
-    hexMapFrameBuffer.destroy();
-    hexMapFrameBuffer.create();
-
-    overlayFrameBuffer.resize(w, h, 1.);
-    overlayFrameBuffer.destroy();
-    overlayFrameBuffer.create();
-
-    m_progLambert.setDimensions(glm::ivec2(w, h));
-    m_progLava.setDimensions(glm::ivec2(w, h));
-    m_progWater.setDimensions(glm::ivec2(w, h));
-    m_progGreyscale.setDimensions(glm::ivec2(w,h));
-    m_progToon.setDimensions(glm::ivec2(w,h));
-    m_progSurfaceGlitch.setDimensions(glm::ivec2(w,h));
-    m_progPostGlitch.setDimensions(glm::ivec2(w,h));
+    // m_renderGraph reallocates its frame buffers when a frame asks
+    // for the new size, so there is nothing else to do here
 
     printGLErrorLog();
 }
@@ -170,23 +209,21 @@ void MyGL::resizeGL(int w, int h) {
 // all per-frame actions here, such as performing physics updates on all
 // entities in the scene.
 void MyGL::tick() {
+    auto tickStart = std::chrono::steady_clock::now();
     float dT = (QDateTime::currentMSecsSinceEpoch() - m_currentMSecsSinceEpoch) / 1000.f;
     m_player.tick(dT, m_inputs);
     m_currentMSecsSinceEpoch = QDateTime::currentMSecsSinceEpoch();
     m_currentSecsPassed = m_currentSecsPassed + dT;
 
-    // compute the MVP matrix from LIGHT_DIRECTION (currently hard-coded)
-    float near_plane = 1.0f, far_plane = 300.f;
-    glm::mat4 depthProjectionMatrix = glm::ortho(-150.0f, 150.0f, -150.0f, 150.0f, near_plane, far_plane);
-
-    glm::vec3 light_position = glm::normalize(glm::vec3(0.5, 1, 0.75)) * 100.f + vec3(m_player.mcr_position.x, 129, m_player.mcr_position.z);
-    glm::mat4 depthViewMatrix = glm::lookAt(glm::vec3(light_position), vec3(m_player.mcr_position.x, 129, m_player.mcr_position.z), glm::vec3(0,1,0));
-    glm::mat4 depthMVP = depthProjectionMatrix * depthViewMatrix;
-    m_depthMVP = depthMVP;
-    m_progLambert.setDepthMVP(m_depthMVP);
-    m_progShadow.setDepthMVP(m_depthMVP);
-
     m_terrain.multithreadedWork(m_player.mcr_position, m_player.mcr_prevPos, dT);
+    m_farTerrain.update(m_player.mcr_position);
+
+    if (m_player.playerInBlockType(m_terrain) == WATER) {
+        m_particles.emitBubbles(m_player.mcr_camera.mcr_position, dT);
+    }
+    m_particles.emitSparks(m_terrain, m_player.mcr_position, dT);
+    m_particles.update(dT);
+    m_tickMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - tickStart).count();
 
     update(); // Calls paintGL() as part of a larger QOpenGLWidget pipeline
     sendPlayerDataToGUI(); // Updates the info in the secondary window displaying player data
@@ -202,40 +239,66 @@ void MyGL::sendPlayerDataToGUI() const {
     glm::ivec2 zone(64 * glm::ivec2(glm::floor(pPos / 64.f)));
     emit sig_sendPlayerChunk(QString::fromStdString("( " + std::to_string(chunk.x) + ", " + std::to_string(chunk.y) + " )"));
     emit sig_sendPlayerTerrainZone(QString::fromStdString("( " + std::to_string(zone.x) + ", " + std::to_string(zone.y) + " )"));
+    emit sig_sendTerrainPassStats(QString::fromStdString(std::to_string(m_terrainPassStats.drawn) + " drawn, " +
+                                                         std::to_string(m_terrainPassStats.culled) + " culled, " +
+                                                         std::to_string(m_terrainPassStats.occluded) + " occluded, " +
+                                                         std::to_string(m_terrainPassStats.unreachable) + " unreachable, " +
+                                                         std::to_string(m_terrainPassStats.drawCalls) + " draw calls, " +
+                                                         QString::asprintf("%.2fx overdraw%s", overdraw(),
+                                                                           m_depthPrePass ? "" : " (no pre-pass)").toStdString() + ", " +
+                                                         meshMemoryStats().toStdString()));
+    emit sig_sendShadowPassStats(QString::asprintf("%d drawn, %d culled, %d/%d cached, %.2f ms GPU",
+                                                   m_shadowPassStats.drawn, m_shadowPassStats.culled,
+                                                   m_shadowCascadesCached, m_shadowCascades.getCascadeCount(),
+                                                   m_shadowPassTimer.getAverageMs()));
+    emit sig_sendQualityStats(QString::asprintf("%s%s, %.1f / %.1f ms", m_quality.getSettings().name,
+                                                m_quality.isAutomatic() ? "" : " (fixed)",
+                                                m_quality.getAverageMs(), m_quality.getTargetMs()));
 }
 
 // This function is called whenever update() is called.
 // MyGL's constructor links update() to a timer that fires 60 times per second,
 // so paintGL() called at a rate of 60 frames per second.
 void MyGL::paintGL() {
+    auto paintStart = std::chrono::steady_clock::now();
+
     // Clear the screen so that we only see newly drawn images
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    m_progFlat.setViewProjMatrix(m_player.mcr_camera.getViewProj());
-    m_progLambert.setViewProjMatrix(m_player.mcr_camera.getViewProj());
-    m_progInstanced.setViewProjMatrix(m_player.mcr_camera.getViewProj());
-    m_progHexBounds.setViewProjMatrix(m_player.mcr_camera.getViewProj());
-    m_progToon.setViewProjMatrix(m_player.mcr_camera.getViewProj());
-    m_progSurfaceGlitch.setViewProjMatrix(m_player.mcr_camera.getViewProj());
-    m_progHexWalls.setViewProjMatrix(m_player.mcr_camera.getViewProj());
-
-    renderHexMap();
-    performShadowMapPass();
-    renderTerrain();
-    performPostprocessRenderPass();
-    performTimelineRenderPass();
+    if (isShadowUpdateFrame()) {
+        // move the shadow cascades along with the player (in texel-snapped steps)
+        m_shadowCascades.update(vec3(m_player.mcr_position.x, 129, m_player.mcr_position.z));
+    }
+    // Once, for every program and pass of the frame
+    updateFrameUniforms();
+
+    // The occlusion buffer is rasterised on a worker thread while the shadow map is drawn
+    startOcclusionPass();
+    m_renderGraph.reset();
+    declareRenderGraph();
+    m_renderGraph.execute();
+    m_framePassTimer.end();
+
+    // The frame is as slow as the slower of the CPU and the GPU
+    float cpuMs = m_tickMs + std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - paintStart).count();
+    float gpuMs = m_shadowPassTimer.getAverageMs() + m_framePassTimer.getAverageMs();
+    if (m_quality.addFrame(std::max(cpuMs, gpuMs))) {
+        applyQualityLevel();
+    }
+    if (m_frameNumber == 0) {
+        reportFirstFrame();
+    }
+    m_frameNumber++;
+}
 
-    // bind minecraft block textures to texSlot 0 & pass to GPU
-    m_textures.at(0)->bind(0);
-    m_progFlat.setTextureSampler2D(0);
-
-    // draws the world axis
-    glDisable(GL_DEPTH_TEST);
-    m_progFlat.setModelMatrix(glm::mat4());
-    m_progHexWalls.setModelMatrix(glm::mat4());
-    m_progFlat.setViewProjMatrix(m_player.mcr_camera.getViewProj());
-    m_progFlat.draw(m_worldAxes);
-    glEnable(GL_DEPTH_TEST);
+void MyGL::reportFirstFrame() {
+    // Wait for the GPU, so the time is to the frame actually being drawn
+    glFinish();
+    float firstFrameMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_launchTime).count();
+    const ProgramCache &cache = getProgramCache();
+    int programs = cache.getHits() + cache.getMisses();
+    printf("First frame after %.0f ms (shader programs %.0f ms, %d of %d from the binary cache)\n",
+           firstFrameMs, m_shaderMs, cache.getHits(), programs);
 }
 
 void MyGL::setSurfaceShader() {
@@ -250,131 +313,410 @@ void MyGL::setSurfaceShader() {
         currentSurfaceShader = &m_progLambert; break;
         }
     }
-    currentSurfaceShader->setTime(m_currentSecsPassed);
 }
 
-void MyGL::setPostProcessShader(bool timelinePass) {
-    if(timelinePass) {
-        switch(m_hex.getCurrentTimeline()) {
-            case(TIMELINE_60S) : {
-                currentPostProcessShader = &m_progGreyscale; break;
-            }
-            case(TIMELINE_DYSTOPIAN) : {
-            currentPostProcessShader = &m_progPostGlitch; break;
-            }
-            default : {
-                currentPostProcessShader = &m_progPostnoOp; break;
-            }
+MediumEffect MyGL::currentMediumEffect() {
+    switch(m_player.playerInBlockType(m_terrain)) {
+        case(WATER) : return MediumEffect::WATER;
+        case(LAVA) : return MediumEffect::LAVA;
+        default : return MediumEffect::NONE;
+    }
+}
+
+TimelineEffect MyGL::currentTimelineEffect() const {
+    switch(m_hex.getCurrentTimeline()) {
+        case(TIMELINE_60S) : return TimelineEffect::GREYSCALE;
+        case(TIMELINE_DYSTOPIAN) : return TimelineEffect::GLITCH;
+        default : return TimelineEffect::NONE;
+    }
+}
+
+void MyGL::declareRenderGraph()
+{
+    RenderGraph::Resource screen = m_renderGraph.getScreen();
+    RenderGraph::Resource shadowMap = m_renderGraph.importResource("Shadow map");
+
+    MediumEffect medium = currentMediumEffect();
+    TimelineEffect timeline = currentTimelineEffect();
+    // The timeline effect only shows inside the hex
+    if (m_hex.getHexRadius() <= 0.f) {
+        timeline = TimelineEffect::NONE;
+    }
+    // Nothing may tint the overdraw counts
+    if (m_overdrawMode) {
+        medium = MediumEffect::NONE;
+        timeline = TimelineEffect::NONE;
+    }
+    bool postProcess = medium != MediumEffect::NONE || timeline != TimelineEffect::NONE;
+
+    // The overdraw mode draws transparent faces along with the rest.
+    // Otherwise the transparency passes, and the scene target they need,
+    // are only declared with some transparent face in view.
+    ivec4 bounds = terrainDrawBounds();
+    bool transparency = !m_overdrawMode &&
+        m_terrain.hasTransparentInView(bounds.x, bounds.z, bounds.y, bounds.w,
+                                       Frustum(m_player.mcr_camera.getViewProj()));
+
+    ivec2 size = renderSize();
+    ivec2 screenSize = ivec2(vec2(this->width(), this->height()) * float(this->devicePixelRatio()));
+    // With nothing to do to the terrain once it's drawn, it may as well
+    // be drawn straight to the screen. The transparency pass needs the
+    // scene's depth, though, which the screen's may not match the format of.
+    RenderGraph::Resource scene = screen;
+    if (postProcess || transparency || size != screenSize) {
+        // Only the timeline effect reads the hex mask
+        scene = m_renderGraph.createTarget("Scene", {unsigned(size.x), unsigned(size.y),
+                                                     timeline != TimelineEffect::NONE, true, false});
+    }
+
+    m_renderGraph.addPass("Shadow map pass", {}, {shadowMap}, [this]() {
+        performShadowMapPass();
+    });
+
+    m_renderGraph.addPass("Terrain pass", {shadowMap}, {scene}, [this, scene, transparency]() {
+        m_framePassTimer.begin();
+        m_occlusionWorker.wait();
+        m_renderGraph.bindTarget(scene);
+        if (m_overdrawMode) {
+            glClearColor(0.f, 0.f, 0.f, 1.f);
         }
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glClearColor(0.37f, 0.74f, 1.0f, 1);
+        renderTerrain();
+        // Otherwise drawn over the water by the composite pass
+        if (!transparency && !m_overdrawMode) {
+            drawHex();
+        }
+    });
+
+    if (transparency) {
+        // Accumulation in the colour texture, revealage in the mask
+        RenderGraph::Resource transparent =
+            m_renderGraph.createTarget("Transparency", {unsigned(size.x), unsigned(size.y), true, true, true});
+        m_renderGraph.addPass("Transparency pass", {scene}, {transparent}, [this, scene, transparent, size]() {
+            // A copy of the opaque terrain's depth, for the transparent
+            // faces to be tested against
+            m_renderGraph.bindTarget(transparent);
+            m_renderGraph.getTarget(scene).bindFrameBuffer(GL_READ_FRAMEBUFFER);
+            glBlitFramebuffer(0, 0, size.x, size.y, 0, 0, size.x, size.y, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+            renderTransparency();
+        });
+        m_renderGraph.addPass("Transparency composite pass", {transparent}, {scene}, [this, scene, transparent]() {
+            m_renderGraph.getTarget(transparent).bindToTextureSlot(OVERLAY_FRAME_BUFFER_TEXTURE_SLOT);
+            m_renderGraph.getTarget(transparent).bindMaskToTextureSlot(HEXMAP_FRAME_BUFFER_TEXTURE_SLOT);
+            m_renderGraph.bindTarget(scene);
+            glDisable(GL_DEPTH_TEST);
+            m_progTransparencyComposite.draw(m_geomQuad, OVERLAY_FRAME_BUFFER_TEXTURE_SLOT,
+                                             HEXMAP_FRAME_BUFFER_TEXTURE_SLOT);
+            glEnable(GL_DEPTH_TEST);
+            // The hex walls blend over everything, water included
+            drawHex();
+        });
     }
-    else {
-        BlockType playerInBlockType = m_player.playerInBlockType(m_terrain);
-        switch(playerInBlockType) {
-            case(WATER) : {
-                currentPostProcessShader = &m_progWater; break;
-            }
-            case(LAVA) : {
-                currentPostProcessShader = &m_progLava; break;
-            }
-            default : {
-                currentPostProcessShader = &m_progPostnoOp; break;
+
+    if (postProcess) {
+        RenderGraph::Resource input = scene;
+        unsigned int inputSlot = TERRAIN_FRAME_BUFFER_TEXTURE_SLOT;
+        if (medium != MediumEffect::NONE) {
+            // Skipped by the graph unless the post process pass reads it,
+            // which it only does if the two effects can't be fused
+            RenderGraph::Resource mediumTarget =
+                m_renderGraph.createTarget("Medium", {unsigned(size.x), unsigned(size.y), false, false, false});
+            m_renderGraph.addPass("Medium pass", {scene}, {mediumTarget}, [this, scene, mediumTarget, medium]() {
+                m_renderGraph.getTarget(scene).bindToTextureSlot(TERRAIN_FRAME_BUFFER_TEXTURE_SLOT);
+                m_renderGraph.bindTarget(mediumTarget);
+                m_postProcess.getProgram(medium, TimelineEffect::NONE)->draw(m_geomQuad, TERRAIN_FRAME_BUFFER_TEXTURE_SLOT);
+            });
+            if (!PostProcessComposer::canFuse(medium, timeline)) {
+                input = mediumTarget;
+                inputSlot = OVERLAY_FRAME_BUFFER_TEXTURE_SLOT;
+                medium = MediumEffect::NONE;
             }
         }
+        m_renderGraph.addPass("Post process pass", {scene, input}, {screen},
+                              [this, scene, input, inputSlot, medium, timeline, screen]() {
+            if (timeline != TimelineEffect::NONE) {
+                m_renderGraph.getTarget(scene).bindMaskToTextureSlot(HEXMAP_FRAME_BUFFER_TEXTURE_SLOT);
+            }
+            m_renderGraph.getTarget(input).bindToTextureSlot(inputSlot);
+            m_renderGraph.bindTarget(screen);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            m_postProcess.getProgram(medium, timeline)->draw(m_geomQuad, inputSlot, HEXMAP_FRAME_BUFFER_TEXTURE_SLOT);
+        });
+    } else if (scene != screen) {
+        // Drawn smaller than the screen by the QualityGovernor
+        m_renderGraph.addPass("Upscale pass", {scene}, {screen}, [this, scene, size, screenSize]() {
+            m_renderGraph.getTarget(scene).bindFrameBuffer();
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->defaultFramebufferObject());
+            glBlitFramebuffer(0, 0, size.x, size.y, 0, 0, screenSize.x, screenSize.y, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        });
     }
-    currentPostProcessShader->setTime(m_currentSecsPassed);
+
+    m_renderGraph.addPass("Axes pass", {}, {screen}, [this, screen]() {
+        m_renderGraph.bindTarget(screen);
+        // draws the world axis
+        glDisable(GL_DEPTH_TEST);
+        m_progFlat.setModelMatrix(glm::mat4());
+        m_progHexWalls.setModelMatrix(glm::mat4());
+        m_progFlat.draw(m_worldAxes);
+        glEnable(GL_DEPTH_TEST);
+    });
 }
 
-void frameBufferSetup(FrameBuffer &frameBuffer, int w, int h, unsigned int textureSlot) {
-    // Render to our framebuffer rather than the viewport
-    frameBuffer.bindFrameBuffer();
-    // Render on the whole framebuffer, complete from the lower left corner to the upper right
-    glViewport(0,0,w,h);
-    // Clear the screen so that we only see newly drawn images
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    frameBuffer.bindToTextureSlot(textureSlot);
+void MyGL::renderTerrain() {
+    setSurfaceShader();
+    if (m_overdrawMode) {
+        // Each fragment adds to the pixel beneath it; only the loaded
+        // Chunks are drawn, as they are what the pre-pass is for
+        glBlendFunc(GL_ONE, GL_ONE);
+        m_terrainPassStats = drawTerrain(&m_progOverdraw);
+        m_terrainPassStats.drawCalls += m_terrain.drawTransparent(&m_progOverdraw);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        return;
+    }
+    // bind minecraft block textures to texSlot 0 & pass to GPU
+    m_blockTextures.bind(0);
+    shadowMapBuffer.bindToDepthTexture(SHADOW_MAP_TEXTURE_SLOT);
+    drawFarTerrain();
+    m_terrainPassStats = drawTerrain(currentSurfaceShader);
+    // The particles write depth, so the transparency pass leaves out
+    // whatever water lies behind them
+    pushDebugGroup("Particles");
+    m_particles.draw(&m_progInstanced);
+    popDebugGroup();
 }
 
-void MyGL::renderHexMap() {
-    frameBufferSetup(hexMapFrameBuffer, this->width(), this->height(), HEXMAP_FRAME_BUFFER_TEXTURE_SLOT);
-    drawTerrain(&m_progHexBounds);
+void MyGL::renderTransparency() {
+    GLfloat noColor[4] = {0.f, 0.f, 0.f, 0.f};
+    GLfloat allRevealed[4] = {1.f, 1.f, 1.f, 1.f};
+    glClearBufferfv(GL_COLOR, 0, noColor);
+    glClearBufferfv(GL_COLOR, 1, allRevealed);
+
+    // Sums and products, which come out the same in any order. The
+    // depth test still hides the faces behind the opaque terrain.
+    glDepthMask(GL_FALSE);
+    glBlendFunci(0, GL_ONE, GL_ONE);
+    glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+    // The variant of the surface shader that writes to the accumulation
+    // targets, so water is shaded like the ground in every timeline
+    SurfaceShader *blendProgram = &m_progWeightedBlend;
+    if (currentSurfaceShader == &m_progToon) {
+        blendProgram = &m_progToonBlend;
+    } else if (currentSurfaceShader == &m_progSurfaceGlitch) {
+        blendProgram = &m_progGlitchBlend;
+    }
+    m_terrainPassStats.drawCalls += m_terrain.drawTransparent(blendProgram);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_TRUE);
 }
 
+DrawStats MyGL::drawTerrain(SurfaceShader* surfaceShader) {
+    ivec4 bounds = terrainDrawBounds();
+    Frustum frustum(m_player.mcr_camera.getViewProj());
+    m_terrain.findVisibleSections(bounds.x, bounds.z, bounds.y, bounds.w,
+                                  m_player.mcr_camera.mcr_position, frustum, m_visibleSections);
+    // The glitch shader displaces vertices inside the hex, so its depths
+    // would never match the pre-pass's
+    SurfaceShader *depthProgram = nullptr;
+    if (m_depthPrePass && surfaceShader != &m_progSurfaceGlitch) {
+        depthProgram = &m_progDepth;
+    }
+    return m_terrain.draw(bounds.x, bounds.z, bounds.y, bounds.w, surfaceShader,
+                          frustum, &m_occlusionBuffer, &m_visibleSections, depthProgram, &m_shadedSamples);
+}
 
-void MyGL::renderTerrain() {
-    setSurfaceShader();
-    frameBufferSetup(terrainFrameBuffer, this->width(), this->height(), TERRAIN_FRAME_BUFFER_TEXTURE_SLOT);
-    shadowMapBuffer.bindToDepthTexture(SHADOW_MAP_TEXTURE_SLOT);
-    drawTerrain(currentSurfaceShader);
-    drawHex();
+void MyGL::drawFarTerrain() {
+    ivec4 nearBounds = terrainDrawBounds();
+    m_progFarTerrain.setNearBounds(vec4(nearBounds));
+    m_farTerrain.draw(&m_progFarTerrain, Frustum(m_player.mcr_camera.getViewProj()), nearBounds);
 }
 
-void MyGL::drawTerrain(SurfaceShader* surfaceShader) {
-    ivec2 currZone(64 * floor(m_player.mcr_position.x / 64.f),
-                   64 * floor(m_player.mcr_position.z / 64.f));
-    m_terrain.draw(currZone.x - 128, currZone.x + 192, currZone.y - 128, currZone.y + 192, surfaceShader);
+void MyGL::startOcclusionPass() {
+    ivec4 bounds = terrainDrawBounds();
+    glm::mat4 viewProj = m_player.mcr_camera.getViewProj();
+
+    // Only nearby Chunks make occluders worth their cost; far away
+    // they cover too few pixels to hide anything
+    std::vector<OccluderBox> occluders;
+    m_terrain.gatherOccluders(bounds.x, bounds.z, bounds.y, bounds.w,
+                              Frustum(viewProj), m_player.mcr_camera.mcr_position, 96.f, occluders);
+
+    // The worker only reads its own copy of the occluders, never the Terrain
+    m_occlusionWorker.start(viewProj, std::move(occluders));
 }
 
 void MyGL::castHex() {
     //update Hex attributes
     m_hex.resetHexAttributes(m_player.mcr_position.x, m_player.mcr_position.z, m_currentSecsPassed);
     m_hex.cycleTimeline();
-
-    //set the corresponding updated shader attributes
-    m_progHexBounds.setHexCenter(m_hex.getHexCenter());
-    m_progToon.setHexCenter(m_hex.getHexCenter());
-    m_progSurfaceGlitch.setHexCenter(m_hex.getHexCenter());
-    currentSurfaceShader->setHexCenter(m_hex.getHexCenter());
 }
 
 void MyGL::drawHex() {
     if(m_hex.canHexStillGrow(m_currentSecsPassed)) {
         m_hex.destroyVBOdata();
         m_hex.demarcateHexBoundaries(m_currentSecsPassed);
-        m_progHexBounds.setHexRadius(m_hex.getHexRadius());
-        m_progToon.setHexRadius(m_hex.getHexRadius());
-        m_progSurfaceGlitch.setHexRadius(m_hex.getHexRadius());
-        currentSurfaceShader->setHexRadius(m_hex.getHexRadius());
         m_hex.createVBOdata();
     }
-    m_progHexWalls.setTime(m_currentSecsPassed);
-    m_progHexWalls.draw(m_hex);
+    // Nothing to draw until the hex starts to grow
+    if(m_hex.getHexRadius() > 0.f) {
+        m_progHexWalls.draw(m_hex);
+    }
 }
 
-void MyGL::performPostprocessRenderPass()
+void MyGL::performShadowMapPass()
 {
-    setPostProcessShader(false);
-    frameBufferSetup(overlayFrameBuffer, this->width(), this->height(), OVERLAY_FRAME_BUFFER_TEXTURE_SLOT);
-    currentPostProcessShader->draw(m_geomQuad, TERRAIN_FRAME_BUFFER_TEXTURE_SLOT);
+    m_shadowPassTimer.begin();
+
+    ivec2 currZone(64 * floor(m_player.mcr_position.x / 64.f),
+                   64 * floor(m_player.mcr_position.z / 64.f));
+    ivec4 bounds = terrainDrawBounds();
+    int minX = bounds.x, maxX = bounds.z;
+    int minZ = bounds.y, maxZ = bounds.w;
+    uint64_t meshVersion = m_terrain.getMeshVersion();
+
+    bool skipUpdate = !isShadowUpdateFrame();
+
+    m_shadowPassStats = DrawStats();
+    m_shadowCascadesCached = 0;
+    for (int i = 0; i < m_shadowCascades.getCascadeCount(); i++) {
+        const ShadowCascade &cascade = m_shadowCascades.getCascade(i);
+        Frustum frustum(cascade.viewProj);
+
+        // Keep the cascade's layer from an earlier frame unless its box has
+        // moved a step or a Chunk it can see has been (re)meshed since
+        if (skipUpdate && cascade.rendered) {
+            m_shadowCascadesCached++;
+            continue;
+        }
+        if (!m_shadowCascades.isStale(i, currZone) &&
+            !m_terrain.hasMeshChangesSince(cascade.renderedMeshVersion, minX, maxX, minZ, maxZ, frustum)) {
+            m_shadowCascadesCached++;
+            continue;
+        }
+
+        shadowMapBuffer.bindFrameBuffer(i);
+        // Render on the whole framebuffer, complete from the lower left corner to the upper right
+        glViewport(0, 0, m_shadowCascades.getResolution(), m_shadowCascades.getResolution());
+
+        // Clear the screen
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        // render scene, culled against this cascade's box rather than the camera's frustum
+        m_progShadow.setShadowCascade(i);
+        pushDebugGroup(QString::asprintf("Cascade %d", i));
+        DrawStats stats = m_terrain.draw(minX, maxX, minZ, maxZ, &m_progShadow, frustum);
+        m_terrain.drawTransparent(&m_progShadow);
+        popDebugGroup();
+        m_shadowPassStats.drawn += stats.drawn;
+        m_shadowPassStats.culled += stats.culled;
+
+        m_shadowCascades.markRendered(i, currZone, meshVersion);
+    }
+
+    m_shadowPassTimer.end();
+
+    // Bind our texture in the requisite texture slot
+    shadowMapBuffer.bindToDepthTexture(SHADOW_MAP_TEXTURE_SLOT);
+
+    // pass created shadowMap to the lambert shader for actual rendering frfr this time
+    m_progLambert.setShadowMapDepthTexture(SHADOW_MAP_TEXTURE_SLOT);
+    m_progWeightedBlend.setShadowMapDepthTexture(SHADOW_MAP_TEXTURE_SLOT);
+    m_progGlitchBlend.setShadowMapDepthTexture(SHADOW_MAP_TEXTURE_SLOT);
 }
 
-void MyGL::performTimelineRenderPass()
+void MyGL::cycleShadowCascades()
 {
-    setPostProcessShader(true);
-    glBindFramebuffer(GL_FRAMEBUFFER, this->defaultFramebufferObject());
-    glViewport(0,0,this->width() * this->devicePixelRatio(), this->height() * this->devicePixelRatio());
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    currentPostProcessShader->draw(m_geomQuad, OVERLAY_FRAME_BUFFER_TEXTURE_SLOT, HEXMAP_FRAME_BUFFER_TEXTURE_SLOT);
+    m_shadowCascades.setCascadeCount(m_shadowCascades.getCascadeCount() % ShadowCascades::MAX_CASCADES + 1);
+    recreateShadowMap();
 }
 
-void MyGL::performShadowMapPass()
+void MyGL::recreateShadowMap()
 {
-    shadowMapBuffer.bindFrameBuffer();
-    // Render on the whole framebuffer, complete from the lower left corner to the upper right
-    glViewport(0, 0, 2048, 2048);
+    m_shadowCascades.update(vec3(m_player.mcr_position.x, 129, m_player.mcr_position.z));
 
-    // Clear the screen
-    glClear(GL_DEPTH_BUFFER_BIT);
+    makeCurrent();
+    shadowMapBuffer.destroy();
+    shadowMapBuffer.resize(m_shadowCascades.getResolution(), m_shadowCascades.getResolution(), 1.f);
+    shadowMapBuffer.setLayerCount(m_shadowCascades.getCascadeCount());
+    shadowMapBuffer.create();
+}
 
-    // render scene
+void MyGL::cycleQualityLevel()
+{
+    if (m_quality.isAutomatic()) {
+        m_quality.setFixedLevel(0);
+    } else if (m_quality.getLevel() == QualityGovernor::LEVEL_COUNT - 1) {
+        m_quality.setAutomatic();
+    } else {
+        m_quality.setFixedLevel(m_quality.getLevel() + 1);
+    }
+    applyQualityLevel();
+}
+
+int MyGL::getQualityLevel() const
+{
+    return m_quality.getLevel();
+}
+
+float MyGL::overdraw() const
+{
+    ivec2 size = renderSize();
+    return m_shadedSamples.getAverage() / (size.x * size.y);
+}
+
+QString MyGL::meshMemoryStats() const
+{
+    const MeshResidency &residency = m_terrain.getMeshResidency();
+    const double mb = 1 << 20;
+    return QString::asprintf("%.0f / %.0f MB meshes (%.0f MB kept out of view, %.0f MB of pages)",
+                             residency.getResidentBytes() / mb, residency.getBudget() / mb,
+                             residency.getEvictedBytes() / mb, m_terrain.getMeshPageBytes() / mb);
+}
+
+glm::ivec4 MyGL::terrainDrawBounds() const
+{
     ivec2 currZone(64 * floor(m_player.mcr_position.x / 64.f),
                    64 * floor(m_player.mcr_position.z / 64.f));
-    m_terrain.draw(currZone.x - 128, currZone.x + 192, currZone.y - 128, currZone.y + 192, &m_progShadow);
+    int radius = 64 * m_quality.getSettings().renderRadius;
+    return ivec4(currZone.x - radius, currZone.y - radius, currZone.x + 64 + radius, currZone.y + 64 + radius);
+}
 
-    // Bind our texture in the requisite texture slot
-    shadowMapBuffer.bindToDepthTexture(SHADOW_MAP_TEXTURE_SLOT);
+glm::ivec2 MyGL::renderSize() const
+{
+    vec2 size = vec2(this->width(), this->height()) * m_quality.getSettings().renderScale;
+    return glm::max(ivec2(glm::round(size)), ivec2(1));
+}
 
-    // pass created shadowMap to the lambert shader for actual rendering frfr this time
-    m_progLambert.setShadowMapDepthTexture(SHADOW_MAP_TEXTURE_SLOT);
+bool MyGL::isShadowUpdateFrame() const
+{
+    return m_frameNumber % m_quality.getSettings().shadowInterval == 0;
+}
+
+void MyGL::updateFrameUniforms()
+{
+    FrameUniforms::Data &data = m_frameUniforms.data;
+    data.viewProj = m_player.mcr_camera.getViewProj();
+    std::vector<glm::mat4> cascades = m_shadowCascades.getViewProjs();
+    std::copy(cascades.begin(), cascades.end(), data.cascadeMVP);
+    data.cascadeCount = cascades.size();
+    data.camera = m_player.mcr_camera.mcr_position;
+    data.time = m_currentSecsPassed;
+    data.hexCenter = m_hex.getHexCenter();
+    data.hexRadius = m_hex.getHexRadius();
+    data.dimensions = renderSize();
+    m_frameUniforms.upload();
+}
+
+void MyGL::applyQualityLevel()
+{
+    // The frame buffers follow renderSize() on their own, see RenderGraph.
+    // Setting the divisor also marks every cascade as needing to be
+    // rendered, as the terrain draw area may have changed
+    unsigned int shadowResolution = m_shadowCascades.getResolution();
+    m_shadowCascades.setResolutionDivisor(m_quality.getSettings().shadowDivisor);
+    if (m_shadowCascades.getResolution() != shadowResolution) {
+        recreateShadowMap();
+    }
 }
 
 void MyGL::keyPressEvent(QKeyEvent *e) {
@@ -411,6 +753,14 @@ void MyGL::keyPressEvent(QKeyEvent *e) {
         //std::cout << "toggled flightMode " << (m_inputs.flightMode ? "ON" : "OFF") << std::endl;
     } else if (e->key() == Qt::Key_Space) {
         m_inputs.spacePressed = true;
+    } else if (e->key() == Qt::Key_C) {
+        cycleShadowCascades();
+    } else if (e->key() == Qt::Key_G) {
+        cycleQualityLevel();
+    } else if (e->key() == Qt::Key_P) {
+        m_depthPrePass = !m_depthPrePass;
+    } else if (e->key() == Qt::Key_O) {
+        m_overdrawMode = !m_overdrawMode;
     } else if(e->key() == Qt::Key_H) {
         m_hex.updateGrowSpeed(50.f);
         castHex();
@@ -461,7 +811,11 @@ void MyGL::mouseMoveEvent(QMouseEvent *e) {
 void MyGL::mousePressEvent(QMouseEvent *e) {
     if (e->button() == Qt::LeftButton) {
         // left click - remove block
-        m_player.removeBlock(&m_terrain);
+        ivec3 block;
+        BlockType removed = m_player.removeBlock(&m_terrain, &block);
+        if (removed != EMPTY) {
+            m_particles.emitDebris(block, removed);
+        }
     } else if (e->button() == Qt::RightButton) {
         // right click - place block
         m_player.placeBlock(&m_terrain, GRASS);
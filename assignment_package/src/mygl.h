@@ -1,8 +1,15 @@
 #pragma once
 #include "framebuffer.h"
-#include "postprocessshader.h"
+#include "frameuniforms.h"
+#include "gputimer.h"
+#include "postprocesscomposer.h"
+#include "qualitygovernor.h"
+#include "rendergraph.h"
 #include "scene/hex.h"
+#include "scene/occlusionworker.h"
+#include "scene/particlesystem.h"
 #include "scene/quad.h"
+#include "shadowcascades.h"
 #include "surfaceshader.h"
 #ifndef MYGL_H
 #define MYGL_H
@@ -13,6 +20,7 @@
 #include "scene/camera.h"
 #include "scene/terrain.h"
 #include "scene/player.h"
+#include "scene/farterrain.h"
 #include "texture.h"
 
 #include <QOpenGLVertexArrayObject>
@@ -20,6 +28,7 @@
 #include <smartpointerhelp.h>
 #include <qdatetime.h>
 
+#include <chrono>
 #include <thread>
 
 class MyGL : public OpenGLContext
@@ -31,22 +40,24 @@ private:
     SurfaceShader m_progLambert;// A shader program that uses lambertian reflection
     SurfaceShader m_progFlat;// A shader program that uses "flat" reflection (no shadowing at all)
     SurfaceShader m_progInstanced;// A shader program that is designed to be compatible with instanced rendering
-    SurfaceShader m_progHexBounds; // A shader program to calculate the black-and-white hex layout map to be sent to a separate frame buffer
     SurfaceShader m_progToon; // A shader program for the 80s timeline
     SurfaceShader m_progSurfaceGlitch; //A shader program for the dystopian timeline
     SurfaceShader m_progHexWalls; //A shader program to draw the hex walls
     SurfaceShader m_progShadow;// A shader program that is designed to calculate the parts of terrain in shadow
+    SurfaceShader m_progFarTerrain; // A shader program that draws the far terrain's biome-coloured heightmap
+    SurfaceShader m_progDepth; // A shader program that only writes the terrain's depth, for the depth pre-pass
+    SurfaceShader m_progOverdraw; // A shader program that counts how often each pixel of terrain is shaded
+    SurfaceShader m_progWeightedBlend; // A shader program that accumulates the terrain's transparent faces, in any order
+    SurfaceShader m_progToonBlend; // m_progWeightedBlend's counterpart for the 80s timeline
+    SurfaceShader m_progGlitchBlend; // m_progWeightedBlend's counterpart for the dystopian timeline
+    PostProcessShader m_progTransparencyComposite; // A shader program that lays those faces over the scene
 
-    PostProcessShader m_progPostnoOp; // A shader program for pass-through post processing
-    PostProcessShader m_progWater; // A shader program to apply the post-processing underwater effect
-    PostProcessShader m_progLava; // A shader program to apply the post-processing lava effect
-    PostProcessShader m_progGreyscale; // A shader program for the 60s timeline    
-    PostProcessShader m_progPostGlitch; // A shader program for the dystopian timeline
+    PostProcessComposer m_postProcess; // The post processing programs, one per pair of medium and timeline effects
+    FrameUniforms m_frameUniforms; // The camera, shadow cascades, time and hex, shared by every program
 
     SurfaceShader* currentSurfaceShader;
-    PostProcessShader* currentPostProcessShader;
 
-    std::vector<std::shared_ptr<Texture>> m_textures;
+    TextureArray m_blockTextures; // Every block texture, one per layer, each with its own mip chain
     Texture* mp_texCurrent;
 
     GLuint vao; // A handle for our vertex array object. This will store the VBOs created in our geometry classes.
@@ -54,23 +65,44 @@ private:
 
     Terrain m_terrain; // All of the Chunks that currently comprise the world.
     Player m_player; // The entity controlled by the user. Contains a camera to display what it sees as well.
+    FarTerrain m_farTerrain; // A coarse heightmap of the world beyond the loaded Chunks, out to the horizon.
+    ParticleSystem m_particles; // Block-break debris, lava sparks and underwater bubbles, drawn by m_progInstanced
     InputBundle m_inputs; // A collection of variables to be updated in keyPressEvent, mouseMoveEvent, mousePressEvent, etc.
 
     QTimer m_timer; // Timer linked to tick(). Fires approximately 60 times per second.
     qint64 m_currentMSecsSinceEpoch;
     float m_currentSecsPassed;
 
-    glm::mat4 m_depthMVP; // depthMVP used for shadow mapping
     glm::mat4 m_depthBiasMVP; // depthBiasMVP used for shadow mapping
 
+    OcclusionBuffer m_occlusionBuffer; // Depth of the nearby terrain's occluders, seen from the camera
+    OcclusionWorker m_occlusionWorker; // Fills m_occlusionBuffer on a thread of its own
+    VisibleSections m_visibleSections; // Chunk sections reachable from the camera's section
+
+    DrawStats m_terrainPassStats; // Sections drawn/culled by the last camera pass over the terrain
+    DrawStats m_shadowPassStats;  // Sections drawn/culled by the last shadow map pass
+    int m_shadowCascadesCached;   // Cascades the last shadow map pass could reuse as they were
+
     Quad m_geomQuad;
     Hex m_hex;
 
-    FrameBuffer terrainFrameBuffer;
-    FrameBuffer hexMapFrameBuffer;
-    FrameBuffer overlayFrameBuffer;
+    RenderGraph m_renderGraph; // Every pass of the frame, and the frame buffers they draw to
 
     ShadowMapFBO shadowMapBuffer;
+    ShadowCascades m_shadowCascades; // The light's view of the world for each layer of shadowMapBuffer
+    GpuTimer m_shadowPassTimer;
+    GpuTimer m_framePassTimer;  // The GPU's time on the rest of the frame, after the shadow map pass
+    GpuTimer m_shadedSamples;   // Samples of opaque terrain shaded after the depth pre-pass
+
+    bool m_depthPrePass;        // Lay down the terrain's depth before shading any of it (P)
+    bool m_overdrawMode;        // Draw the terrain brighter the more often each pixel is shaded (O)
+
+    QualityGovernor m_quality;  // Trades image quality for frame time
+    unsigned int m_frameNumber;
+    float m_tickMs;             // CPU time the last tick() took
+
+    std::chrono::steady_clock::time_point m_launchTime; // When MyGL was constructed
+    float m_shaderMs;           // Time initializeGL() spent building shader programs
 
     void moveMouseToCenter(); // Forces the mouse position to the screen's center. You should call this
                               // from within a mouse move event after reading the mouse movement so that
@@ -78,6 +110,24 @@ private:
 
     void sendPlayerDataToGUI() const;
 
+    // The area of terrain drawn around the player this frame, as
+    // (min x, min z, max x, max z), depending on the quality level
+    glm::ivec4 terrainDrawBounds() const;
+    // The size of the terrain frame buffers, depending on the quality level
+    glm::ivec2 renderSize() const;
+    // Rebuilds the shadow map to match m_shadowCascades
+    void recreateShadowMap();
+    // Applies every setting of the current quality level
+    void applyQualityLevel();
+    // At lower quality levels the shadow cascades only follow the
+    // player, and pick up changes to the terrain, every few frames
+    bool isShadowUpdateFrame() const;
+    // Fills m_frameUniforms from this frame's state and uploads it
+    void updateFrameUniforms();
+    // Prints the time from launch to the first frame, and how much of it
+    // went on shader programs
+    void reportFirstFrame();
+
 public:
     explicit MyGL(QWidget *parent = nullptr);
     ~MyGL();
@@ -93,15 +143,33 @@ public:
     // In the base code, update() is called from tick().
     void paintGL() override;
 
-    // Called from paintGL().
-    // Calls Terrain::draw().
+    // Declares this frame's passes to m_renderGraph: the shadow map, the
+    // opaque terrain, its transparent faces and their composite, the post
+    // process effects that are in use, and the axes.
+    void declareRenderGraph();
+    // Called from the terrain pass, with its target bound.
+    // Calls Terrain::draw(). Along with the shaded image, the surface
+    // shaders write a black-and-white map of the terrain inside the hex
+    // to a second attachment, which post processing uses to apply the
+    // timeline effect only to the terrain that lies inside the hex.
     void renderTerrain();
-    void drawTerrain(SurfaceShader* surfaceShader);
-
-    //A function to render terrain as a black-and-white map and send it to a frame buffer.
-    //This is to be used in post processing to apply the effect only to the terrain that
-    //lies inside the hex.
-    void renderHexMap();
+    // Called from the transparency pass, with its target bound and
+    // holding the scene's depth. Draws the transparent faces of the
+    // Chunks drawn by renderTerrain() with weighted blended
+    // order-independent transparency, see weightedblend.frag.glsl.
+    void renderTransparency();
+    // Draws the Chunk sections around the player that lie in the camera's
+    // frustum, can be reached from the camera's section through open
+    // blocks, and are not hidden behind the occluders in m_occlusionBuffer.
+    // Opaque sections go nearest first, after a depth pre-pass if
+    // m_depthPrePass is set and the shader doesn't move vertices.
+    DrawStats drawTerrain(SurfaceShader* surfaceShader);
+    // Draws the far terrain around the loaded Chunks, fading it in
+    // under the outermost of them.
+    void drawFarTerrain();
+    // Has m_occlusionWorker rasterise the occluders near the
+    // player into m_occlusionBuffer while the caller carries on.
+    void startOcclusionPass();
 
     //Hex Functions
 
@@ -111,11 +179,23 @@ public:
     //drawHex() is used to update VBO data used to render the hex.
     void drawHex();
 
-    void performTimelineRenderPass();
-    void performPostprocessRenderPass();
     void setSurfaceShader();
-    void setPostProcessShader(bool timelineRenderPass);
+    MediumEffect currentMediumEffect();
+    TimelineEffect currentTimelineEffect() const;
+    // Re-renders each shadow cascade that is out of date.
     void performShadowMapPass();
+    // Cycles between 1 and ShadowCascades::MAX_CASCADES shadow cascades.
+    void cycleShadowCascades();
+    // Cycles from automatic quality through each fixed quality level.
+    void cycleQualityLevel();
+    // 0 is the best. See QualityGovernor.
+    int getQualityLevel() const;
+    // Terrain samples shaded per pixel of the render target, smoothed
+    // over recent frames. Pixels of sky count as none, so compare it
+    // with the pre-pass on and off rather than against 1.
+    float overdraw() const;
+    // The terrain's mesh memory against its budget, for the stats panel
+    QString meshMemoryStats() const;
 
 protected:
     // Automatically invoked when the user
@@ -141,6 +221,9 @@ signals:
     void sig_sendPlayerLook(QString) const;
     void sig_sendPlayerChunk(QString) const;
     void sig_sendPlayerTerrainZone(QString) const;
+    void sig_sendTerrainPassStats(QString) const;
+    void sig_sendShadowPassStats(QString) const;
+    void sig_sendQualityStats(QString) const;
 };
 
 
@@ -1,14 +1,18 @@
 #include "openglcontext.h"
+#include "programcache.h"
 
 #include <iostream>
 #include <QApplication>
 #include <QProcessEnvironment>
 #include <QOpenGLContext>
+#include <QOpenGLDebugLogger>
 #include <QDebug>
 
+bool OpenGLContext::s_diagnostics = false;
 
 OpenGLContext::OpenGLContext(QWidget *parent)
-    : QOpenGLWidget(parent)
+    : QOpenGLWidget(parent), mp_debugLogger(nullptr), m_pollErrors(false), m_debugGroups(),
+      mp_programCache(mkU<ProgramCache>(this))
 {}
 
 OpenGLContext::~OpenGLContext()
@@ -69,8 +73,110 @@ void OpenGLContext::debugContextVersion()
     }
 }
 
+void OpenGLContext::setDiagnosticsEnabled(bool enabled)
+{
+    s_diagnostics = enabled;
+}
+
+bool OpenGLContext::isDiagnosticsEnabled()
+{
+    return s_diagnostics;
+}
+
+void OpenGLContext::startDiagnostics()
+{
+    if (!s_diagnostics) {
+        return;
+    }
+    mp_debugLogger = new QOpenGLDebugLogger(this);
+    if (!mp_debugLogger->initialize()) {
+        std::cerr << "GL diagnostics: no KHR_debug on this context, polling glGetError instead" << std::endl;
+        delete mp_debugLogger;
+        mp_debugLogger = nullptr;
+        m_pollErrors = true;
+        return;
+    }
+    connect(mp_debugLogger, &QOpenGLDebugLogger::messageLogged, this,
+            [this](const QOpenGLDebugMessage &message) { logDebugMessage(message); });
+    // Synchronous, so a message arrives inside the call that caused it,
+    // while m_debugGroups still describes what was being drawn
+    mp_debugLogger->startLogging(QOpenGLDebugLogger::SynchronousLogging);
+    std::cerr << "GL diagnostics: KHR_debug output enabled" << std::endl;
+}
+
+void OpenGLContext::enableParallelShaderCompile()
+{
+    // Not in QOpenGLExtraFunctions, so looked up by hand
+    typedef void (QOPENGLF_APIENTRYP MaxShaderCompilerThreads)(GLuint count);
+    QOpenGLContext *ctx = context();
+    MaxShaderCompilerThreads maxThreads = nullptr;
+    if (ctx->hasExtension("GL_KHR_parallel_shader_compile")) {
+        maxThreads = reinterpret_cast<MaxShaderCompilerThreads>(ctx->getProcAddress("glMaxShaderCompilerThreadsKHR"));
+    } else if (ctx->hasExtension("GL_ARB_parallel_shader_compile")) {
+        maxThreads = reinterpret_cast<MaxShaderCompilerThreads>(ctx->getProcAddress("glMaxShaderCompilerThreadsARB"));
+    }
+    if (maxThreads != nullptr) {
+        // As many threads as the driver likes
+        maxThreads(0xFFFFFFFF);
+    }
+}
+
+ProgramCache& OpenGLContext::getProgramCache()
+{
+    return *mp_programCache;
+}
+
+bool OpenGLContext::isDebugLogging() const
+{
+    return mp_debugLogger != nullptr;
+}
+
+void OpenGLContext::labelObject(GLenum identifier, GLuint name, const QString &label)
+{
+    if (mp_debugLogger == nullptr) {
+        return;
+    }
+    QByteArray utf8 = label.toUtf8();
+    glObjectLabel(identifier, name, utf8.size(), utf8.constData());
+}
+
+void OpenGLContext::pushDebugGroup(const QString &name)
+{
+    if (mp_debugLogger == nullptr) {
+        return;
+    }
+    m_debugGroups.push_back(name);
+    mp_debugLogger->pushGroup(name);
+}
+
+void OpenGLContext::popDebugGroup()
+{
+    if (mp_debugLogger == nullptr) {
+        return;
+    }
+    mp_debugLogger->popGroup();
+    m_debugGroups.pop_back();
+}
+
+void OpenGLContext::logDebugMessage(const QOpenGLDebugMessage &message)
+{
+    // Our own group markers come back as notifications; skip them
+    if (message.severity() == QOpenGLDebugMessage::NotificationSeverity) {
+        return;
+    }
+    std::cerr << "GL debug";
+    for (const QString &group : m_debugGroups) {
+        std::cerr << " > " << group.toStdString();
+    }
+    std::cerr << ": " << message.message().toStdString() << std::endl;
+}
+
 void OpenGLContext::printGLErrorLog()
 {
+    // Errors are reported by the debug callback instead, or not at all
+    if (!m_pollErrors) {
+        return;
+    }
     GLenum error = glGetError();
     if (error != GL_NO_ERROR) {
         std::cerr << "OpenGL error " << error << ": ";
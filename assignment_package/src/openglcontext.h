@@ -4,17 +4,58 @@
 #include <QTimer>
 #include <QOpenGLExtraFunctions>
 
+#include <smartpointerhelp.h>
+#include <vector>
+
+class ProgramCache;
+class QOpenGLDebugLogger;
+class QOpenGLDebugMessage;
 
 class OpenGLContext
     : public QOpenGLWidget,
       public QOpenGLExtraFunctions
 {
+private:
+    // Set from main() before any context is created
+    static bool s_diagnostics;
+
+    QOpenGLDebugLogger *mp_debugLogger; // Owned by this widget; null unless diagnostics are on
+    bool m_pollErrors;                  // Whether printGLErrorLog() calls glGetError
+    std::vector<QString> m_debugGroups; // Mirrors the driver's debug group stack, for reporting
+    uPtr<ProgramCache> mp_programCache; // Linked programs kept between launches
+
+    void logDebugMessage(const QOpenGLDebugMessage &message);
 
 public:
     OpenGLContext(QWidget *parent);
     ~OpenGLContext();
 
+    // Diagnostics mode asks for a debug context and reports GL errors
+    // through a KHR_debug callback, labelled with the object and render
+    // pass responsible. With it off, no error queries are made at all.
+    static void setDiagnosticsEnabled(bool enabled);
+    static bool isDiagnosticsEnabled();
+
     void debugContextVersion();
+    // Call once the context is current, from initializeGL(). Falls back
+    // to polling glGetError if the driver lacks KHR_debug.
+    void startDiagnostics();
+    // Whether labels and debug groups reach the driver. Callers can check
+    // this before building a label they would otherwise throw away.
+    bool isDebugLogging() const;
+    // Names a GL object (GL_PROGRAM, GL_TEXTURE, GL_BUFFER, ...) in debug output.
+    void labelObject(GLenum identifier, GLuint name, const QString &label);
+    // Brackets the GL calls made between them, such as a render pass, in debug output.
+    void pushDebugGroup(const QString &name);
+    void popDebugGroup();
+
+    // Lets the driver compile and link shaders on its own threads, if it
+    // supports KHR_parallel_shader_compile (or the ARB version). Call once
+    // the context is current. See ShaderProgram::submit().
+    void enableParallelShaderCompile();
+    // Where linked programs are kept between launches
+    ProgramCache& getProgramCache();
+
     void printGLErrorLog();
     void printLinkInfoLog(int prog);
     void printShaderInfoLog(int shader);
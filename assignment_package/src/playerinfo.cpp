@@ -36,3 +36,15 @@ void PlayerInfo::slot_setZoneText(QString s) {
     ui->zoneLabel->setText(s);
 }
 
+void PlayerInfo::slot_setTerrainPassText(QString s) {
+    ui->terrainPassLabel->setText(s);
+}
+
+void PlayerInfo::slot_setShadowPassText(QString s) {
+    ui->shadowPassLabel->setText(s);
+}
+
+void PlayerInfo::slot_setQualityText(QString s) {
+    ui->qualityLabel->setText(s);
+}
+
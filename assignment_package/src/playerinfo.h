@@ -20,6 +20,9 @@ public slots:
     void slot_setLookText(QString);
     void slot_setChunkText(QString);
     void slot_setZoneText(QString);
+    void slot_setTerrainPassText(QString);
+    void slot_setShadowPassText(QString);
+    void slot_setQualityText(QString);
 
 private:
     Ui::PlayerInfo *ui;
@@ -0,0 +1,104 @@
+#include "postprocesscomposer.h"
+
+// Declarations every snippet may rely on
+static const char *HEADER =
+    "#version 150\n"
+    "in vec2 fs_UV;\n"
+    "out vec4 out_Col;\n"
+    "uniform sampler2D u_RenderedTexture;\n"
+    "uniform sampler2D u_Hexture;\n"
+    "#include \"frameuniforms.glsl\"\n";
+
+// qTextFileRead() ends the text with a null character, which would cut
+// the spliced source short
+static QString readSnippet(ShaderProgram &program, const char *fileName) {
+    QString text = program.qTextFileRead(fileName);
+    if (text.endsWith('\0')) {
+        text.chop(1);
+    }
+    return text;
+}
+
+PostProcessComposer::PostProcessComposer(OpenGLContext *context)
+    : mp_context(context), m_programs()
+{}
+
+const char *PostProcessComposer::mediumSnippet(MediumEffect medium) {
+    switch (medium) {
+    case MediumEffect::WATER:
+        return ":/glsl/water.effect.glsl";
+    case MediumEffect::LAVA:
+        return ":/glsl/lava.effect.glsl";
+    default:
+        return nullptr;
+    }
+}
+
+const char *PostProcessComposer::timelineSnippet(TimelineEffect timeline) {
+    switch (timeline) {
+    case TimelineEffect::GREYSCALE:
+        return ":/glsl/greyscale.effect.glsl";
+    case TimelineEffect::GLITCH:
+        return ":/glsl/glitch.effect.glsl";
+    default:
+        return nullptr;
+    }
+}
+
+bool PostProcessComposer::canFuse(MediumEffect medium, TimelineEffect timeline) {
+    // The glitch reads the scene a little to either side of each pixel
+    return medium == MediumEffect::NONE || timeline != TimelineEffect::GLITCH;
+}
+
+PostProcessShader *PostProcessComposer::getProgram(MediumEffect medium, TimelineEffect timeline) {
+    uPtr<PostProcessShader> &program = m_programs[int(medium)][int(timeline)];
+    if (program == nullptr) {
+        submit(medium, timeline)->finish();
+    }
+    return program.get();
+}
+
+PostProcessShader *PostProcessComposer::submit(MediumEffect medium, TimelineEffect timeline) {
+    uPtr<PostProcessShader> &program = m_programs[int(medium)][int(timeline)];
+    program = mkU<PostProcessShader>(mp_context);
+
+    QString source = HEADER;
+    const char *mediumFile = mediumSnippet(medium);
+    if (mediumFile != nullptr) {
+        source.append(readSnippet(*program, mediumFile));
+    } else {
+        source.append("vec4 applyMedium(vec2 uv) { return texture(u_RenderedTexture, uv); }\n");
+    }
+    source.append("vec4 sceneColor(vec2 uv) { return applyMedium(uv); }\n");
+    const char *timelineFile = timelineSnippet(timeline);
+    if (timelineFile != nullptr) {
+        source.append(readSnippet(*program, timelineFile));
+    } else {
+        source.append("vec4 applyTimeline(vec2 uv) { return sceneColor(uv); }\n");
+    }
+    source.append("void main() { out_Col = applyTimeline(fs_UV); }\n");
+
+    QString label = QString::asprintf("Post process (medium %d, timeline %d)", int(medium), int(timeline));
+    program->submitFromSource(program->qTextFileRead(":/glsl/noOp.vert.glsl"), source, label);
+    return program.get();
+}
+
+void PostProcessComposer::submitAll() {
+    for (int medium = 0; medium < 3; medium++) {
+        for (int timeline = 0; timeline < 3; timeline++) {
+            if (m_programs[medium][timeline] == nullptr) {
+                submit(MediumEffect(medium), TimelineEffect(timeline));
+            }
+        }
+    }
+}
+
+void PostProcessComposer::finishAll() {
+    for (auto &programs : m_programs) {
+        for (uPtr<PostProcessShader> &program : programs) {
+            if (program != nullptr) {
+                program->finish();
+            }
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "postprocessshader.h"
+#include "smartpointerhelp.h"
+
+#include <array>
+
+// Effects applied while the player is inside a fluid. They distort where
+// the scene is read from.
+enum class MediumEffect : unsigned char {
+    NONE, WATER, LAVA
+};
+
+// Effects applied outside the hex for the current timeline. They read
+// the scene, then mix the result with it by the hex mask.
+enum class TimelineEffect : unsigned char {
+    NONE, GREYSCALE, GLITCH
+};
+
+// Builds the post-processing programs, one per pair of medium and
+// timeline effects, with both effects fused into a single full-screen
+// pass. Each effect lives in its own GLSL snippet:
+//  * a medium effect defines vec4 applyMedium(vec2 uv), reading
+//    u_RenderedTexture,
+//  * a timeline effect defines vec4 applyTimeline(vec2 uv), reading
+//    the scene through vec4 sceneColor(vec2 uv) and the hex mask
+//    through u_Hexture.
+// The composer splices the two together with sceneColor() calling
+// applyMedium(). Programs are compiled the first time they are asked for.
+class PostProcessComposer
+{
+private:
+    OpenGLContext *mp_context;
+    std::array<std::array<uPtr<PostProcessShader>, 3>, 3> m_programs; // By medium, then timeline
+
+    static const char *mediumSnippet(MediumEffect medium);
+    static const char *timelineSnippet(TimelineEffect timeline);
+    // Creates and submits the program for this pair, which must not exist yet
+    PostProcessShader *submit(MediumEffect medium, TimelineEffect timeline);
+
+public:
+    PostProcessComposer(OpenGLContext *context);
+
+    // Whether one pass can apply both effects at no extra cost. Not so
+    // if the timeline effect reads the scene at more than one point, as
+    // each read would re-run the medium effect. Then the medium effect
+    // should be drawn to a frame buffer first, to be read by
+    // getProgram(MediumEffect::NONE, timeline).
+    static bool canFuse(MediumEffect medium, TimelineEffect timeline);
+    // The program applying medium, then timeline, to the scene bound to
+    // u_RenderedTexture.
+    PostProcessShader *getProgram(MediumEffect medium, TimelineEffect timeline);
+    // Compile every program up front, rather than on first use, letting
+    // the driver work on them all at once. See ShaderProgram::submit().
+    void submitAll();
+    void finishAll();
+};
@@ -0,0 +1,129 @@
+#include "programcache.h"
+#include "shaderprogram.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+#include <iostream>
+
+// Written before the binary: its format, then its length
+static const int HEADER_SIZE = 2 * sizeof(GLuint);
+
+ProgramCache::ProgramCache(OpenGLContext *context)
+    : mp_context(context), m_initialized(false), m_directory(), m_driver(), m_hits(0), m_misses(0)
+{}
+
+void ProgramCache::initialize() {
+    m_initialized = true;
+    GLint formats = 0;
+    mp_context->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats == 0) {
+        return;
+    }
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (directory.isEmpty()) {
+        return;
+    }
+    directory = QDir(directory).filePath("shaders");
+    if (!QDir(directory).mkpath(".")) {
+        std::cerr << "ProgramCache: cannot create " << directory.toStdString() << std::endl;
+        return;
+    }
+    m_directory = directory;
+
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        m_driver.append(reinterpret_cast<const char*>(mp_context->glGetString(name)));
+        m_driver.append('\n');
+    }
+}
+
+QString ProgramCache::filePath(const QByteArray &key) const {
+    return QDir(m_directory).filePath(QString::fromLatin1(key.toHex()) + ".bin");
+}
+
+QByteArray ProgramCache::key(const QString &vertSource, const QString &fragSource) {
+    if (!m_initialized) {
+        initialize();
+    }
+    QByteArray identity = m_driver;
+    // Baked into the binary when it was linked
+    GLuint attributes[] = {ShaderProgram::ATTRIB_POS, ShaderProgram::ATTRIB_NOR,
+                           ShaderProgram::ATTRIB_COL, ShaderProgram::ATTRIB_CHUNK_ORIGIN};
+    identity.append(reinterpret_cast<const char*>(attributes), sizeof(attributes));
+    identity.append(vertSource.toUtf8());
+    identity.append("\0", 1);
+    identity.append(fragSource.toUtf8());
+    return QCryptographicHash::hash(identity, QCryptographicHash::Sha1);
+}
+
+bool ProgramCache::load(GLuint prog, const QByteArray &key) {
+    if (m_directory.isEmpty()) {
+        return false;
+    }
+    QFile file(filePath(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_misses++;
+        return false;
+    }
+    QByteArray bytes = file.readAll();
+    file.close();
+
+    GLuint header[2] = {0, 0};
+    if (bytes.size() >= HEADER_SIZE) {
+        std::memcpy(header, bytes.constData(), HEADER_SIZE);
+    }
+    GLint linked = GL_FALSE;
+    if (bytes.size() >= HEADER_SIZE && header[1] == GLuint(bytes.size() - HEADER_SIZE)) {
+        mp_context->glProgramBinary(prog, header[0], bytes.constData() + HEADER_SIZE, header[1]);
+        mp_context->glGetProgramiv(prog, GL_LINK_STATUS, &linked);
+    }
+    if (!linked) {
+        // Truncated, or written by a driver that no longer accepts it
+        QFile::remove(filePath(key));
+        m_misses++;
+        return false;
+    }
+    m_hits++;
+    return true;
+}
+
+void ProgramCache::prepare(GLuint prog) {
+    if (!m_directory.isEmpty()) {
+        mp_context->glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+void ProgramCache::save(GLuint prog, const QByteArray &key) {
+    if (m_directory.isEmpty()) {
+        return;
+    }
+    GLint length = 0;
+    mp_context->glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    QByteArray bytes;
+    bytes.resize(HEADER_SIZE + length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    mp_context->glGetProgramBinary(prog, length, &written, &format, bytes.data() + HEADER_SIZE);
+    GLuint header[2] = {format, GLuint(written)};
+    std::memcpy(bytes.data(), header, HEADER_SIZE);
+    bytes.resize(HEADER_SIZE + written);
+
+    // Only appears once complete, so a crash can't leave half an entry
+    QSaveFile file(filePath(key));
+    if (!file.open(QIODevice::WriteOnly) || file.write(bytes) != bytes.size() || !file.commit()) {
+        std::cerr << "ProgramCache: cannot write " << filePath(key).toStdString() << std::endl;
+    }
+}
+
+int ProgramCache::getHits() const {
+    return m_hits;
+}
+
+int ProgramCache::getMisses() const {
+    return m_misses;
+}
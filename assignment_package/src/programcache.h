@@ -0,0 +1,43 @@
+#pragma once
+#include "openglcontext.h"
+
+#include <QByteArray>
+#include <QString>
+
+// Keeps linked shader programs on disk as the driver's own binaries
+// (glGetProgramBinary), so later launches load them rather than compile
+// and link them again.
+//
+// Each entry is keyed by a hash of the program's sources, its fixed
+// attribute locations, and the driver's vendor, renderer and version.
+// Editing a shader or updating the driver changes the key, so stale
+// entries are simply never read again. An entry the driver refuses
+// anyway is deleted, and the program is compiled from source instead.
+class ProgramCache {
+private:
+    OpenGLContext *mp_context;
+    bool m_initialized;
+    QString m_directory;    // Empty if the driver can't hand programs back as binaries
+    QByteArray m_driver;    // Goes into every key
+    int m_hits, m_misses;
+
+    // Needs a current context, so is put off until first use
+    void initialize();
+    QString filePath(const QByteArray &key) const;
+
+public:
+    ProgramCache(OpenGLContext *context);
+
+    // The key for a program linked from this (already #include-expanded) source
+    QByteArray key(const QString &vertSource, const QString &fragSource);
+    // Links prog from the cached binary. Returns false, leaving prog
+    // untouched, if there is no usable entry.
+    bool load(GLuint prog, const QByteArray &key);
+    // Call before linking a program that will be save()d.
+    void prepare(GLuint prog);
+    // Stores prog, which must have linked successfully.
+    void save(GLuint prog, const QByteArray &key);
+
+    int getHits() const;
+    int getMisses() const;
+};
@@ -0,0 +1,91 @@
+#include "qualitygovernor.h"
+#include <algorithm>
+
+// Resolution drops first, as it costs the least to look at,
+// then the shadows, and the view distance last
+const std::array<QualityLevel, QualityGovernor::LEVEL_COUNT> QualityGovernor::LEVELS = {{
+    {"Ultra",  1.f,   1, 1, 2},
+    {"High",   0.85f, 1, 2, 2},
+    {"Medium", 0.7f,  2, 2, 2},
+    {"Low",    0.6f,  2, 4, 1},
+    {"Lowest", 0.5f,  4, 4, 1},
+}};
+
+// Step down when over the target, step up only when this far under it
+static const float UPGRADE_FRACTION = 0.7f;
+
+QualityGovernor::QualityGovernor(float targetMs)
+    : m_targetMs(targetMs), m_frameMs(), m_frameCount(0), m_next(0), m_sumMs(0.f),
+      m_level(0), m_cooldown(0), m_headroom(0), m_enabled(true)
+{}
+
+bool QualityGovernor::addFrame(float frameMs) {
+    if (m_frameCount == WINDOW) {
+        m_sumMs -= m_frameMs[m_next];
+    } else {
+        m_frameCount++;
+    }
+    m_frameMs[m_next] = frameMs;
+    m_sumMs += frameMs;
+    m_next = (m_next + 1) % WINDOW;
+
+    if (!m_enabled || m_frameCount < WINDOW) {
+        return false;
+    }
+    if (m_cooldown > 0) {
+        m_cooldown--;
+        return false;
+    }
+
+    float averageMs = getAverageMs();
+    int level = m_level;
+    if (averageMs > m_targetMs) {
+        level = std::min(m_level + 1, LEVEL_COUNT - 1);
+        m_headroom = 0;
+    } else if (averageMs < m_targetMs * UPGRADE_FRACTION) {
+        if (++m_headroom >= UPGRADE_DELAY) {
+            level = std::max(m_level - 1, 0);
+            m_headroom = 0;
+        }
+    } else {
+        m_headroom = 0;
+    }
+
+    if (level == m_level) {
+        return false;
+    }
+    m_level = level;
+    m_cooldown = COOLDOWN;
+    return true;
+}
+
+void QualityGovernor::setFixedLevel(int level) {
+    m_enabled = false;
+    m_level = std::clamp(level, 0, LEVEL_COUNT - 1);
+}
+
+void QualityGovernor::setAutomatic() {
+    m_enabled = true;
+    m_cooldown = COOLDOWN;
+    m_headroom = 0;
+}
+
+bool QualityGovernor::isAutomatic() const {
+    return m_enabled;
+}
+
+int QualityGovernor::getLevel() const {
+    return m_level;
+}
+
+const QualityLevel& QualityGovernor::getSettings() const {
+    return LEVELS[m_level];
+}
+
+float QualityGovernor::getAverageMs() const {
+    return m_frameCount == 0 ? 0.f : m_sumMs / m_frameCount;
+}
+
+float QualityGovernor::getTargetMs() const {
+    return m_targetMs;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+
+// The settings of one quality level.
+struct QualityLevel {
+    const char *name;
+    float renderScale;          // Side of the terrain frame buffers, relative to the window's
+    int shadowDivisor;          // Divides the shadow cascades' resolution
+    int shadowInterval;         // Frames between shadow map updates
+    int renderRadius;           // Terrain zones drawn either side of the player's
+};
+
+// Watches recent frame times and moves between quality levels to hold
+// them under a target, so the game degrades gracefully on slow machines
+// rather than dropping frames.
+//
+// Level 0 is the best looking. The governor steps down a level as soon
+// as the recent average goes over the target, and back up only once it
+// has stayed well under the target for a while. The gap between the two
+// thresholds, and the wait after each change for the frame times to
+// reflect it, keep it from flipping between two levels every frame.
+class QualityGovernor {
+public:
+    static const int LEVEL_COUNT = 5;
+    // Frames averaged over before deciding anything
+    static const int WINDOW = 30;
+    // Frames after a change before the next one may be made
+    static const int COOLDOWN = 60;
+    // Consecutive frames under the upper threshold needed to step up
+    static const int UPGRADE_DELAY = 180;
+
+private:
+    static const std::array<QualityLevel, LEVEL_COUNT> LEVELS;
+
+    float m_targetMs;
+    std::array<float, WINDOW> m_frameMs;    // Ring buffer of the recent frame times
+    int m_frameCount;                       // Frames recorded, up to WINDOW
+    int m_next;                             // Where the next frame time goes
+    float m_sumMs;
+
+    int m_level;
+    int m_cooldown;     // Frames until the next change may be made
+    int m_headroom;     // Consecutive frames spent well under the target
+    bool m_enabled;
+
+public:
+    QualityGovernor(float targetMs);
+
+    // Records one frame's time, in milliseconds, and returns true if
+    // that changed the quality level.
+    bool addFrame(float frameMs);
+
+    // Stops the governor moving between levels, leaving it at the given one
+    void setFixedLevel(int level);
+    void setAutomatic();
+    bool isAutomatic() const;
+
+    int getLevel() const;
+    const QualityLevel& getSettings() const;
+    // The average of the recent frame times, in milliseconds
+    float getAverageMs() const;
+    float getTargetMs() const;
+};
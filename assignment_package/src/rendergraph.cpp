@@ -0,0 +1,174 @@
+#include "rendergraph.h"
+#include <stdexcept>
+
+// Always the first resource declared
+static const RenderGraph::Resource SCREEN = 0;
+
+bool RenderTargetDesc::operator==(const RenderTargetDesc &other) const {
+    return width == other.width && height == other.height &&
+           hasMask == other.hasMask && hasDepth == other.hasDepth && floatColor == other.floatColor;
+}
+
+RenderGraph::RenderGraph(OpenGLContext *context)
+    : mp_context(context), m_passes(), m_resources(), m_targets(), m_frameNumber(0)
+{
+    reset();
+}
+
+void RenderGraph::reset() {
+    m_passes.clear();
+    m_resources.clear();
+    importResource("Screen");
+}
+
+RenderGraph::Resource RenderGraph::getScreen() const {
+    return SCREEN;
+}
+
+RenderGraph::Resource RenderGraph::importResource(const QString &name) {
+    m_resources.push_back(ResourceInfo{name, false, RenderTargetDesc{0, 0, false, false, false}, -1});
+    return m_resources.size() - 1;
+}
+
+RenderGraph::Resource RenderGraph::createTarget(const QString &name, const RenderTargetDesc &desc) {
+    m_resources.push_back(ResourceInfo{name, true, desc, -1});
+    return m_resources.size() - 1;
+}
+
+void RenderGraph::addPass(const QString &name, const std::vector<Resource> &reads,
+                          const std::vector<Resource> &writes, const PassFunction &execute) {
+    m_passes.push_back(Pass{name, reads, writes, execute});
+}
+
+void RenderGraph::execute() {
+    int passCount = m_passes.size();
+
+    // Walk back from the screen, keeping each pass that writes
+    // something a pass already kept will read
+    std::vector<bool> needed(m_resources.size(), false);
+    std::vector<bool> live(passCount, false);
+    needed[SCREEN] = true;
+    for (int i = passCount - 1; i >= 0; i--) {
+        for (Resource resource : m_passes[i].writes) {
+            live[i] = live[i] || needed[resource];
+        }
+        if (live[i]) {
+            for (Resource resource : m_passes[i].reads) {
+                needed[resource] = true;
+            }
+        }
+    }
+
+    // The first and last pass that runs with each render target
+    std::vector<int> firstUse(m_resources.size(), -1), lastUse(m_resources.size(), -1);
+    for (int i = 0; i < passCount; i++) {
+        if (!live[i]) {
+            continue;
+        }
+        for (const std::vector<Resource> *resources : {&m_passes[i].reads, &m_passes[i].writes}) {
+            for (Resource resource : *resources) {
+                if (firstUse[resource] == -1) {
+                    firstUse[resource] = i;
+                }
+                lastUse[resource] = i;
+            }
+        }
+    }
+
+    m_frameNumber++;
+    for (Target &target : m_targets) {
+        target.busyUntil = -1;
+    }
+    for (int i = 0; i < passCount; i++) {
+        if (!live[i]) {
+            continue;
+        }
+        for (Resource resource = 0; resource < int(m_resources.size()); resource++) {
+            if (m_resources[resource].transient && firstUse[resource] == i) {
+                allocate(resource, i, lastUse[resource]);
+            }
+        }
+        mp_context->pushDebugGroup(m_passes[i].name);
+        m_passes[i].execute();
+        mp_context->popDebugGroup();
+    }
+
+    releaseUnusedTargets();
+}
+
+void RenderGraph::allocate(Resource resource, int firstPass, int lastPass) {
+    const RenderTargetDesc &desc = m_resources[resource].desc;
+
+    // Failing a target of this very description, take one with the same
+    // attachments that this frame has no use for and resize it
+    int chosen = -1;
+    for (int i = 0; i < int(m_targets.size()); i++) {
+        Target &target = m_targets[i];
+        if (target.busyUntil >= firstPass) {
+            continue;
+        }
+        if (target.desc == desc) {
+            chosen = i;
+            break;
+        }
+        if (chosen == -1 && target.lastFrameUsed != m_frameNumber &&
+            target.desc.hasMask == desc.hasMask && target.desc.hasDepth == desc.hasDepth &&
+            target.desc.floatColor == desc.floatColor) {
+            chosen = i;
+        }
+    }
+
+    if (chosen == -1) {
+        m_targets.push_back(Target{mkU<FrameBuffer>(mp_context, desc.width, desc.height, 1,
+                                                    desc.hasMask, desc.hasDepth, desc.floatColor),
+                                   desc, -1, m_frameNumber});
+        chosen = m_targets.size() - 1;
+        m_targets[chosen].frameBuffer->create();
+    } else if (!(m_targets[chosen].desc == desc)) {
+        Target &target = m_targets[chosen];
+        target.desc = desc;
+        target.frameBuffer->destroy();
+        target.frameBuffer->resize(desc.width, desc.height, 1);
+        target.frameBuffer->create();
+    }
+
+    m_targets[chosen].busyUntil = lastPass;
+    m_targets[chosen].lastFrameUsed = m_frameNumber;
+    m_resources[resource].target = chosen;
+}
+
+void RenderGraph::releaseUnusedTargets() {
+    for (int i = m_targets.size() - 1; i >= 0; i--) {
+        if (m_frameNumber - m_targets[i].lastFrameUsed > KEEP_FRAMES) {
+            m_targets[i].frameBuffer->destroy();
+            m_targets.erase(m_targets.begin() + i);
+        }
+    }
+}
+
+FrameBuffer &RenderGraph::getTarget(Resource target) {
+    if (!m_resources[target].transient || m_resources[target].target == -1) {
+        throw std::logic_error("RenderGraph::getTarget: " + m_resources[target].name.toStdString() +
+                               " is not an allocated render target");
+    }
+    return *m_targets[m_resources[target].target].frameBuffer;
+}
+
+void RenderGraph::bindTarget(Resource target) {
+    if (target == SCREEN) {
+        mp_context->glBindFramebuffer(GL_FRAMEBUFFER, mp_context->defaultFramebufferObject());
+        mp_context->glViewport(0, 0, mp_context->width() * mp_context->devicePixelRatio(),
+                               mp_context->height() * mp_context->devicePixelRatio());
+        return;
+    }
+    const RenderTargetDesc &desc = m_resources[target].desc;
+    getTarget(target).bindFrameBuffer();
+    mp_context->glViewport(0, 0, desc.width, desc.height);
+}
+
+void RenderGraph::destroy() {
+    for (Target &target : m_targets) {
+        target.frameBuffer->destroy();
+    }
+    m_targets.clear();
+}
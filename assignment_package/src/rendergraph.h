@@ -0,0 +1,91 @@
+#pragma once
+#include "framebuffer.h"
+#include "smartpointerhelp.h"
+
+#include <QString>
+#include <functional>
+#include <vector>
+
+// The size and attachments of a render target. Targets with equal
+// descriptions can share a FrameBuffer.
+struct RenderTargetDesc {
+    unsigned int width, height;
+    bool hasMask;   // A GL_R8 second colour attachment, see FrameBuffer
+    bool hasDepth;
+    bool floatColor; // A GL_RGBA16F colour attachment rather than GL_RGB
+
+    bool operator==(const RenderTargetDesc &other) const;
+};
+
+// One frame's render passes, each declared with the resources it reads
+// and writes, then run in the order they were declared. Knowing what
+// every pass needs lets the graph:
+//  * skip a pass whose outputs nothing later reads, unless it draws to
+//    the screen,
+//  * create render targets only for the passes that run, and let two
+//    targets share one FrameBuffer if their lifetimes don't overlap,
+//  * keep its FrameBuffers from frame to frame, reallocating one only
+//    when a frame first asks for a size that none of them has.
+// Rebuild the graph every frame: reset(), declare everything, execute().
+class RenderGraph {
+public:
+    typedef int Resource;
+    typedef std::function<void()> PassFunction;
+
+    // FrameBuffers no frame has used for this long are deleted
+    static const unsigned int KEEP_FRAMES = 300;
+
+private:
+    struct Pass {
+        QString name;
+        std::vector<Resource> reads, writes;
+        PassFunction execute;
+    };
+    struct ResourceInfo {
+        QString name;
+        bool transient;         // A render target owned by the graph
+        RenderTargetDesc desc;
+        int target;             // Index into m_targets, once allocated
+    };
+    struct Target {
+        uPtr<FrameBuffer> frameBuffer;
+        RenderTargetDesc desc;
+        int busyUntil;          // The last pass this frame that uses it
+        unsigned int lastFrameUsed;
+    };
+
+    OpenGLContext *mp_context;
+    std::vector<Pass> m_passes;
+    std::vector<ResourceInfo> m_resources;
+    std::vector<Target> m_targets;
+    unsigned int m_frameNumber;
+
+    // Gives resource a FrameBuffer that no other resource uses
+    // from pass firstPass to pass lastPass
+    void allocate(Resource resource, int firstPass, int lastPass);
+    void releaseUnusedTargets();
+
+public:
+    RenderGraph(OpenGLContext *context);
+
+    // Forgets the last frame's passes and resources, but not its FrameBuffers
+    void reset();
+    // The default frame buffer. Passes that write it always run.
+    Resource getScreen() const;
+    // Something kept outside the graph, such as the shadow map, which
+    // a pass fills in for a later one
+    Resource importResource(const QString &name);
+    // A render target that only lives for this frame
+    Resource createTarget(const QString &name, const RenderTargetDesc &desc);
+    void addPass(const QString &name, const std::vector<Resource> &reads,
+                 const std::vector<Resource> &writes, const PassFunction &execute);
+    // Runs every pass that contributes to the screen, in order
+    void execute();
+
+    // Only valid while a pass that uses the target is running
+    FrameBuffer &getTarget(Resource target);
+    // Draws to the target (or the screen) from now on, over the whole of it
+    void bindTarget(Resource target);
+    // Deallocate all GPU-side data
+    void destroy();
+};
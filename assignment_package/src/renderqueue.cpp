@@ -0,0 +1,115 @@
+#include "renderqueue.h"
+#include <algorithm>
+
+// Draws within this many blocks of each other share a distance band
+static const float BAND_BLOCKS = 32.f;
+
+// The sort key: pass in the top bits, then the program, then the
+// distance band, then the page, then the distance within the band in
+// sixteenths of a block. Bands go nearest first, and within a band the
+// pages are grouped, so a page's VAO is switched to at most once per
+// band. Blending doesn't care for nearest first, so the transparent
+// pass has a single band.
+static uint64_t sortKey(RenderQueue::Pass pass, const SurfaceShader *program, float distance, int page) {
+    uint64_t band = 0, near = 0;
+    if (pass != RenderQueue::TRANSPARENT_PASS) {
+        distance = glm::clamp(distance, 0.f, 255.f * BAND_BLOCKS);
+        band = uint64_t(distance / BAND_BLOCKS);
+        near = uint64_t((distance - band * BAND_BLOCKS) * 16.f);
+    }
+    return (uint64_t(pass) << 56) | (uint64_t(program->prog & 0xffffff) << 32) |
+           (band << 24) | (uint64_t(page & 0xfff) << 12) | near;
+}
+
+RenderQueue::RenderQueue()
+    : m_items(), m_ranges()
+{}
+
+void RenderQueue::clear() {
+    m_items.clear();
+    m_ranges.clear();
+}
+
+void RenderQueue::push(Pass pass, SurfaceShader *program, const MeshAllocation &mesh, glm::vec3 origin,
+                       const std::vector<glm::ivec2> &ranges, float distance) {
+    if (mesh.isEmpty() || ranges.empty()) {
+        return;
+    }
+    m_items.push_back(Item{sortKey(pass, program, distance, mesh.page), program, &mesh, origin,
+                           static_cast<unsigned int>(m_ranges.size()), static_cast<unsigned int>(ranges.size())});
+    m_ranges.insert(m_ranges.end(), ranges.begin(), ranges.end());
+}
+
+void RenderQueue::push(Pass pass, SurfaceShader *program, const MeshAllocation &mesh, glm::vec3 origin,
+                       float distance) {
+    if (mesh.isEmpty()) {
+        return;
+    }
+    m_items.push_back(Item{sortKey(pass, program, distance, mesh.page), program, &mesh, origin, 0, 0});
+}
+
+int RenderQueue::submit(MeshArena &arena, OpenGLContext *context, GpuTimer *shadedSamples) {
+    // Stable, so draws that share a key keep the order they were queued in
+    std::stable_sort(m_items.begin(), m_items.end(), [](const Item &a, const Item &b) {
+        return a.key < b.key;
+    });
+
+    arena.beginDraws();
+    SurfaceShader *bound = nullptr;
+    bool depthPass = false, shading = false;
+    for (const Item &item : m_items) {
+        bool depthOnly = (item.key >> 56) == DEPTH_PASS;
+        if (depthOnly && !depthPass) {
+            context->glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            depthPass = true;
+        } else if (!depthOnly && !shading) {
+            if (depthPass) {
+                context->glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                context->glDepthFunc(GL_LEQUAL);
+            }
+            if (shadedSamples != nullptr) {
+                shadedSamples->begin();
+            }
+            shading = true;
+        }
+        if (item.program != bound) {
+            // Also binds the program
+            item.program->setModelMatrix(glm::mat4(1.f));
+            bound = item.program;
+        }
+        // So that any GL error the draw raises names the Chunk it came from
+        bool group = context->isDebugLogging();
+        if (group) {
+            context->pushDebugGroup(QString::asprintf("Chunk (%d, %d)", int(item.origin.x), int(item.origin.z)));
+        }
+        context->glVertexAttrib3f(ShaderProgram::ATTRIB_CHUNK_ORIGIN, item.origin.x, item.origin.y, item.origin.z);
+        if (item.rangeCount == 0) {
+            arena.draw(*item.mesh);
+        } else {
+            arena.draw(*item.mesh, &m_ranges[item.firstRange], item.rangeCount);
+        }
+        if (group) {
+            context->popDebugGroup();
+        }
+    }
+    // Anything drawn outside a queue sits at its model matrix alone
+    context->glVertexAttrib3f(ShaderProgram::ATTRIB_CHUNK_ORIGIN, 0.f, 0.f, 0.f);
+    arena.endDraws();
+    if (depthPass && !shading) {
+        context->glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+    if (depthPass) {
+        context->glDepthFunc(GL_LESS);
+    }
+    if (shading && shadedSamples != nullptr) {
+        shadedSamples->end();
+    }
+
+    int draws = m_items.size();
+    clear();
+    return draws;
+}
+
+int RenderQueue::size() const {
+    return m_items.size();
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "gputimer.h"
+#include "mesharena.h"
+#include "surfaceshader.h"
+
+#include <cstdint>
+#include <vector>
+
+// Collects the draws of a frame's MeshArena meshes, then issues them
+// sorted so that each program is bound as few times as possible.
+// Within the depth and opaque passes, draws go nearest first, band by
+// band of distance, so the depth test can reject hidden fragments
+// before they are shaded. Each arena page's VAO is switched to at most
+// once per band.
+//
+// Meshes are drawn with an identity model matrix, offset by their own
+// origin through the vs_ChunkOrigin attribute. That costs a single
+// glVertexAttrib3f per draw, rather than uploading a model matrix and
+// its inverse transpose.
+class RenderQueue {
+public:
+    // Everything in an earlier pass is drawn before anything in a later one.
+    // The depth pass only writes depth, and lets the opaque pass draw
+    // wherever its depth is equal, so each pixel is shaded about once.
+    enum Pass : unsigned int {
+        DEPTH_PASS, OPAQUE_PASS, TRANSPARENT_PASS
+    };
+
+private:
+    struct Item {
+        uint64_t key;               // Pass, program, distance band, page, then distance
+        SurfaceShader *program;
+        const MeshAllocation *mesh;
+        glm::vec3 origin;
+        unsigned int firstRange;    // Into m_ranges
+        unsigned int rangeCount;    // Zero to draw the whole mesh
+    };
+
+    std::vector<Item> m_items;
+    std::vector<glm::ivec2> m_ranges;
+
+public:
+    RenderQueue();
+
+    void clear();
+    // Queues the given [x, x + y) ranges of the mesh's indices. The
+    // distance is from the camera to the mesh, see Frustum::nearDistance().
+    // The mesh must outlive the next submit().
+    void push(Pass pass, SurfaceShader *program, const MeshAllocation &mesh, glm::vec3 origin,
+              const std::vector<glm::ivec2> &ranges, float distance = 0.f);
+    // Queues all of the mesh's indices.
+    void push(Pass pass, SurfaceShader *program, const MeshAllocation &mesh, glm::vec3 origin,
+              float distance = 0.f);
+    // Sorts and draws everything queued, then clears the queue.
+    // Returns the number of draw calls issued. If shadedSamples is
+    // given, it counts the samples drawn after the depth pass.
+    int submit(MeshArena &arena, OpenGLContext *context, GpuTimer *shadedSamples = nullptr);
+
+    int size() const;
+};
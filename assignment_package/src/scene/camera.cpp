@@ -7,7 +7,7 @@ Camera::Camera(glm::vec3 pos)
 
 Camera::Camera(unsigned int w, unsigned int h, glm::vec3 pos)
     : Entity(pos), m_fovy(45), m_width(w), m_height(h),
-      m_near_clip(0.1f), m_far_clip(1000.f), m_aspect(w / static_cast<float>(h))
+      m_near_clip(0.1f), m_far_clip(3000.f), m_aspect(w / static_cast<float>(h))
 {}
 
 Camera::Camera(const Camera &c)
@@ -2,16 +2,19 @@
 #include <unordered_set>
 #include "sceneutils.h"
 #include <iostream>
+#include <algorithm>
+#include <stdexcept>
 
 
 Chunk::Chunk(OpenGLContext* context, glm::vec2 pos) : Drawable(context), m_blocks(), m_neighbors{{XPOS, nullptr}, {XNEG, nullptr}, {ZPOS, nullptr}, {ZNEG, nullptr}},
-                                                      pos(pos)
+                                                      pos(pos), m_hasBlockData(false), m_verticalBounds(0, 255), m_occluderSpans(), m_meshVersion(0), m_meshJobs(0),
+                                                      m_sectionRanges(), m_sectionConnectivity(),
+                                                      m_opaqueMesh(), m_transparentMesh(), mcr_hasBlockData(m_hasBlockData)
 {
     std::fill_n(m_blocks.begin(), 65536, EMPTY);
+}
 
-    // create transparent chunk child
-    //TransparentChunk transparentVBOs = TransparentChunk(context, pos);
-    transparent = new TransparentChunk(context, pos);
+Chunk::~Chunk() {
 }
 
 // Does bounds checking with at()
@@ -54,11 +57,88 @@ glm::vec2 Chunk::getChunkPos() const {
     return pos;
 }
 
+glm::ivec2 Chunk::getVerticalBounds() const {
+    return m_verticalBounds;
+}
+
+void Chunk::setVerticalBounds(int minY, int maxY) {
+    m_verticalBounds = glm::ivec2(minY, maxY);
+}
+
+const std::array<glm::ivec2, 4>& Chunk::getOccluderSpans() const {
+    return m_occluderSpans;
+}
+
+void Chunk::setOccluderSpans(const std::array<glm::ivec2, 4> &spans) {
+    m_occluderSpans = spans;
+}
+
+uint64_t Chunk::getMeshVersion() const {
+    return m_meshVersion;
+}
+
+void Chunk::setMeshVersion(uint64_t version) {
+    m_meshVersion = version;
+}
+
+void Chunk::meshJobQueued() {
+    m_meshJobs++;
+}
+
+void Chunk::meshJobDone() {
+    m_meshJobs--;
+}
+
+bool Chunk::isBeingMeshed() const {
+    return m_meshJobs > 0;
+}
+
+const std::array<glm::ivec2, 16>& Chunk::getSectionRanges() const {
+    return m_sectionRanges;
+}
+
+const std::array<SectionConnectivity, 16>& Chunk::getSectionConnectivity() const {
+    return m_sectionConnectivity;
+}
+
+void Chunk::setSections(const std::array<glm::ivec2, 16> &ranges,
+                        const std::array<SectionConnectivity, 16> &connectivity) {
+    m_sectionRanges = ranges;
+    m_sectionConnectivity = connectivity;
+}
+
 // Does bounds checking with at()
 void Chunk::setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t) {
     m_blocks.at(x + 16 * y + 16 * 256 * z) = t;
 }
 
+void Chunk::fillBlockRow(unsigned int x, unsigned int y, unsigned int z, unsigned int length,
+                         BlockType t, bool overwrite) {
+    if (x + length > 16 || y >= 256 || z >= 16) {
+        throw std::out_of_range("Chunk::fillBlockRow: row lies outside the Chunk");
+    }
+    auto first = m_blocks.begin() + (x + 16 * y + 16 * 256 * z);
+    if (overwrite) {
+        std::fill_n(first, length, t);
+    } else {
+        std::replace(first, first + length, EMPTY, t);
+    }
+}
+
+void Chunk::fillBlockColumn(unsigned int x, unsigned int y, unsigned int z, unsigned int height, BlockType t) {
+    if (x >= 16 || y + height > 256 || z >= 16) {
+        throw std::out_of_range("Chunk::fillBlockColumn: column lies outside the Chunk");
+    }
+    BlockType *block = m_blocks.data() + (x + 16 * y + 16 * 256 * z);
+    for (unsigned int i = 0; i < height; i++, block += 16) {
+        *block = t;
+    }
+}
+
+void Chunk::hasBlockData() {
+    m_hasBlockData = true;
+}
+
 void Chunk::linkNeighbor(uPtr<Chunk> &neighbor, Direction dir) {
     if(neighbor != nullptr) {
         this->m_neighbors[dir] = neighbor.get();
@@ -66,6 +146,15 @@ void Chunk::linkNeighbor(uPtr<Chunk> &neighbor, Direction dir) {
     }
 }
 
+void Chunk::unlinkNeighbors() {
+    for (auto &n : m_neighbors) {
+        if (n.second != nullptr) {
+            n.second->m_neighbors[oppositeDirection.at(n.first)] = nullptr;
+            n.second = nullptr;
+        }
+    }
+}
+
 void Chunk::createVBOdata() {
     // DEPRECATED
     // use the section in Terrain::checkForWork(uint i) instead
@@ -82,69 +171,30 @@ void Chunk::createVBOdata() {
     mp_context->glBufferData(GL_ARRAY_BUFFER, interleavedData.size() * sizeof(glm::vec4), interleavedData.data(), GL_STATIC_DRAW);
 }
 
-void Chunk::create(std::vector<glm::vec4> vboData, std::vector<GLuint> idxData)
-{
-    m_count = idxData.size();
-
-    generateIdx();
-    mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufIdx);
-    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, idxData.size() * sizeof(GLuint), idxData.data(), GL_STATIC_DRAW);
-
-    generateInterleavedVBO();
-    mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufInterleavedVBO);
-    mp_context->glBufferData(GL_ARRAY_BUFFER, vboData.size() * sizeof(glm::vec4), vboData.data(), GL_STATIC_DRAW);
-
-    this->m_hasVBOData = true;
+const MeshAllocation& Chunk::getOpaqueMesh() const {
+    return m_opaqueMesh;
 }
 
-void Chunk::createDouble(std::vector<glm::vec4> vboData, std::vector<GLuint> idxData,
-                         std::vector<glm::vec4> vboDataT, std::vector<GLuint> idxDataT)
-{
-    m_count = idxData.size();
-
-    generateIdx();
-    mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufIdx);
-    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, idxData.size() * sizeof(GLuint), idxData.data(), GL_STATIC_DRAW);
-
-    generateInterleavedVBO();
-    mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufInterleavedVBO);
-    mp_context->glBufferData(GL_ARRAY_BUFFER, vboData.size() * sizeof(glm::vec4), vboData.data(), GL_STATIC_DRAW);
-
-    transparent->create(vboDataT, idxDataT);
-
-    this->m_hasVBOData = true;
+const MeshAllocation& Chunk::getTransparentMesh() const {
+    return m_transparentMesh;
 }
 
-TransparentChunk::TransparentChunk(OpenGLContext* context, glm::vec2 pos) :
-    Drawable(context), pos(pos)
-{}
-
-glm::vec2 TransparentChunk::getChunkPos() const {
-    return pos;
+void Chunk::setMeshes(const MeshAllocation &opaque, const MeshAllocation &transparent) {
+    m_opaqueMesh = opaque;
+    m_transparentMesh = transparent;
+    m_count = opaque.indexCount;
+    m_hasVBOData = true;
 }
 
-void TransparentChunk::createVBOdata() {
-    // also DEPRECATED
-    // TODO: remove this the need to define a 'createVBOdata()' from Drawable
-    m_count = idxTransparent.size();
-
-    generateIdx();
-    mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufIdx);
-    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, idxTransparent.size() * sizeof(GLuint), idxTransparent.data(), GL_STATIC_DRAW);
-
-    generateInterleavedVBO();
-    mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufInterleavedVBO);
-    mp_context->glBufferData(GL_ARRAY_BUFFER, interleavedDataTransparent.size() * sizeof(glm::vec4), interleavedDataTransparent.data(), GL_STATIC_DRAW);
+std::pair<MeshAllocation, MeshAllocation> Chunk::takeMeshes() {
+    std::pair<MeshAllocation, MeshAllocation> meshes(m_opaqueMesh, m_transparentMesh);
+    m_opaqueMesh = m_transparentMesh = MeshAllocation();
+    m_count = -1;
+    return meshes;
 }
 
-void TransparentChunk::create(std::vector<glm::vec4> vboDataT, std::vector<GLuint> idxDataT) {
-    m_count = idxDataT.size();
-
-    generateIdx();
-    mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufIdx);
-    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, idxDataT.size() * sizeof(GLuint), idxDataT.data(), GL_STATIC_DRAW);
-
-    generateInterleavedVBO();
-    mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufInterleavedVBO);
-    mp_context->glBufferData(GL_ARRAY_BUFFER, vboDataT.size() * sizeof(glm::vec4), vboDataT.data(), GL_STATIC_DRAW);
+std::pair<MeshAllocation, MeshAllocation> Chunk::releaseMeshes() {
+    m_hasVBOData = false;
+    m_creatingVBOData = false;
+    return takeMeshes();
 }
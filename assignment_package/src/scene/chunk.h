@@ -1,9 +1,13 @@
 #pragma once
 #include "smartpointerhelp.h"
 #include "../drawable.h"
+#include "../mesharena.h"
+#include "sectionconnectivity.h"
 #include <array>
 #include <unordered_map>
 #include <cstddef>
+#include <cstdint>
+#include <utility>
 
 //using namespace std;
 
@@ -50,25 +54,6 @@ struct EnumHash {
 };
 
 
-// A transparentChunk is always a member variable of some
-// chunk; it is a Drawable that only holds the transparent VBOs
-// whereas the parent chunk only holds the opaque VBOs
-class TransparentChunk : public Drawable {
-private:
-    /* The x and z coordinates of the lower left corner
-     * of this Chunk*/
-    glm::vec2 pos;
-public:
-    TransparentChunk(OpenGLContext* context, glm::vec2 pos);
-    glm::vec2 getChunkPos() const;
-    void createVBOdata() override;
-
-    // transparent data
-    std::vector<glm::vec4> interleavedDataTransparent;
-    std::vector<GLuint> idxTransparent;
-    void create(std::vector<glm::vec4> vboDataT, std::vector<GLuint> idxDataT);
-};
-
 // One Chunk is a 16 x 256 x 16 section of the world,
 // containing all the Minecraft blocks in that area.
 // We divide the world into Chunks in order to make
@@ -90,19 +75,93 @@ private:
      * of this Chunk*/
     glm::vec2 pos;
 
+    /* Set once a BlockTypeWorker has finished filling this Chunk. */
+    bool m_hasBlockData;
+
+    /* The y range [x, y] occupied by non-EMPTY blocks, as of the last
+       time this Chunk was meshed. Used for culling. */
+    glm::ivec2 m_verticalBounds;
+
+    /* For each OCCLUDER_CELL x OCCLUDER_CELL square column of this Chunk,
+       indexed x + 2 * z, the y range [x, y) of the longest run that is
+       opaque in every block column of the square, as of the last time
+       this Chunk was meshed. Empty if x == y. Used as occluders. */
+    std::array<glm::ivec2, 4> m_occluderSpans;
+
+    /* Terrain::getMeshVersion() as of the last time this Chunk's
+       VBOs were uploaded or destroyed. */
+    uint64_t m_meshVersion;
+
+    /* Mesh jobs sent to the VBO workers whose results the Terrain has
+       yet to upload. Main thread only. */
+    int m_meshJobs;
+
+    /* For each section, bottom to top, the [x, x + y) range of the opaque
+       index buffer holding its faces, as of the last time this Chunk was
+       meshed. The ranges are laid out in order. */
+    std::array<glm::ivec2, 16> m_sectionRanges;
+
+    /* For each section, bottom to top, which of its faces can see each
+       other, as of the last time this Chunk was meshed. */
+    std::array<SectionConnectivity, 16> m_sectionConnectivity;
+
+    /* Where this Chunk's opaque and transparent meshes live in the
+       Terrain's MeshArena. */
+    MeshAllocation m_opaqueMesh, m_transparentMesh;
+
 public:
+    // Side, in blocks, of the square columns m_occluderSpans describes
+    static constexpr int OCCLUDER_CELL = 8;
+    // The number of 16 x 16 x 16 sections stacked in a Chunk
+    static constexpr int SECTION_COUNT = 16;
+
+    // A readonly reference to m_hasBlockData for external use
+    const bool& mcr_hasBlockData;
+
     Chunk(OpenGLContext* context, glm::vec2 pos);
+    ~Chunk();
     BlockType getBlockAt(unsigned int x, unsigned int y, unsigned int z) const;
     BlockType getBlockAt(int x, int y, int z) const;
     BlockType getAdjacentBlockAt(Direction direction, int x, int y, int z);
     glm::vec2 getChunkPos() const;
-    TransparentChunk* transparent;
+    glm::ivec2 getVerticalBounds() const;
+    void setVerticalBounds(int minY, int maxY);
+    const std::array<glm::ivec2, 4>& getOccluderSpans() const;
+    void setOccluderSpans(const std::array<glm::ivec2, 4> &spans);
+    uint64_t getMeshVersion() const;
+    void setMeshVersion(uint64_t version);
+    /* Counts a mesh job sent to the VBO workers, and one of them taken
+       back, so the Terrain knows when new meshes are on their way. */
+    void meshJobQueued();
+    void meshJobDone();
+    bool isBeingMeshed() const;
+    const std::array<glm::ivec2, 16>& getSectionRanges() const;
+    const std::array<SectionConnectivity, 16>& getSectionConnectivity() const;
+    void setSections(const std::array<glm::ivec2, 16> &ranges,
+                     const std::array<SectionConnectivity, 16> &connectivity);
     void setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t);
+    /* Sets `length` blocks starting at (x, y, z) and running along +X.
+       If overwrite is false, only EMPTY blocks are changed. */
+    void fillBlockRow(unsigned int x, unsigned int y, unsigned int z, unsigned int length,
+                      BlockType t, bool overwrite);
+    /* Sets `height` blocks starting at (x, y, z) and running along +Y. */
+    void fillBlockColumn(unsigned int x, unsigned int y, unsigned int z, unsigned int height, BlockType t);
+    void hasBlockData();
     void linkNeighbor(uPtr<Chunk>& neighbor, Direction dir);
+    /* Clears the pointers between this Chunk and its neighbors,
+       so that it can be deleted. */
+    void unlinkNeighbors();
     void createVBOdata() override;
 
-    /* Given the interleaved VBO and index buffers. Send the data to the GPU. */
-    void create(std::vector<glm::vec4> vboData, std::vector<GLuint> idxData);
-    void createDouble(std::vector<glm::vec4> vboData, std::vector<GLuint> idxData,
-                      std::vector<glm::vec4> vboDataT, std::vector<GLuint> idxDataT);
+    const MeshAllocation& getOpaqueMesh() const;
+    const MeshAllocation& getTransparentMesh() const;
+    /* Records where the Terrain uploaded this Chunk's meshes, and marks
+       it as having VBO data. */
+    void setMeshes(const MeshAllocation &opaque, const MeshAllocation &transparent);
+    /* Hands back the Chunk's meshes so that new ones can take their
+       space. Its VBO flags are left alone, as setMeshes() follows. */
+    std::pair<MeshAllocation, MeshAllocation> takeMeshes();
+    /* Hands back the Chunk's meshes so they can be released, leaving
+       it without VBO data and not being meshed. */
+    std::pair<MeshAllocation, MeshAllocation> releaseMeshes();
 };
@@ -166,12 +166,18 @@ void Cube::createVBOdata()
 void Cube::createInstancedVBOdata(std::vector<glm::vec3> &offsets, std::vector<glm::vec3> &colors) {
     m_numInstances = offsets.size();
 
-    generateOffsetBuf();
+    // The buffers are made once and refilled on every later call.
+    // Re-specifying their storage lets the driver hand us new memory
+    // while the GPU may still be drawing from the old.
+    if(!m_offsetGenerated) {
+        generateOffsetBuf();
+    }
     mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufPosOffset);
-    mp_context->glBufferData(GL_ARRAY_BUFFER, offsets.size() * sizeof(glm::vec3), offsets.data(), GL_STATIC_DRAW);
-
+    mp_context->glBufferData(GL_ARRAY_BUFFER, offsets.size() * sizeof(glm::vec3), offsets.data(), GL_STREAM_DRAW);
 
-    generateCol();
+    if(!m_colGenerated) {
+        generateCol();
+    }
     mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufCol);
-    mp_context->glBufferData(GL_ARRAY_BUFFER, colors.size() * sizeof(glm::vec3), colors.data(), GL_STATIC_DRAW);
+    mp_context->glBufferData(GL_ARRAY_BUFFER, colors.size() * sizeof(glm::vec3), colors.data(), GL_STREAM_DRAW);
 }
@@ -0,0 +1,161 @@
+#include "farterrain.h"
+#include "terrain.h"
+#include <chrono>
+#include <limits>
+
+// The sea level, below which the far terrain is drawn as water or ice
+static const int WATER_LEVEL = 138;
+// How far below the true surface the far terrain sits, so the real
+// Chunks win the depth test where the two overlap
+static const float SINK_DEPTH = 2.f;
+
+// Surface colours of the four biomes and of the sea, matching their blocks' textures
+static const glm::vec3 ICE_COLOR(0.93f, 0.95f, 0.98f);
+static const glm::vec3 MOUNTAIN_COLOR(0.80f, 0.82f, 0.86f);
+static const glm::vec3 DESERT_COLOR(0.87f, 0.80f, 0.56f);
+static const glm::vec3 LAKE_COLOR(0.36f, 0.58f, 0.24f);
+static const glm::vec3 WATER_COLOR(0.22f, 0.38f, 0.72f);
+static const glm::vec3 SEA_ICE_COLOR(0.72f, 0.84f, 0.95f);
+
+FarTerrain::FarTerrain(OpenGLContext *context, const Terrain &terrain)
+    : mcr_terrain(terrain), m_arena(context, 1 << 17, 1 << 19), m_renderQueue(), mp_context(context),
+      m_tiles(), m_build()
+{}
+
+FarTerrain::~FarTerrain() {
+    // The worker reads the Terrain, so let it finish first
+    if (m_build.valid()) {
+        m_build.wait();
+    }
+}
+
+FarTerrain::TileData FarTerrain::buildTile(const Terrain &terrain, int x, int z) {
+    const int n = TILE_SIZE / SAMPLE_STEP + 1;
+    // One extra sample on each side, so normals along the edges match the neighbouring tile's
+    const int m = n + 2;
+    std::vector<float> heights(m * m);
+    std::vector<glm::vec3> colors(m * m);
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < m; j++) {
+            int wx = x + (i - 1) * SAMPLE_STEP, wz = z + (j - 1) * SAMPLE_STEP;
+            glm::vec2 climate;
+            int height = terrain.surfaceHeightAt(wx, wz, climate);
+            float temp = climate.x, humidity = climate.y;
+            glm::vec3 color;
+            if (height < WATER_LEVEL) {
+                color = temp >= 0.5f ? WATER_COLOR : SEA_ICE_COLOR;
+                height = WATER_LEVEL;
+            } else {
+                color = glm::mix(glm::mix(MOUNTAIN_COLOR, ICE_COLOR, humidity),
+                                 glm::mix(DESERT_COLOR, LAKE_COLOR, humidity), temp);
+            }
+            // The top of the surface block
+            heights[i + m * j] = height + 1.f - SINK_DEPTH;
+            colors[i + m * j] = color;
+        }
+    }
+
+    TileData tile;
+    tile.key = toKey(x, z);
+    tile.minY = std::numeric_limits<int>::max();
+    tile.maxY = std::numeric_limits<int>::min();
+    tile.interleaved.reserve(3 * n * n);
+    for (int j = 1; j <= n; j++) {
+        for (int i = 1; i <= n; i++) {
+            float h = heights[i + m * j];
+            glm::vec3 normal = glm::normalize(glm::vec3(heights[i - 1 + m * j] - heights[i + 1 + m * j],
+                                                        2.f * SAMPLE_STEP,
+                                                        heights[i + m * (j - 1)] - heights[i + m * (j + 1)]));
+            tile.interleaved.push_back(glm::vec4((i - 1) * SAMPLE_STEP, h, (j - 1) * SAMPLE_STEP, 1));
+            tile.interleaved.push_back(glm::vec4(normal, 0));
+            tile.interleaved.push_back(glm::vec4(colors[i + m * j], 1));
+            tile.minY = std::min(tile.minY, int(glm::floor(h)));
+            tile.maxY = std::max(tile.maxY, int(glm::ceil(h)));
+        }
+    }
+    tile.indices.reserve(6 * (n - 1) * (n - 1));
+    for (int j = 0; j < n - 1; j++) {
+        for (int i = 0; i < n - 1; i++) {
+            GLuint a = i + n * j, b = a + 1, c = a + n, d = c + 1;
+            tile.indices.insert(tile.indices.end(), {a, c, b, b, c, d});
+        }
+    }
+    return tile;
+}
+
+float FarTerrain::distanceToTile(int x, int z, glm::vec2 pos) {
+    glm::vec2 nearest = glm::clamp(pos, glm::vec2(x, z), glm::vec2(x + TILE_SIZE, z + TILE_SIZE));
+    return glm::length(nearest - pos);
+}
+
+void FarTerrain::update(glm::vec3 playerPos) {
+    glm::vec2 pos(playerPos.x, playerPos.z);
+
+    if (m_build.valid() && m_build.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        TileData data = m_build.get();
+        Tile tile;
+        tile.mesh = m_arena.upload(data.interleaved, data.indices);
+        tile.minY = data.minY;
+        tile.maxY = data.maxY;
+        m_tiles[data.key] = tile;
+    }
+
+    // A tile's width of slack, so walking along a tile border
+    // doesn't build and drop the same tiles over and over
+    for (auto it = m_tiles.begin(); it != m_tiles.end();) {
+        glm::ivec2 corner = toCoords(it->first);
+        if (distanceToTile(corner.x, corner.y, pos) > RADIUS + TILE_SIZE) {
+            m_arena.release(it->second.mesh);
+            it = m_tiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (m_build.valid()) {
+        return;
+    }
+    int minX = int(glm::floor((pos.x - RADIUS) / TILE_SIZE)) * TILE_SIZE;
+    int minZ = int(glm::floor((pos.y - RADIUS) / TILE_SIZE)) * TILE_SIZE;
+    float nearest = std::numeric_limits<float>::max();
+    glm::ivec2 next;
+    for (int x = minX; x <= pos.x + RADIUS; x += TILE_SIZE) {
+        for (int z = minZ; z <= pos.y + RADIUS; z += TILE_SIZE) {
+            float distance = distanceToTile(x, z, pos);
+            if (distance <= RADIUS && distance < nearest && m_tiles.count(toKey(x, z)) == 0) {
+                nearest = distance;
+                next = glm::ivec2(x, z);
+            }
+        }
+    }
+    if (nearest <= RADIUS) {
+        m_build = std::async(std::launch::async, &FarTerrain::buildTile, std::cref(mcr_terrain), next.x, next.y);
+    }
+}
+
+int FarTerrain::draw(SurfaceShader *shaderProgram, const Frustum &frustum, glm::ivec4 nearBounds) {
+    // Any fragment further than FADE_WIDTH inside the loaded area is discarded
+    glm::ivec4 hidden = nearBounds + glm::ivec4(FADE_WIDTH, FADE_WIDTH, -FADE_WIDTH, -FADE_WIDTH);
+    for (const auto &[key, tile] : m_tiles) {
+        glm::ivec2 corner = toCoords(key);
+        if (corner.x >= hidden.x && corner.y >= hidden.y &&
+            corner.x + TILE_SIZE <= hidden.z && corner.y + TILE_SIZE <= hidden.w) {
+            continue;
+        }
+        if (!frustum.intersectsAABB(glm::vec3(corner.x, tile.minY, corner.y),
+                                    glm::vec3(corner.x + TILE_SIZE, tile.maxY, corner.y + TILE_SIZE))) {
+            continue;
+        }
+        m_renderQueue.push(RenderQueue::OPAQUE_PASS, shaderProgram, tile.mesh, glm::vec3(corner.x, 0, corner.y));
+    }
+    return m_renderQueue.submit(m_arena, mp_context);
+}
+
+void FarTerrain::destroy() {
+    m_tiles.clear();
+    m_arena.destroy();
+}
+
+int FarTerrain::getTileCount() const {
+    return m_tiles.size();
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "glm_includes.h"
+#include "frustum.h"
+#include "mesharena.h"
+#include "renderqueue.h"
+#include "surfaceshader.h"
+
+#include <cstdint>
+#include <future>
+#include <unordered_map>
+#include <vector>
+
+class Terrain;
+
+// A coarse heightmap of the world beyond the Chunks that Terrain streams
+// in, so the view reaches the horizon instead of stopping at the edge of
+// the loaded zones.
+//
+// The world is split into square tiles of TILE_SIZE blocks. Each tile is
+// sampled every SAMPLE_STEP blocks straight from Terrain's generation
+// noise and coloured by biome. No Chunks are created for it. Tiles are
+// built one at a time on a worker thread, nearest first, and kept in
+// their own MeshArena.
+//
+// The far terrain sits slightly below the true surface. Over the outer
+// FADE_WIDTH blocks of the loaded area its shader dithers it in beneath
+// the real Chunks, and it is discarded everywhere further inside.
+class FarTerrain {
+public:
+    static constexpr int TILE_SIZE = 512;
+    static constexpr int SAMPLE_STEP = 16;
+    // Tiles reaching within this many blocks of the player are built and drawn
+    static constexpr int RADIUS = 2048;
+    static constexpr int FADE_WIDTH = 32;
+
+private:
+    // The GPU-ready mesh of a tile, built off the main thread
+    struct TileData {
+        int64_t key;
+        int minY, maxY;
+        std::vector<glm::vec4> interleaved;
+        std::vector<GLuint> indices;
+    };
+    struct Tile {
+        MeshAllocation mesh;
+        int minY, maxY;
+    };
+
+    const Terrain &mcr_terrain;
+    MeshArena m_arena;
+    RenderQueue m_renderQueue;
+    OpenGLContext *mp_context;
+
+    // Keyed by toKey() of each tile's lower-left corner
+    std::unordered_map<int64_t, Tile> m_tiles;
+    // The tile being built, if any. Only one is built at a time.
+    std::future<TileData> m_build;
+
+    static TileData buildTile(const Terrain &terrain, int x, int z);
+    // How far the nearest point of the tile at (x, z) lies from pos, on the xz plane
+    static float distanceToTile(int x, int z, glm::vec2 pos);
+
+public:
+    FarTerrain(OpenGLContext *context, const Terrain &terrain);
+    ~FarTerrain();
+
+    // Main thread only. Uploads a finished tile, drops tiles that have
+    // fallen well outside RADIUS of the player, and starts building the
+    // nearest missing tile.
+    void update(glm::vec3 playerPos);
+    // Draws every tile that intersects the frustum and is not entirely
+    // covered by the loaded Chunks, whose xz bounds are given as
+    // (min x, min z, max x, max z). Returns the number of draw calls.
+    int draw(SurfaceShader *shaderProgram, const Frustum &frustum, glm::ivec4 nearBounds);
+    // Deletes every tile's mesh, and the GPU buffers holding them.
+    void destroy();
+
+    int getTileCount() const;
+};
@@ -0,0 +1,41 @@
+#include "frustum.h"
+
+Frustum::Frustum(const glm::mat4 &viewProj)
+    : m_planes()
+{
+    // Gribb & Hartmann: with clip = M * p, the frustum is -w <= x, y, z <= w,
+    // and each of those inequalities is a plane made of two rows of M.
+    // glm is column-major, so row i is (M[0][i], M[1][i], M[2][i], M[3][i]).
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+    }
+    m_planes[0] = rows[3] + rows[0]; // left
+    m_planes[1] = rows[3] - rows[0]; // right
+    m_planes[2] = rows[3] + rows[1]; // bottom
+    m_planes[3] = rows[3] - rows[1]; // top
+    m_planes[4] = rows[3] + rows[2]; // near
+    m_planes[5] = rows[3] - rows[2]; // far
+}
+
+bool Frustum::intersectsAABB(const glm::vec3 &min, const glm::vec3 &max) const {
+    for (const glm::vec4 &plane : m_planes) {
+        // The corner of the box furthest along the plane's normal
+        glm::vec3 p(plane.x >= 0 ? max.x : min.x,
+                    plane.y >= 0 ? max.y : min.y,
+                    plane.z >= 0 ? max.z : min.z);
+        if (glm::dot(glm::vec3(plane), p) + plane.w < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+float Frustum::nearDistance(const glm::vec3 &min, const glm::vec3 &max) const {
+    const glm::vec4 &plane = m_planes[4];
+    // The corner of the box furthest against the plane's normal
+    glm::vec3 p(plane.x >= 0 ? min.x : max.x,
+                plane.y >= 0 ? min.y : max.y,
+                plane.z >= 0 ? min.z : max.z);
+    return (glm::dot(glm::vec3(plane), p) + plane.w) / glm::length(glm::vec3(plane));
+}
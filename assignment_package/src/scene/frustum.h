@@ -0,0 +1,25 @@
+#pragma once
+#include <glm_includes.h>
+#include <array>
+
+// The six clipping planes of a view-projection matrix, in world space.
+// Works for both perspective (camera) and orthographic (shadow light)
+// projections, since the planes are read straight off the matrix.
+class Frustum
+{
+private:
+    // Each plane is (n, d) with n pointing into the frustum, so a point p
+    // is inside the plane iff dot(n, p) + d >= 0. Not normalized.
+    std::array<glm::vec4, 6> m_planes;
+
+public:
+    Frustum(const glm::mat4 &viewProj);
+
+    // Returns false only if the axis-aligned box [min, max] lies entirely
+    // outside one of the planes. May return true for some boxes near the
+    // frustum's corners that are actually outside, which is fine for culling.
+    bool intersectsAABB(const glm::vec3 &min, const glm::vec3 &max) const;
+    // How far in front of the near plane the closest corner of the box
+    // [min, max] lies, in world units. Negative if it reaches behind it.
+    float nearDistance(const glm::vec3 &min, const glm::vec3 &max) const;
+};
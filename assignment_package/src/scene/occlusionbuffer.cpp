@@ -0,0 +1,229 @@
+#include "occlusionbuffer.h"
+
+#include <algorithm>
+
+OcclusionBuffer::OcclusionBuffer()
+    : m_depth(WIDTH * HEIGHT, 1.f), m_viewProj(1.f)
+{}
+
+// Twice the signed area of a screen-space polygon, positive if counter-clockwise
+static float signedArea(const glm::vec3 *corners, int count) {
+    float area = 0.f;
+    for (int i = 0; i < count; i++) {
+        const glm::vec3 &p = corners[i], &q = corners[(i + 1) % count];
+        area += p.x * q.y - q.x * p.y;
+    }
+    return area;
+}
+
+// The counter-clockwise convex hull of the points, by Andrew's monotone
+// chain. Writes at most count points to hull and returns how many.
+static int convexHull(glm::vec3 *points, int count, glm::vec3 *hull) {
+    std::sort(points, points + count, [](const glm::vec3 &p, const glm::vec3 &q) {
+        return p.x < q.x || (p.x == q.x && p.y < q.y);
+    });
+    auto turn = [](const glm::vec3 &o, const glm::vec3 &p, const glm::vec3 &q) {
+        return (p.x - o.x) * (q.y - o.y) - (p.y - o.y) * (q.x - o.x);
+    };
+    int size = 0;
+    for (int i = 0; i < count; i++) {
+        while (size >= 2 && turn(hull[size - 2], hull[size - 1], points[i]) <= 0) {
+            size--;
+        }
+        hull[size++] = points[i];
+    }
+    for (int i = count - 2, lower = size + 1; i >= 0; i--) {
+        while (size >= lower && turn(hull[size - 2], hull[size - 1], points[i]) <= 0) {
+            size--;
+        }
+        hull[size++] = points[i];
+    }
+    // The first point closes the loop, and is already there
+    return size - 1;
+}
+
+void OcclusionBuffer::rasterize(const glm::mat4 &viewProj, const std::vector<OccluderBox> &occluders) {
+    m_viewProj = viewProj;
+    std::fill(m_depth.begin(), m_depth.end(), 1.f);
+
+    for (const OccluderBox &box : occluders) {
+        glm::vec3 a = box.min, b = box.max;
+        // Each face wound counter-clockwise as seen from outside the box
+        const glm::vec3 faces[6][4] = {
+            {{b.x, a.y, a.z}, {b.x, b.y, a.z}, {b.x, b.y, b.z}, {b.x, a.y, b.z}},   // +X
+            {{a.x, a.y, a.z}, {a.x, a.y, b.z}, {a.x, b.y, b.z}, {a.x, b.y, a.z}},   // -X
+            {{a.x, b.y, a.z}, {a.x, b.y, b.z}, {b.x, b.y, b.z}, {b.x, b.y, a.z}},   // +Y
+            {{a.x, a.y, a.z}, {b.x, a.y, a.z}, {b.x, a.y, b.z}, {a.x, a.y, b.z}},   // -Y
+            {{a.x, a.y, b.z}, {b.x, a.y, b.z}, {b.x, b.y, b.z}, {a.x, b.y, b.z}},   // +Z
+            {{a.x, a.y, a.z}, {a.x, b.y, a.z}, {b.x, b.y, a.z}, {b.x, a.y, a.z}}    // -Z
+        };
+
+        // A box wholly past the near plane is drawn as its outline, the
+        // hull of its corners. Its nearest surface is convex, so its
+        // depth is the farthest of its front faces' planes.
+        glm::vec3 corners[8];
+        bool inFront = true;
+        for (int i = 0; i < 8 && inFront; i++) {
+            glm::vec4 clip = m_viewProj * glm::vec4(i & 1 ? b.x : a.x, i & 2 ? b.y : a.y, i & 4 ? b.z : a.z, 1.f);
+            inFront = clip.z >= -clip.w && clip.w > 0;
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            corners[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT, ndc.z);
+        }
+        if (!inFront) {
+            for (const auto &face : faces) {
+                rasterizeFace(face);
+            }
+            continue;
+        }
+        glm::vec3 planes[6];
+        int planeCount = 0;
+        for (const auto &face : faces) {
+            glm::vec3 screen[4];
+            for (int i = 0; i < 4; i++) {
+                glm::vec4 clip = m_viewProj * glm::vec4(face[i], 1.f);
+                glm::vec3 ndc = glm::vec3(clip) / clip.w;
+                screen[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT, ndc.z);
+            }
+            if (signedArea(screen, 4) > 0) {
+                planes[planeCount++] = depthPlane(screen, 4);
+            }
+        }
+        glm::vec3 hull[9];
+        int hullCount = convexHull(corners, 8, hull);
+        if (hullCount >= 3 && planeCount > 0) {
+            rasterizePolygon(hull, hullCount, planes, planeCount);
+        }
+    }
+}
+
+void OcclusionBuffer::rasterizeFace(const glm::vec3 (&corners)[4]) {
+    // Clip against the near plane (z >= -w) in clip space, so faces
+    // running past the camera, like the ground under it, still count
+    glm::vec4 in[4];
+    for (int i = 0; i < 4; i++) {
+        in[i] = m_viewProj * glm::vec4(corners[i], 1.f);
+    }
+    glm::vec4 clipped[5];
+    int count = 0;
+    for (int i = 0; i < 4; i++) {
+        const glm::vec4 &p = in[i], &q = in[(i + 1) % 4];
+        float dp = p.z + p.w, dq = q.z + q.w;
+        if (dp >= 0) {
+            clipped[count++] = p;
+        }
+        if ((dp >= 0) != (dq >= 0)) {
+            clipped[count++] = glm::mix(p, q, dp / (dp - dq));
+        }
+    }
+    if (count < 3) {
+        return;
+    }
+
+    // To pixel coordinates, keeping NDC z as depth
+    glm::vec3 screen[5];
+    for (int i = 0; i < count; i++) {
+        glm::vec3 ndc = glm::vec3(clipped[i]) / clipped[i].w;
+        screen[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT, ndc.z);
+    }
+    // Faces seen from behind come out clockwise
+    if (signedArea(screen, count) <= 0) {
+        return;
+    }
+    glm::vec3 plane = depthPlane(screen, count);
+    rasterizePolygon(screen, count, &plane, 1);
+}
+
+glm::vec3 OcclusionBuffer::depthPlane(const glm::vec3 *corners, int count) {
+    // Newell's method, which copes with corners that nearly line up
+    glm::vec3 normal(0.f), centroid(0.f);
+    for (int i = 0; i < count; i++) {
+        const glm::vec3 &p = corners[i], &q = corners[(i + 1) % count];
+        normal += glm::vec3((p.y - q.y) * (p.z + q.z), (p.z - q.z) * (p.x + q.x), (p.x - q.x) * (p.y + q.y));
+        centroid += p;
+    }
+    centroid /= float(count);
+    float dzdx = -normal.x / normal.z, dzdy = -normal.y / normal.z;
+    return glm::vec3(dzdx, dzdy, centroid.z - dzdx * centroid.x - dzdy * centroid.y);
+}
+
+void OcclusionBuffer::rasterizePolygon(const glm::vec3 *corners, int count, const glm::vec3 *planes, int planeCount) {
+    glm::vec2 lo(corners[0]), hi(corners[0]);
+    for (int i = 1; i < count; i++) {
+        lo = glm::min(lo, glm::vec2(corners[i]));
+        hi = glm::max(hi, glm::vec2(corners[i]));
+    }
+    int minX = std::max(0, static_cast<int>(std::floor(lo.x)));
+    int maxX = std::min(WIDTH - 1, static_cast<int>(std::floor(hi.x)));
+    int minY = std::max(0, static_cast<int>(std::floor(lo.y)));
+    int maxY = std::min(HEIGHT - 1, static_cast<int>(std::floor(hi.y)));
+    if (minX > maxX || minY > maxY) {
+        return;
+    }
+
+    // Edge functions E(x, y) = A * x + B * y + C, positive inside. A pixel
+    // lies wholly inside an edge when E at its centre is at least half
+    // of |A| + |B|, which is E's largest drop toward any of its corners.
+    glm::vec3 edges[9];
+    float margins[9];
+    for (int i = 0; i < count; i++) {
+        const glm::vec3 &p = corners[i], &q = corners[(i + 1) % count];
+        edges[i] = glm::vec3(p.y - q.y, q.x - p.x, p.x * q.y - p.y * q.x);
+        margins[i] = 0.5f * (std::abs(edges[i].x) + std::abs(edges[i].y));
+    }
+
+    for (int y = minY; y <= maxY; y++) {
+        float py = y + 0.5f;
+        float *row = &m_depth[y * WIDTH];
+        for (int x = minX; x <= maxX; x++) {
+            float px = x + 0.5f;
+            bool covered = true;
+            for (int i = 0; i < count && covered; i++) {
+                covered = edges[i].x * px + edges[i].y * py + edges[i].z >= margins[i];
+            }
+            if (!covered) {
+                continue;
+            }
+            // Likewise, the farthest a plane gets within the pixel
+            float z = -1.f;
+            for (int i = 0; i < planeCount; i++) {
+                const glm::vec3 &plane = planes[i];
+                z = std::max(z, plane.x * px + plane.y * py + plane.z +
+                                0.5f * (std::abs(plane.x) + std::abs(plane.y)));
+            }
+            row[x] = std::min(row[x], z);
+        }
+    }
+}
+
+bool OcclusionBuffer::isVisible(glm::vec3 min, glm::vec3 max) const {
+    glm::vec3 ndcMin(1e9f), ndcMax(-1e9f);
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+        glm::vec4 clip = m_viewProj * glm::vec4(corner, 1.f);
+        if (clip.z < -clip.w) {
+            return true;
+        }
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        ndcMin = glm::min(ndcMin, ndc);
+        ndcMax = glm::max(ndcMax, ndc);
+    }
+    if (ndcMax.x < -1 || ndcMin.x > 1 || ndcMax.y < -1 || ndcMin.y > 1) {
+        // Off screen; that is for frustum culling to decide
+        return true;
+    }
+
+    // Every pixel the box's screen rectangle touches
+    int minX = std::max(0, static_cast<int>(std::floor((ndcMin.x * 0.5f + 0.5f) * WIDTH)));
+    int maxX = std::min(WIDTH - 1, static_cast<int>(std::floor((ndcMax.x * 0.5f + 0.5f) * WIDTH)));
+    int minY = std::max(0, static_cast<int>(std::floor((ndcMin.y * 0.5f + 0.5f) * HEIGHT)));
+    int maxY = std::min(HEIGHT - 1, static_cast<int>(std::floor((ndcMax.y * 0.5f + 0.5f) * HEIGHT)));
+    for (int y = minY; y <= maxY; y++) {
+        const float *row = &m_depth[y * WIDTH];
+        for (int x = minX; x <= maxX; x++) {
+            if (ndcMin.z <= row[x]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "glm_includes.h"
+
+#include <vector>
+
+// An axis-aligned box, in world space, that is entirely opaque.
+struct OccluderBox {
+    glm::vec3 min, max;
+    OccluderBox(glm::vec3 min, glm::vec3 max) : min(min), max(max) {}
+};
+
+// A small depth buffer rasterised on the CPU from a few large occluders,
+// used to reject Chunks hidden behind them before they are drawn.
+//
+// The culling is conservative. An occluder only writes the pixels it
+// covers completely, at the farthest depth it reaches within each, and
+// an occludee is tested against every pixel its screen rectangle
+// touches. So nothing seen through a gap, however narrow, is rejected.
+// The price is that the seams between neighbouring occluders hide
+// nothing. Each box is drawn as its whole outline where it can be, so
+// the edges between its own faces leave no seams.
+// Depth is NDC z, with larger values farther away.
+//
+// Touches no OpenGL state, so it can be filled on any thread and
+// exercised without a GPU.
+class OcclusionBuffer {
+public:
+    static const int WIDTH = 256;
+    static const int HEIGHT = 128;
+
+private:
+    std::vector<float> m_depth;
+    glm::mat4 m_viewProj;
+
+    // Rasterises one convex, counter-clockwise (seen from outside) face,
+    // clipped to the near plane
+    void rasterizeFace(const glm::vec3 (&corners)[4]);
+    // Fills the pixels a convex, counter-clockwise screen-space polygon
+    // covers completely, keeping the nearest depth per pixel. The depth
+    // written is the farthest any of the given planes, each (dz/dx,
+    // dz/dy, z at the origin), reaches within the pixel.
+    void rasterizePolygon(const glm::vec3 *corners, int count, const glm::vec3 *planes, int planeCount);
+    // The plane through a planar screen-space polygon, as above
+    static glm::vec3 depthPlane(const glm::vec3 *corners, int count);
+
+public:
+    OcclusionBuffer();
+
+    // Clears the buffer and draws every occluder as seen through viewProj.
+    void rasterize(const glm::mat4 &viewProj, const std::vector<OccluderBox> &occluders);
+    // Could any part of this box be visible past the occluders?
+    // Boxes that reach in front of the near plane always are.
+    bool isVisible(glm::vec3 min, glm::vec3 max) const;
+};
@@ -0,0 +1,47 @@
+#include "occlusionworker.h"
+
+OcclusionWorker::OcclusionWorker(OcclusionBuffer &buffer)
+    : m_buffer(buffer), m_lock(), m_changed(), m_pending(false), m_quit(false),
+      m_viewProj(), m_occluders(), m_thread(&OcclusionWorker::run, this)
+{}
+
+OcclusionWorker::~OcclusionWorker() {
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_quit = true;
+    }
+    m_changed.notify_all();
+    m_thread.join();
+}
+
+void OcclusionWorker::run() {
+    std::unique_lock<std::mutex> lock(m_lock);
+    while (true) {
+        m_changed.wait(lock, [this]() { return m_pending || m_quit; });
+        if (m_quit) {
+            return;
+        }
+        // start() won't touch the job until m_pending is cleared
+        lock.unlock();
+        m_buffer.rasterize(m_viewProj, m_occluders);
+        lock.lock();
+        m_pending = false;
+        m_changed.notify_all();
+    }
+}
+
+void OcclusionWorker::start(const glm::mat4 &viewProj, std::vector<OccluderBox> occluders) {
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_changed.wait(lock, [this]() { return !m_pending; });
+        m_viewProj = viewProj;
+        m_occluders = std::move(occluders);
+        m_pending = true;
+    }
+    m_changed.notify_all();
+}
+
+void OcclusionWorker::wait() {
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_changed.wait(lock, [this]() { return !m_pending; });
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "occlusionbuffer.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One thread, kept for the life of the worker, that rasterises a frame's
+// occluders into an OcclusionBuffer while the caller carries on.
+class OcclusionWorker {
+private:
+    OcclusionBuffer &m_buffer;
+    std::mutex m_lock;
+    std::condition_variable m_changed;
+    bool m_pending;     // A job was started and hasn't finished
+    bool m_quit;
+    glm::mat4 m_viewProj;
+    std::vector<OccluderBox> m_occluders;
+    std::thread m_thread;
+
+    void run();
+
+public:
+    OcclusionWorker(OcclusionBuffer &buffer);
+    ~OcclusionWorker();
+
+    // Waits for the last job, then starts rasterising these occluders
+    void start(const glm::mat4 &viewProj, std::vector<OccluderBox> occluders);
+    // Returns once the buffer holds the last job's occluders
+    void wait();
+};
@@ -0,0 +1,242 @@
+#include "particlesystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// By ParticleType: gravity, drag, lifetime, size, alpha
+const std::array<ParticleSystem::Behaviour, 3> ParticleSystem::BEHAVIOURS = {{
+    {-20.f, 0.5f, 1.2f, 0.15f, 1.f},  // DEBRIS falls, and is gone before it could be seen to pass through the ground
+    {-4.f, 1.f, 0.8f, 0.06f, 1.f},    // SPARK leaps up and floats back down
+    {3.f, 2.f, 2.5f, 0.08f, 0.6f},    // BUBBLE rises to a steady speed
+}};
+
+// Roughly the average colour of each block's texture
+static glm::vec3 debrisColor(BlockType type) {
+    switch(type) {
+    case GRASS: return glm::vec3(0.36f, 0.6f, 0.25f);
+    case DIRT: return glm::vec3(0.47f, 0.33f, 0.23f);
+    case STONE: return glm::vec3(0.5f, 0.5f, 0.5f);
+    case SNOW: return glm::vec3(0.95f, 0.97f, 1.f);
+    case DESERT: return glm::vec3(0.86f, 0.81f, 0.6f);
+    case ICE: return glm::vec3(0.6f, 0.75f, 0.95f);
+    case WOOD: return glm::vec3(0.4f, 0.31f, 0.19f);
+    case LEAF: return glm::vec3(0.2f, 0.45f, 0.15f);
+    case CACTUS: return glm::vec3(0.33f, 0.5f, 0.2f);
+    case MUSHROOM_STEM: return glm::vec3(0.85f, 0.82f, 0.75f);
+    case MUSHROOM_CAP: return glm::vec3(0.75f, 0.15f, 0.12f);
+    default: return glm::vec3(0.5f, 0.5f, 0.5f);
+    }
+}
+
+ParticleSystem::Pool::Pool(OpenGLContext *context)
+    : posX(), posY(), posZ(), velX(), velY(), velZ(), colR(), colG(), colB(), life(),
+      offsets(), colors(), cube(context)
+{}
+
+int ParticleSystem::Pool::size() const {
+    return life.size();
+}
+
+std::array<std::vector<float>*, 10> ParticleSystem::Pool::components() {
+    return {&posX, &posY, &posZ, &velX, &velY, &velZ, &colR, &colG, &colB, &life};
+}
+
+ParticleSystem::ParticleSystem(OpenGLContext *context)
+    : m_pools(), m_count(0), m_emissionScale(1.f), m_updateMs(0.f), m_frameMs(0.f),
+      m_bubbleDebt(0.f), m_sparkDebt(0.f), m_random(1234)
+{
+    for (uPtr<Pool> &pool : m_pools) {
+        pool = mkU<Pool>(context);
+        for (std::vector<float> *component : pool->components()) {
+            component->reserve(MAX_PARTICLES);
+        }
+    }
+}
+
+void ParticleSystem::createVBOdata() {
+    for (uPtr<Pool> &pool : m_pools) {
+        pool->cube.createVBOdata();
+    }
+}
+
+void ParticleSystem::destroyVBOdata() {
+    for (uPtr<Pool> &pool : m_pools) {
+        pool->cube.destroyVBOdata();
+        pool->cube.clearOffsetBuf();
+    }
+}
+
+float ParticleSystem::random(float min, float max) {
+    return std::uniform_real_distribution<float>(min, max)(m_random);
+}
+
+int ParticleSystem::emissionCount(float rate, float dT, float *debt) {
+    *debt += rate * m_emissionScale * dT;
+    int count = int(*debt);
+    *debt -= count;
+    return count;
+}
+
+void ParticleSystem::spawn(ParticleType type, glm::vec3 pos, glm::vec3 vel, glm::vec3 color) {
+    if (m_count >= MAX_PARTICLES) {
+        return;
+    }
+    Pool &pool = *m_pools[int(type)];
+    pool.posX.push_back(pos.x);
+    pool.posY.push_back(pos.y);
+    pool.posZ.push_back(pos.z);
+    pool.velX.push_back(vel.x);
+    pool.velY.push_back(vel.y);
+    pool.velZ.push_back(vel.z);
+    pool.colR.push_back(color.r);
+    pool.colG.push_back(color.g);
+    pool.colB.push_back(color.b);
+    // Staggered, so a burst doesn't vanish all at once
+    pool.life.push_back(BEHAVIOURS[int(type)].lifetime * random(0.6f, 1.f));
+    m_count++;
+}
+
+void ParticleSystem::emitDebris(glm::ivec3 block, BlockType type) {
+    glm::vec3 color = debrisColor(type);
+    int count = std::max(1, int(48 * m_emissionScale));
+    for (int i = 0; i < count; i++) {
+        glm::vec3 pos = glm::vec3(block) + glm::vec3(random(0.f, 1.f), random(0.f, 1.f), random(0.f, 1.f));
+        glm::vec3 vel = (pos - glm::vec3(block) - 0.5f) * 6.f + glm::vec3(0.f, 3.f, 0.f);
+        spawn(ParticleType::DEBRIS, pos, vel, color * random(0.8f, 1.1f));
+    }
+}
+
+void ParticleSystem::emitSparks(const Terrain &terrain, glm::vec3 centre, float dT) {
+    // Sample columns around centre for lava open to the air. Each one
+    // found sends up a small fountain.
+    int samples = emissionCount(400.f, dT, &m_sparkDebt);
+    for (int i = 0; i < samples; i++) {
+        int x = int(std::floor(centre.x + random(-24.f, 24.f)));
+        int z = int(std::floor(centre.z + random(-24.f, 24.f)));
+        if (!terrain.hasChunkAt(x, z)) {
+            continue;
+        }
+        for (int y = int(centre.y) + 8; y > int(centre.y) - 16 && y > 0; y--) {
+            BlockType type = terrain.getBlockAt(x, y, z);
+            if (type == EMPTY) {
+                continue;
+            }
+            if (type == LAVA) {
+                for (int j = 0; j < 6; j++) {
+                    glm::vec3 pos(x + random(0.f, 1.f), y + 1.f, z + random(0.f, 1.f));
+                    glm::vec3 vel(random(-1.f, 1.f), random(3.f, 7.f), random(-1.f, 1.f));
+                    spawn(ParticleType::SPARK, pos, vel, glm::vec3(1.f, random(0.3f, 0.7f), 0.1f));
+                }
+            }
+            break;
+        }
+    }
+}
+
+void ParticleSystem::emitBubbles(glm::vec3 camera, float dT) {
+    int count = emissionCount(300.f, dT, &m_bubbleDebt);
+    for (int i = 0; i < count; i++) {
+        glm::vec3 pos = camera + glm::vec3(random(-4.f, 4.f), random(-3.f, 1.f), random(-4.f, 4.f));
+        glm::vec3 vel(random(-0.3f, 0.3f), random(0.f, 1.f), random(-0.3f, 0.3f));
+        spawn(ParticleType::BUBBLE, pos, vel, glm::vec3(0.75f, 0.85f, 1.f));
+    }
+}
+
+void ParticleSystem::update(float dT) {
+    auto start = std::chrono::steady_clock::now();
+    m_count = 0;
+    for (int type = 0; type < 3; type++) {
+        updatePool(*m_pools[type], BEHAVIOURS[type], dT);
+        m_count += m_pools[type]->size();
+    }
+    m_frameMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ParticleSystem::updatePool(Pool &pool, const Behaviour &behaviour, float dT) {
+    int count = pool.size();
+    float damping = std::max(0.f, 1.f - behaviour.drag * dT);
+    float lift = behaviour.gravity * dT;
+
+    // One array at a time, with nothing in the loops but arithmetic
+    float *posX = pool.posX.data(), *posY = pool.posY.data(), *posZ = pool.posZ.data();
+    float *velX = pool.velX.data(), *velY = pool.velY.data(), *velZ = pool.velZ.data();
+    float *life = pool.life.data();
+    for (int i = 0; i < count; i++) {
+        velX[i] *= damping;
+        posX[i] += velX[i] * dT;
+    }
+    for (int i = 0; i < count; i++) {
+        velY[i] = (velY[i] + lift) * damping;
+        posY[i] += velY[i] * dT;
+    }
+    for (int i = 0; i < count; i++) {
+        velZ[i] *= damping;
+        posZ[i] += velZ[i] * dT;
+    }
+    for (int i = 0; i < count; i++) {
+        life[i] -= dT;
+    }
+
+    // Move the last live particle into each dead one's place
+    std::array<std::vector<float>*, 10> components = pool.components();
+    for (int i = count - 1; i >= 0; i--) {
+        if (life[i] > 0.f) {
+            continue;
+        }
+        count--;
+        if (i != count) {
+            for (std::vector<float> *component : components) {
+                (*component)[i] = (*component)[count];
+            }
+        }
+    }
+    for (std::vector<float> *component : components) {
+        component->resize(count);
+    }
+}
+
+void ParticleSystem::adjustToBudget(float ms) {
+    m_updateMs = 0.9f * m_updateMs + 0.1f * ms;
+    if (m_updateMs > BUDGET_MS) {
+        m_emissionScale = std::max(0.05f, m_emissionScale * 0.9f);
+    } else if (m_updateMs < 0.5f * BUDGET_MS) {
+        m_emissionScale = std::min(1.f, m_emissionScale * 1.02f);
+    }
+}
+
+void ParticleSystem::draw(SurfaceShader *shader) {
+    auto start = std::chrono::steady_clock::now();
+    for (int type = 0; type < 3; type++) {
+        Pool &pool = *m_pools[type];
+        int count = pool.size();
+        if (count == 0) {
+            continue;
+        }
+        const Behaviour &behaviour = BEHAVIOURS[type];
+
+        // The instance buffers take whole vectors
+        pool.offsets.resize(count);
+        pool.colors.resize(count);
+        for (int i = 0; i < count; i++) {
+            pool.offsets[i] = glm::vec3(pool.posX[i], pool.posY[i], pool.posZ[i]);
+            pool.colors[i] = glm::vec3(pool.colR[i], pool.colG[i], pool.colB[i]);
+        }
+        pool.cube.createInstancedVBOdata(pool.offsets, pool.colors);
+
+        shader->setModelMatrix(glm::scale(glm::mat4(1.f), glm::vec3(behaviour.size)) *
+                               glm::translate(glm::mat4(1.f), glm::vec3(-0.5f)));
+        shader->setGeometryColor(glm::vec4(1.f, 1.f, 1.f, behaviour.alpha));
+        shader->drawInstanced(pool.cube);
+    }
+    float drawMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    adjustToBudget(m_frameMs + drawMs);
+    m_frameMs = 0.f;
+}
+
+int ParticleSystem::getParticleCount() const {
+    return m_count;
+}
+
+float ParticleSystem::getUpdateMs() const {
+    return m_updateMs;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "cube.h"
+#include "terrain.h"
+#include "surfaceshader.h"
+#include "smartpointerhelp.h"
+
+#include <array>
+#include <random>
+#include <vector>
+
+enum class ParticleType : unsigned char {
+    DEBRIS, SPARK, BUBBLE
+};
+
+// Block-break debris, lava sparks and underwater bubbles. The particles
+// of each type are stored as a structure of arrays, one array per
+// component, so update() streams through each array in a plain loop the
+// compiler can vectorise. Each type is drawn with one instanced draw of
+// a Cube.
+//
+// update() and the upload in draw() share a fixed CPU budget. While they
+// run over it, the emitters are scaled back, so the particle count
+// settles wherever the work fits.
+class ParticleSystem {
+public:
+    static const int MAX_PARTICLES = 100000; // Of every type together
+    static constexpr float BUDGET_MS = 1.f;
+
+private:
+    // Shared by every particle of a type
+    struct Behaviour {
+        float gravity;  // Vertical acceleration; positive rises
+        float drag;     // Fraction of the velocity lost per second
+        float lifetime; // In seconds
+        float size;     // Edge length of the cube drawn
+        float alpha;
+    };
+    static const std::array<Behaviour, 3> BEHAVIOURS;
+
+    struct Pool {
+        std::vector<float> posX, posY, posZ;
+        std::vector<float> velX, velY, velZ;
+        std::vector<float> colR, colG, colB;
+        std::vector<float> life;                // Seconds left
+        std::vector<glm::vec3> offsets, colors; // Gathered for the instance buffers
+        Cube cube;
+
+        Pool(OpenGLContext *context);
+        int size() const;
+        // Every per-particle array, to resize or compact them all alike
+        std::array<std::vector<float>*, 10> components();
+    };
+
+    std::array<uPtr<Pool>, 3> m_pools; // By ParticleType
+    int m_count;
+    float m_emissionScale;  // Multiplies every emission rate, to keep to the budget
+    float m_updateMs;       // Smoothed CPU time of update() and draw() together
+    float m_frameMs;        // CPU time of the last update(), added to by draw()
+    float m_bubbleDebt, m_sparkDebt; // Fractions of a particle owed by the emitters
+    std::mt19937 m_random;
+
+    float random(float min, float max);
+    // Emits rate * dT particles on average, carrying the fraction over in debt
+    int emissionCount(float rate, float dT, float *debt);
+    void updatePool(Pool &pool, const Behaviour &behaviour, float dT);
+    void adjustToBudget(float ms);
+
+public:
+    ParticleSystem(OpenGLContext *context);
+
+    void createVBOdata();
+    void destroyVBOdata();
+
+    // Dropped if MAX_PARTICLES are already alive
+    void spawn(ParticleType type, glm::vec3 pos, glm::vec3 vel, glm::vec3 color);
+    // Bursts the block at this position into debris of its colour
+    void emitDebris(glm::ivec3 block, BlockType type);
+    // Sparks from lava with air above it, in the loaded Chunks near centre
+    void emitSparks(const Terrain &terrain, glm::vec3 centre, float dT);
+    // Bubbles around the camera, for when it is under water
+    void emitBubbles(glm::vec3 camera, float dT);
+
+    void update(float dT);
+    // Uploads each type's particles and draws them with shader, which
+    // should be built from instanced.vert.glsl
+    void draw(SurfaceShader *shader);
+
+    int getParticleCount() const;
+    float getUpdateMs() const;
+};
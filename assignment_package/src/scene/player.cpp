@@ -236,19 +236,21 @@ BlockType Player::playerInBlockType(const Terrain &terrain) {
     return terrain.getBlockAt(mcr_camera.mcr_position.x, mcr_camera.mcr_position.y, mcr_camera.mcr_position.z);
 }
 
-void Player::removeBlock(Terrain *terrain) {
+BlockType Player::removeBlock(Terrain *terrain, glm::ivec3 *out_blockHit) {
     vec3 dir = normalize(m_forward) * 3.f; // change dist to 3 units away max
     float out_dist = 0.f;
-    ivec3 out_blockHit = ivec3();
 
-    if (gridMarch(m_camera.mcr_position, dir, *terrain, &out_dist, &out_blockHit)) {
+    if (gridMarch(m_camera.mcr_position, dir, *terrain, &out_dist, out_blockHit)) {
 //        std::cout << "removed block" << std::endl;
 
         // remove block @ out_blockHit pos in terrain unless it is BEDROCK which is unremovable (milestone 2)
-        if(terrain->getBlockAt(out_blockHit.x, out_blockHit.y, out_blockHit.z) != BEDROCK) {
-        terrain->setBlockAt(out_blockHit.x, out_blockHit.y, out_blockHit.z, EMPTY);
+        BlockType removed = terrain->getBlockAt(out_blockHit->x, out_blockHit->y, out_blockHit->z);
+        if(removed != BEDROCK) {
+        terrain->editBlockAt(out_blockHit->x, out_blockHit->y, out_blockHit->z, EMPTY);
+        return removed;
         }
     }
+    return EMPTY;
 }
 
 void Player::placeBlock(Terrain *terrain, BlockType type) {
@@ -272,7 +274,7 @@ void Player::placeBlock(Terrain *terrain, BlockType type) {
 
         // place block at offset-ed position
         vec3 target = vec3(out_blockHit) + diff;
-        terrain->setBlockAt(target.x, target.y, target.z, type);
+        terrain->editBlockAt(target.x, target.y, target.z, type);
     }
 }
 
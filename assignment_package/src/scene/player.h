@@ -49,7 +49,8 @@ public:
     QString lookAsQString() const;
 
     // Player interacts with terrain
-    void removeBlock(Terrain *terrain);
+    // Returns the type of the block removed, or EMPTY if there was none
+    BlockType removeBlock(Terrain *terrain, glm::ivec3 *out_blockHit);
     void placeBlock(Terrain *terrain, BlockType type);
     BlockType playerInBlockType(const Terrain &terrain);
 };
@@ -0,0 +1,104 @@
+#include "regionfile.h"
+#include <QByteArray>
+#include <QSaveFile>
+#include <cstring>
+
+template<class T>
+static void appendValue(QByteArray &out, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+template<class T>
+static void appendArray(QByteArray &out, const std::vector<T> &values) {
+    appendValue<uint32_t>(out, values.size());
+    out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+static void appendBlocks(QByteArray &out, const Chunk *chunk) {
+    // Run-length encode in storage order; terrain is mostly long vertical
+    // spans of one type, so this is usually a few thousand runs.
+    QByteArray runs;
+    uint32_t runCount = 0;
+    BlockType current = chunk->getBlockAt(0, 0, 0);
+    uint16_t length = 0;
+    for (int z = 0; z < 16; z++) {
+        for (int y = 0; y < 256; y++) {
+            for (int x = 0; x < 16; x++) {
+                BlockType t = chunk->getBlockAt(x, y, z);
+                if (t != current || length == UINT16_MAX) {
+                    appendValue<uint16_t>(runs, length);
+                    appendValue<uint8_t>(runs, current);
+                    runCount++;
+                    current = t;
+                    length = 0;
+                }
+                length++;
+            }
+        }
+    }
+    appendValue<uint16_t>(runs, length);
+    appendValue<uint8_t>(runs, current);
+    runCount++;
+
+    appendValue<uint32_t>(out, runCount);
+    out.append(runs);
+}
+
+QString RegionFile::fileName(int rx, int rz) {
+    return QString("r.%1.%2.mcr").arg(rx).arg(rz);
+}
+
+RegionFile::RegionFile(const QString &path, int rx, int rz, unsigned int chunkCount, bool hasMeshes)
+    : m_file(path), m_rx(rx), m_rz(rz), m_chunkCount(chunkCount),
+      m_hasMeshes(hasMeshes), m_chunksWritten(0), m_ok(true)
+{}
+
+bool RegionFile::writeBytes(const QByteArray &bytes) {
+    m_ok = m_ok && m_file.write(bytes) == bytes.size();
+    return m_ok;
+}
+
+bool RegionFile::open() {
+    if (!m_file.open(QIODevice::WriteOnly)) {
+        m_ok = false;
+        return false;
+    }
+    QByteArray header;
+    appendValue<uint32_t>(header, MAGIC);
+    appendValue<uint32_t>(header, VERSION);
+    appendValue<int32_t>(header, m_rx);
+    appendValue<int32_t>(header, m_rz);
+    appendValue<uint32_t>(header, m_hasMeshes ? 1 : 0);
+    appendValue<uint32_t>(header, m_chunkCount);
+    return writeBytes(header);
+}
+
+bool RegionFile::writeChunk(const Chunk *chunk, const ChunkVBOData *mesh) {
+    if (m_hasMeshes != (mesh != nullptr)) {
+        m_ok = false;
+        return false;
+    }
+    QByteArray out;
+    glm::vec2 pos = chunk->getChunkPos();
+    appendValue<int32_t>(out, pos.x);
+    appendValue<int32_t>(out, pos.y);
+    appendBlocks(out, chunk);
+    if (mesh != nullptr) {
+        appendArray(out, mesh->m_vboDataOpaque);
+        appendArray(out, mesh->m_idxDataOpaque);
+        appendArray(out, mesh->m_vboDataTransparent);
+        appendArray(out, mesh->m_idxDataTransparent);
+    }
+    m_chunksWritten++;
+    return writeBytes(out);
+}
+
+bool RegionFile::commit() {
+    if (!m_ok || m_chunksWritten != m_chunkCount) {
+        m_file.cancelWriting();
+        return false;
+    }
+    return m_file.commit();
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "chunk.h"
+#include "chunkvbodata.h"
+#include <QSaveFile>
+#include <QString>
+#include <vector>
+
+// On-disk format for pregenerated terrain. The world is split into
+// regions of REGION_SIZE x REGION_SIZE Chunks, each stored in its own
+// file named r.<rx>.<rz>.mcr, where (rx, rz) is the region's index.
+//
+// All values are written in native byte order (little-endian on every
+// platform we build for):
+//   u32 magic ("MCRG"), u32 version, i32 rx, i32 rz,
+//   u32 flags (bit 0: meshes present), u32 chunk count,
+//   then per Chunk:
+//     i32 x, i32 z (lower-left corner in world space),
+//     u32 run count, runs of (u16 length, u8 BlockType) covering the
+//         65536 blocks in Chunk storage order (x + 16 * y + 16 * 256 * z),
+//     if meshes are present, for the opaque then the transparent mesh:
+//         u32 vec4 count, vec4 data, u32 index count, u32 indices.
+//
+// Only tools/pregen writes this format, and nothing reads it yet: the
+// game still generates every Chunk itself. Loading regions would also
+// need the culling data the mesher now produces (vertical bounds,
+// occluder spans, section ranges and connectivity), which the stored
+// meshes lack, so it is left for a VERSION 2.
+class RegionFile {
+private:
+    QSaveFile m_file;
+    int m_rx, m_rz;
+    unsigned int m_chunkCount;
+    bool m_hasMeshes;
+    unsigned int m_chunksWritten;
+    bool m_ok;
+
+    bool writeBytes(const QByteArray &bytes);
+
+public:
+    static const int REGION_SIZE = 32;
+    static const unsigned int MAGIC = 0x4752434d;
+    static const unsigned int VERSION = 1;
+
+    /* The file name of the region with the given index. */
+    static QString fileName(int rx, int rz);
+
+    /* Prepares to write a region of chunkCount Chunks to path. The file is
+       written via QSaveFile, so it only appears once commit() succeeds;
+       that is what lets an interrupted pregeneration run resume. */
+    RegionFile(const QString &path, int rx, int rz, unsigned int chunkCount, bool hasMeshes);
+
+    /* Opens the file and writes the header. */
+    bool open();
+    /* Appends one Chunk. mesh must be non-null iff the region has meshes. */
+    bool writeChunk(const Chunk *chunk, const ChunkVBOData *mesh);
+    /* Moves the finished file into place. Fails if any write failed or
+       fewer than chunkCount Chunks were written. */
+    bool commit();
+};
@@ -165,15 +165,33 @@ static glm::vec3 getUV(BlockType t, Direction direction) {
     }
 }
 
-const static glm::vec3 uvOffset(int i) {
+// The layer of the block TextureArray holding the atlas tile getUV() points at.
+static float getTextureLayer(BlockType t, Direction direction) {
+    glm::vec3 uv = getUV(t, direction);
+    return std::round(uv.x * 16.f) + 16.f * std::round(uv.y * 16.f);
+}
+
+// Does this block's texture scroll, like flowing water and lava?
+static bool isTextureAnimated(BlockType t) {
+    return getUV(t, YPOS).z == 1;
+}
+
+// The UV of the i-th corner of a block face, within its texture layer.
+const static glm::vec2 uvCorner(int i) {
     switch (i) {
         case 1:
-            return glm::vec3(1.f / 16.f, 0, 0);
+            return glm::vec2(1, 0);
         case 2:
-            return glm::vec3(1.f / 16.f, 1.f / 16.f, 0);
+            return glm::vec2(1, 1);
         case 3:
-            return glm::vec3(0, 1.f / 16.f, 0);
+            return glm::vec2(0, 1);
         default:
-            return glm::vec3();
+            return glm::vec2();
     }
 };
+
+// The vertex colour attribute of a block face's i-th corner: its UV
+// within the texture layer, the layer, and 1 if the texture scrolls.
+static glm::vec4 blockFaceTexCoord(BlockType t, Direction direction, int i) {
+    return glm::vec4(uvCorner(i), getTextureLayer(t, direction), isTextureAnimated(t) ? 1.f : 0.f);
+}
@@ -0,0 +1,76 @@
+#include "sectionconnectivity.h"
+#include <vector>
+
+SectionConnectivity::SectionConnectivity()
+    : m_faces(0)
+{}
+
+SectionConnectivity SectionConnectivity::all() {
+    SectionConnectivity c;
+    c.m_faces = (1ull << 36) - 1;
+    return c;
+}
+
+SectionConnectivity SectionConnectivity::compute(const std::bitset<SIZE * SIZE * SIZE> &opaque) {
+    if (opaque.none()) {
+        return all();
+    }
+    SectionConnectivity c;
+    if (opaque.all()) {
+        return c;
+    }
+
+    // Blocks already reached by some earlier fill, opaque ones included
+    std::bitset<SIZE * SIZE * SIZE> visited = opaque;
+    std::vector<uint16_t> stack;
+    stack.reserve(SIZE * SIZE * SIZE);
+
+    for (int start = 0; start < SIZE * SIZE * SIZE; start++) {
+        if (visited[start]) {
+            continue;
+        }
+        visited[start] = true;
+        stack.push_back(start);
+
+        // One bit per Direction this pocket touches
+        unsigned int touched = 0;
+        while (!stack.empty()) {
+            int i = stack.back();
+            stack.pop_back();
+            int x = i % SIZE, y = (i / SIZE) % SIZE, z = i / (SIZE * SIZE);
+
+            // The neighbour in each Direction, or the face it leaves through
+            const int steps[6] = {1, -1, SIZE, -SIZE, SIZE * SIZE, -SIZE * SIZE};
+            const bool onFace[6] = {x == SIZE - 1, x == 0, y == SIZE - 1, y == 0, z == SIZE - 1, z == 0};
+            for (int d = 0; d < 6; d++) {
+                if (onFace[d]) {
+                    touched |= 1u << d;
+                    continue;
+                }
+                int n = i + steps[d];
+                if (!visited[n]) {
+                    visited[n] = true;
+                    stack.push_back(n);
+                }
+            }
+        }
+
+        for (int a = 0; a < 6; a++) {
+            for (int b = 0; b < 6; b++) {
+                if ((touched >> a & 1) && (touched >> b & 1)) {
+                    c.connect(Direction(a), Direction(b));
+                }
+            }
+        }
+    }
+    return c;
+}
+
+void SectionConnectivity::connect(Direction a, Direction b) {
+    m_faces |= 1ull << (a * 6 + b);
+    m_faces |= 1ull << (b * 6 + a);
+}
+
+bool SectionConnectivity::isConnected(Direction a, Direction b) const {
+    return (m_faces >> (a * 6 + b)) & 1;
+}
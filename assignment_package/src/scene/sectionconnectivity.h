@@ -0,0 +1,31 @@
+#pragma once
+#include <bitset>
+#include <cstdint>
+
+// Defined in chunk.h, which stores a SectionConnectivity per section
+enum Direction : unsigned char;
+
+// Which of the six faces of a 16 x 16 x 16 section of a Chunk can be
+// seen from one another through the section's non-opaque blocks.
+// Two faces are connected if a single connected pocket of non-opaque
+// blocks touches both of them.
+class SectionConnectivity {
+private:
+    // Bit a * 6 + b is set if face a connects to face b. Symmetric.
+    uint64_t m_faces;
+
+public:
+    static const int SIZE = 16;
+
+    // Connects no faces.
+    SectionConnectivity();
+    // Connects every face to every other, as for an empty section.
+    static SectionConnectivity all();
+
+    // Flood fills the non-opaque blocks of a section, where bit
+    // x + 16 * y + 256 * z of opaque is set for each opaque block.
+    static SectionConnectivity compute(const std::bitset<SIZE * SIZE * SIZE> &opaque);
+
+    void connect(Direction a, Direction b);
+    bool isConnected(Direction a, Direction b) const;
+};
@@ -0,0 +1,51 @@
+#include "structurequeue.h"
+
+StructureQueue::StructureQueue()
+    : m_pending(), m_pushed(), m_lock()
+{}
+
+void StructureQueue::push(StructureBatch &batch) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (auto &bucket : batch) {
+        std::vector<StructurePlacement> &pending = m_pending[bucket.first];
+        pending.insert(pending.end(), bucket.second.begin(), bucket.second.end());
+        m_pushed.insert(bucket.first);
+    }
+    batch.clear();
+}
+
+std::vector<StructurePlacement> StructureQueue::take(int64_t key) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    std::vector<StructurePlacement> placements;
+    auto it = m_pending.find(key);
+    if (it != m_pending.end()) {
+        placements = std::move(it->second);
+        m_pending.erase(it);
+    }
+    return placements;
+}
+
+std::vector<int64_t> StructureQueue::takePushedKeys() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    std::vector<int64_t> keys(m_pushed.begin(), m_pushed.end());
+    m_pushed.clear();
+    return keys;
+}
+
+void StructureQueue::dropIf(const std::function<bool(int64_t)> &predicate) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (auto it = m_pending.begin(); it != m_pending.end();) {
+        if (predicate(it->first)) {
+            m_pushed.erase(it->first);
+            it = m_pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void StructureQueue::clear() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_pending.clear();
+    m_pushed.clear();
+}
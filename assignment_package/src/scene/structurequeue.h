@@ -0,0 +1,52 @@
+#pragma once
+#include "chunk.h"
+#include "voxelstamp.h"
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// One placement of a structure stamp (tree, cactus, mushroom).
+// The anchor is in world space; a placement is recorded once for every
+// Chunk the stamp overlaps, and each Chunk writes only its own part.
+struct StructurePlacement {
+    const VoxelStamp *stamp;
+    glm::ivec3 anchor;
+    StructurePlacement(const VoxelStamp *stamp, glm::ivec3 anchor)
+        : stamp(stamp), anchor(anchor)
+    {}
+};
+
+// All of the structures placed while generating one Chunk,
+// bucketed by the key (see toKey) of each Chunk they overlap.
+using StructureBatch = std::unordered_map<int64_t, std::vector<StructurePlacement>>;
+
+// Holds the structure placements that a Chunk's generator emitted for
+// *other* Chunks. BlockType workers only ever append to this queue;
+// the main thread drains a Chunk's bucket once that Chunk has its own
+// BlockType data. This way no worker ever writes into a Chunk other
+// than the one it is generating, and structures can freely straddle
+// Chunk borders.
+class StructureQueue {
+private:
+    std::unordered_map<int64_t, std::vector<StructurePlacement>> m_pending;
+    // Keys pushed to since the last takePushedKeys()
+    std::unordered_set<int64_t> m_pushed;
+    std::mutex m_lock;
+
+public:
+    StructureQueue();
+
+    /* Appends every bucket of the batch to the queue. The batch is left empty. */
+    void push(StructureBatch &batch);
+    /* Removes and returns every placement waiting on the Chunk with the given key. */
+    std::vector<StructurePlacement> take(int64_t key);
+    /* Returns the keys of every Chunk that placements were pushed for
+       since the last call, and forgets them. */
+    std::vector<int64_t> takePushedKeys();
+    /* Drops every bucket whose key the predicate returns true for. */
+    void dropIf(const std::function<bool(int64_t)> &predicate);
+    /* Drops everything in the queue. */
+    void clear();
+};
@@ -0,0 +1,86 @@
+#include "structurestamps.h"
+#include <array>
+
+static VoxelStamp buildSnowTree(int start) {
+    VoxelStamp s;
+    int lg_radius = 3;
+    int sm_radius = 2;
+    int shrink = 6;     // higher = slower shrink the radius of foliage
+    for (int i = 0; i < 10; i++) {
+        if (i > start) {
+            int r = (i % 2 == 0 ? lg_radius : sm_radius) - i / shrink;
+            s.setBox(glm::ivec3(-r, i, -r), glm::ivec3(r, i, r), LEAF, StampRule::REPLACE_EMPTY);
+        }
+        if (i < 9) {
+            s.setBlock(glm::ivec3(0, i, 0), WOOD);
+        }
+    }
+    s.compile();
+    return s;
+}
+
+static VoxelStamp buildCactus(int height) {
+    VoxelStamp s;
+    s.setBox(glm::ivec3(0, 0, 0), glm::ivec3(0, height - 1, 0), CACTUS);
+    s.compile();
+    return s;
+}
+
+static VoxelStamp buildMushroom(int radius, int height) {
+    VoxelStamp s;
+    int cap_height = radius * 2.5;
+    int cap_base = height - cap_height;
+    // The wide part of the cap, with its four vertical edges left out to round it
+    for (int i = 0; i < cap_height - 2; i++) {
+        for (int j = -radius; j <= radius; j++) {
+            for (int k = -radius; k <= radius; k++) {
+                if (abs(j) != radius || abs(k) != radius) {
+                    s.setBlock(glm::ivec3(j, cap_base + i, k), MUSHROOM_CAP, StampRule::REPLACE_EMPTY);
+                }
+            }
+        }
+    }
+    // The narrower top of the cap
+    s.setBox(glm::ivec3(-radius + 1, cap_base + cap_height - 2, -radius + 1),
+             glm::ivec3(radius - 1, cap_base + cap_height - 1, radius - 1),
+             MUSHROOM_CAP, StampRule::REPLACE_EMPTY);
+    // The stem
+    s.setBox(glm::ivec3(0, 0, 0), glm::ivec3(0, height - 2, 0), MUSHROOM_STEM);
+    s.compile();
+    return s;
+}
+
+const VoxelStamp& snowTreeStamp(int start) {
+    static const std::array<VoxelStamp, 6> variants = [] {
+        std::array<VoxelStamp, 6> v;
+        for (int i = 0; i < 6; i++) {
+            v[i] = buildSnowTree(i + 1);
+        }
+        return v;
+    }();
+    return variants[glm::clamp(start, 1, 6) - 1];
+}
+
+const VoxelStamp& cactusStamp(int height) {
+    static const std::array<VoxelStamp, 5> variants = [] {
+        std::array<VoxelStamp, 5> v;
+        for (int i = 0; i < 5; i++) {
+            v[i] = buildCactus(i + 3);
+        }
+        return v;
+    }();
+    return variants[glm::clamp(height, 3, 7) - 3];
+}
+
+const VoxelStamp& mushroomStamp(int radius, int height) {
+    static const std::array<VoxelStamp, 3 * 20> variants = [] {
+        std::array<VoxelStamp, 3 * 20> v;
+        for (int r = 0; r < 3; r++) {
+            for (int h = 0; h < 20; h++) {
+                v[r * 20 + h] = buildMushroom(r + 3, h + 15);
+            }
+        }
+        return v;
+    }();
+    return variants[(glm::clamp(radius, 3, 5) - 3) * 20 + glm::clamp(height, 15, 34) - 15];
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include "voxelstamp.h"
+
+// Variant tables for the structures placed by the terrain generator.
+// Every variant is built and compiled once, the first time any of these
+// is called, and shared by all BlockType workers afterwards. Arguments
+// outside the listed ranges are clamped.
+
+/* A snow tree whose foliage starts above trunk height `start`, in [1, 6]. */
+const VoxelStamp& snowTreeStamp(int start);
+/* A cactus `height` blocks tall, in [3, 7]. */
+const VoxelStamp& cactusStamp(int height);
+/* A mushroom with a cap of `radius` in [3, 5], standing `height` in [15, 34]. */
+const VoxelStamp& mushroomStamp(int radius, int height);
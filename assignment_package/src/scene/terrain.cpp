@@ -6,20 +6,28 @@
 
 mutex_type Terrain::m_sharedChunksLock;
 
-Terrain::Terrain(OpenGLContext *context)
+Terrain::Terrain(OpenGLContext *context, bool spawnWorkers)
     : m_chunks(), m_generatedTerrain(), mp_context(context),
       m_chunksThatHaveBlockData(), m_chunksThatHaveBlockDataLock(),
       m_chunksThatHaveVBOs(), m_chunksThatHaveVBOsLock(),
       m_zonesToInstantiate(), m_zonesToInstantiateLock(),
       m_tryExpansionTimer(0.f),
       m_spawnedThreads(), m_threadQueues(), m_threadMutexes(),
-      m_threadIdx(0), m_maxThreads(thread::hardware_concurrency() - 1)
+      m_threadIdx(0), m_maxThreads(thread::hardware_concurrency() - 1),
+      m_meshVersion(0), m_meshArena(context, MESH_PAGE_VERTICES, MESH_PAGE_INDICES), m_renderQueue(),
+      m_transparentChunks(), m_renderSet(), m_renderSetIndex(), m_residency(DEFAULT_MESH_BUDGET)
 {
     /* Our implementation only supports a maximum of 15 threads. */
     if (m_maxThreads > 15) {
         m_maxThreads = 15;
     }
 
+    /* Headless users (e.g. the pregeneration tool) drive generation and
+       meshing from their own threads. */
+    if (!spawnWorkers) {
+        return;
+    }
+
     for (uint i = 0; i < m_maxThreads; i++) {
         m_spawnedThreads.push_back(thread(&Terrain::checkForWork, this, i));
     }
@@ -110,7 +118,9 @@ bool Terrain::hasZoneAt(int x, int z) const {
 uPtr<Chunk>& Terrain::getChunkAt(int x, int z) {
     int xFloor = static_cast<int>(glm::floor(x / 16.f));
     int zFloor = static_cast<int>(glm::floor(z / 16.f));
-    return m_chunks[toKey(16 * xFloor, 16 * zFloor)];
+    // Not operator[], which would insert a null Chunk for a miss, and
+    // which worker threads must not do under a read_only_lock
+    return m_chunks.at(toKey(16 * xFloor, 16 * zFloor));
 }
 
 
@@ -137,6 +147,100 @@ void Terrain::setBlockAt(int x, int y, int z, BlockType t)
     }
 }
 
+void Terrain::editBlockAt(int x, int y, int z, BlockType t) {
+    std::vector<Chunk*> stale;
+    {
+        updatable_lock lock(m_sharedChunksLock);
+        setBlockAt(x, y, z, t);
+        ivec2 chunkOrigin(16 * glm::floor(x / 16.f), 16 * glm::floor(z / 16.f));
+        int localX = x - chunkOrigin.x, localZ = z - chunkOrigin.y;
+        stale.push_back(getChunkAt(x, z).get());
+        std::array<std::pair<bool, ivec2>, 4> borders = {{
+            {localX == 0, ivec2(-1, 0)}, {localX == 15, ivec2(1, 0)},
+            {localZ == 0, ivec2(0, -1)}, {localZ == 15, ivec2(0, 1)},
+        }};
+        for (const auto &border : borders) {
+            if (border.first && hasChunkAt(x + border.second.x, z + border.second.y)) {
+                stale.push_back(getChunkAt(x + border.second.x, z + border.second.y).get());
+            }
+        }
+    }
+    for (Chunk *c : stale) {
+        remeshChunk(c);
+    }
+}
+
+void Terrain::releaseChunkAt(int x, int z) {
+    updatable_lock lock(m_sharedChunksLock);
+    auto it = m_chunks.find(toKey(x, z));
+    if (it == m_chunks.end()) {
+        return;
+    }
+    if (it->second != nullptr) {
+        it->second->unlinkNeighbors();
+        removeFromRenderSet(it->second.get());
+        m_residency.forget(it->first);
+        auto meshes = it->second->releaseMeshes();
+        m_meshArena.release(meshes.first);
+        m_meshArena.release(meshes.second);
+    }
+    m_chunks.erase(it);
+    m_structureQueue.take(toKey(x, z));
+}
+
+void Terrain::destroyMeshes() {
+    for (auto &entry : m_chunks) {
+        if (entry.second != nullptr) {
+            entry.second->releaseMeshes();
+        }
+    }
+    m_renderSet.clear();
+    m_renderSetIndex.clear();
+    m_residency.clear();
+    m_meshArena.destroy();
+}
+
+void Terrain::setMeshBudget(std::size_t bytes) {
+    m_residency.setBudget(bytes);
+    enforceMeshBudget();
+}
+
+const MeshResidency& Terrain::getMeshResidency() const {
+    return m_residency;
+}
+
+std::size_t Terrain::getMeshPageBytes() const {
+    return m_meshArena.getPageBytes();
+}
+
+void Terrain::enforceMeshBudget() {
+    // A Chunk still being meshed would be given new meshes, and drawn,
+    // once forgotten, so it waits until they arrive. So does one that
+    // has no meshes yet to free.
+    auto canFree = [this](int64_t key) {
+        auto found = m_chunks.find(key);
+        return found == m_chunks.end() || found->second == nullptr ||
+               (found->second->mcr_hasVBOData && !found->second->isBeingMeshed());
+    };
+    int64_t key;
+    while (m_residency.takeOverBudget(&key, canFree)) {
+        auto found = m_chunks.find(key);
+        if (found == m_chunks.end() || found->second == nullptr) {
+            continue;
+        }
+        // Meshed again by createZoneBuffers() if its zone comes back
+        Chunk *c = found->second.get();
+        auto meshes = c->releaseMeshes();
+        m_meshArena.release(meshes.first);
+        m_meshArena.release(meshes.second);
+        c->setMeshVersion(++m_meshVersion);
+    }
+}
+
+void Terrain::discardQueuedStructures() {
+    m_structureQueue.clear();
+}
+
 void Terrain::instantiateZoneAt(int x, int z) {
     ivec2 zoneCoord = ivec2(64 * floor(x / 64.f), 64 * floor(z / 64.f));
     for(int i = zoneCoord.x; i < zoneCoord.x+64; i += 16) {
@@ -151,13 +255,34 @@ void Terrain::instantiateZoneAt(int x, int z) {
     m_generatedTerrain.insert(toKey(zoneCoord[0], zoneCoord[1]));
 }
 
-void Terrain::destroyZoneAt(int x, int z) {
+void Terrain::evictZoneAt(int x, int z) {
     ivec2 zoneCoord = ivec2(64 * floor(x / 64.f), 64 * floor(z / 64.f));
     for(int i = zoneCoord.x; i < zoneCoord.x+64; i += 16) {
         for(int j = zoneCoord.y; j < zoneCoord.y+64; j += 16) {
-            if (getChunkAt(i, j)->mcr_hasVBOData) {
-                Chunk* c = getChunkAt(i, j).get();
-                c->destroyVBOdata();
+            Chunk* c = getChunkAt(i, j).get();
+            // Also marks Chunks still being meshed, for when they're done
+            m_residency.evict(toKey(i, j));
+            if (c->mcr_hasVBOData) {
+                removeFromRenderSet(c);
+                c->setMeshVersion(++m_meshVersion);
+            }
+        }
+    }
+    enforceMeshBudget();
+}
+
+void Terrain::restoreZoneAt(int x, int z) {
+    ivec2 zoneCoord = ivec2(64 * floor(x / 64.f), 64 * floor(z / 64.f));
+    for(int i = zoneCoord.x; i < zoneCoord.x+64; i += 16) {
+        for(int j = zoneCoord.y; j < zoneCoord.y+64; j += 16) {
+            if (!m_residency.isEvicted(toKey(i, j))) {
+                continue;
+            }
+            m_residency.restore(toKey(i, j));
+            Chunk* c = getChunkAt(i, j).get();
+            if (c->mcr_hasVBOData) {
+                addToRenderSet(c);
+                c->setMeshVersion(++m_meshVersion);
             }
         }
     }
@@ -168,11 +293,13 @@ void Terrain::createZoneBuffers(int x, int z) {
     for(int i = zoneCoord.x; i < zoneCoord.x+64; i += 16) {
         for(int j = zoneCoord.y; j < zoneCoord.y+64; j += 16) {
             Chunk* c = getChunkAt(i, j).get();
-            c->creatingVBOData();
-            m_threadMutexes[m_threadIdx].lock();
-            m_threadQueues[m_threadIdx].push(pair<uint, Chunk*>(VBO, c));
-            m_threadMutexes[m_threadIdx].unlock();
-            m_threadIdx = (m_threadIdx + 1) % m_maxThreads;
+            // Chunks still waiting on BlockType data are meshed once
+            // they have it, by checkThreadResults(). Those restoreZoneAt()
+            // brought back with their meshes need none.
+            if (!c->mcr_hasBlockData || c->mcr_hasVBOData || c->mcr_creatingVBOData) {
+                continue;
+            }
+            queueMeshJob(c);
         }
     }
 }
@@ -206,38 +333,252 @@ Chunk* Terrain::instantiateChunkAt(int x, int z) {
     return cPtr;
 }
 
+void Terrain::addToRenderSet(Chunk *chunk) {
+    glm::ivec2 origin(chunk->getChunkPos());
+    int64_t key = toKey(origin.x, origin.y);
+    if (m_renderSetIndex.find(key) != m_renderSetIndex.end()) {
+        return;
+    }
+    m_renderSetIndex[key] = m_renderSet.size();
+    m_renderSet.push_back(RenderEntry{chunk, origin});
+}
+
+void Terrain::removeFromRenderSet(Chunk *chunk) {
+    glm::ivec2 origin(chunk->getChunkPos());
+    auto found = m_renderSetIndex.find(toKey(origin.x, origin.y));
+    if (found == m_renderSetIndex.end()) {
+        return;
+    }
+    // Move the last entry into the hole
+    int index = found->second;
+    m_renderSetIndex.erase(found);
+    if (index != int(m_renderSet.size()) - 1) {
+        m_renderSet[index] = m_renderSet.back();
+        m_renderSetIndex[toKey(m_renderSet[index].origin.x, m_renderSet[index].origin.y)] = index;
+    }
+    m_renderSet.pop_back();
+}
+
 // TODO: When you make Chunk inherit from Drawable, change this code so
 // it draws each Chunk with the given ShaderProgram, remembering to set the
 // model matrix to the proper X and Z translation!
 
-void Terrain::draw(int minX, int maxX, int minZ, int maxZ, SurfaceShader *shaderProgram) {
-    glm::mat4 modelMatrix = glm::mat4(1.f);
+DrawStats Terrain::draw(int minX, int maxX, int minZ, int maxZ, SurfaceShader *shaderProgram,
+                        const Frustum &frustum, const OcclusionBuffer *occlusion,
+                        const VisibleSections *sections, SurfaceShader *depthProgram,
+                        GpuTimer *shadedSamples) {
+    DrawStats stats;
+    m_transparentChunks.clear();
+
+    // Cull, queueing each survivor's opaque mesh nearest first and
+    // keeping it for drawTransparent()
+    std::vector<glm::ivec2> ranges;
+    for (const RenderEntry &entry : m_renderSet) {
+        int x = entry.origin.x, z = entry.origin.y;
+        if (x < minX || x >= maxX || z < minZ || z >= maxZ) {
+            continue;
+        }
+        const Chunk *chunk = entry.chunk;
+        glm::ivec2 yBounds = chunk->getVerticalBounds();
+        int firstSection = yBounds.x / 16, lastSection = yBounds.y / 16;
+        if (!frustum.intersectsAABB(glm::vec3(x, yBounds.x, z), glm::vec3(x + 16, yBounds.y + 1, z + 16))) {
+            stats.culled += lastSection - firstSection + 1;
+            continue;
+        }
+        uint16_t reachable = 0xffff;
+        if (sections != nullptr) {
+            auto found = sections->find(toKey(x, z));
+            reachable = found == sections->end() ? 0 : found->second;
+        }
 
-    // draw opaque VBOs first
-    for(int x = minX; x < maxX; x += 16) {
-        for(int z = minZ; z < maxZ; z += 16) {
-            const uPtr<Chunk> &chunk = getChunkAt(x, z);
-            if (chunk == nullptr || chunk->mcr_hasVBOData == false) {
+        // Neighbouring sections' index ranges are adjacent, so each
+        // run of visible sections is a single draw
+        ranges.clear();
+        bool anyDrawn = false;
+        for (int s = firstSection; s <= lastSection; s++) {
+            if (!(reachable >> s & 1)) {
+                stats.unreachable++;
+                continue;
+            }
+            glm::vec3 boxMin(x, std::max(16 * s, yBounds.x), z);
+            glm::vec3 boxMax(x + 16, std::min(16 * s + 16, yBounds.y + 1), z + 16);
+            if (!frustum.intersectsAABB(boxMin, boxMax)) {
+                stats.culled++;
+                continue;
+            }
+            if (occlusion != nullptr && !occlusion->isVisible(boxMin, boxMax)) {
+                stats.occluded++;
+                continue;
+            }
+            stats.drawn++;
+            anyDrawn = true;
+            glm::ivec2 range = chunk->getSectionRanges()[s];
+            if (range.y == 0) {
                 continue;
             }
-             modelMatrix[3] = glm::vec4(x, 0, z, 1);
-            shaderProgram->setModelMatrix(modelMatrix);
-            shaderProgram->drawInterleaved(*chunk);
+            if (!ranges.empty() && ranges.back().x + ranges.back().y == range.x) {
+                ranges.back().y += range.y;
+            } else {
+                ranges.push_back(range);
+            }
+        }
+        if (!anyDrawn) {
+            continue;
+        }
+        glm::vec3 origin(x, 0, z);
+        float distance = frustum.nearDistance(glm::vec3(x, yBounds.x, z), glm::vec3(x + 16, yBounds.y + 1, z + 16));
+        if (depthProgram != nullptr) {
+            m_renderQueue.push(RenderQueue::DEPTH_PASS, depthProgram, chunk->getOpaqueMesh(), origin, ranges, distance);
+        }
+        m_renderQueue.push(RenderQueue::OPAQUE_PASS, shaderProgram, chunk->getOpaqueMesh(), origin, ranges, distance);
+        if (!chunk->getTransparentMesh().isEmpty()) {
+            m_transparentChunks.push_back(chunk);
+        }
+    }
+
+    stats.drawCalls = m_renderQueue.submit(m_meshArena, mp_context, shadedSamples);
+    return stats;
+}
+
+int Terrain::drawTransparent(SurfaceShader *shaderProgram) {
+    for (const Chunk *chunk : m_transparentChunks) {
+        glm::vec2 chunkPos = chunk->getChunkPos();
+        m_renderQueue.push(RenderQueue::TRANSPARENT_PASS, shaderProgram, chunk->getTransparentMesh(),
+                           glm::vec3(chunkPos.x, 0, chunkPos.y));
+    }
+    return m_renderQueue.submit(m_meshArena, mp_context);
+}
+
+bool Terrain::hasTransparentInView(int minX, int maxX, int minZ, int maxZ, const Frustum &frustum) const {
+    for (const RenderEntry &entry : m_renderSet) {
+        int x = entry.origin.x, z = entry.origin.y;
+        if (x < minX || x >= maxX || z < minZ || z >= maxZ || entry.chunk->getTransparentMesh().isEmpty()) {
+            continue;
+        }
+        glm::ivec2 yBounds = entry.chunk->getVerticalBounds();
+        if (frustum.intersectsAABB(glm::vec3(x, yBounds.x, z), glm::vec3(x + 16, yBounds.y + 1, z + 16))) {
+            return true;
         }
     }
+    return false;
+}
+
+void Terrain::findVisibleSections(int minX, int maxX, int minZ, int maxZ, glm::vec3 eye,
+                                  const Frustum &frustum, VisibleSections &visible) const {
+    visible.clear();
+
+    struct Step {
+        ivec3 section;          // The Chunk's lower-left x and z, and the section's index
+        int entered;            // The Direction of the face we came in through, or -1
+        unsigned int moved;     // One bit per Direction moved in so far
+    };
+    const ivec3 offsets[6] = {ivec3(16, 0, 0), ivec3(-16, 0, 0), ivec3(0, 1, 0),
+                              ivec3(0, -1, 0), ivec3(0, 0, 16), ivec3(0, 0, -16)};
+
+    // A camera above or below the world looks in through the top or bottom
+    int entered = eye.y >= 256 ? YPOS : (eye.y < 0 ? YNEG : -1);
+    ivec3 start(16 * static_cast<int>(glm::floor(glm::clamp(eye.x, float(minX), maxX - 1.f) / 16.f)),
+                glm::clamp(static_cast<int>(glm::floor(eye.y / 16.f)), 0, Chunk::SECTION_COUNT - 1),
+                16 * static_cast<int>(glm::floor(glm::clamp(eye.z, float(minZ), maxZ - 1.f) / 16.f)));
+    visible[toKey(start.x, start.z)] |= 1 << start.y;
+
+    std::queue<Step> frontier;
+    frontier.push(Step{start, entered, 0});
+    while (!frontier.empty()) {
+        Step step = frontier.front();
+        frontier.pop();
+
+        SectionConnectivity connectivity = SectionConnectivity::all();
+        if (hasChunkAt(step.section.x, step.section.z)) {
+            const uPtr<Chunk> &chunk = getChunkAt(step.section.x, step.section.z);
+            if (chunk != nullptr && chunk->mcr_hasVBOData) {
+                connectivity = chunk->getSectionConnectivity()[step.section.y];
+            }
+        }
 
-    // draw transparent VBOs on top
+        for (int d = 0; d < 6; d++) {
+            // Opposite Directions differ only in their lowest bit
+            int opposite = d ^ 1;
+            if (step.moved >> opposite & 1) {
+                continue;
+            }
+            if (step.entered >= 0 && !connectivity.isConnected(Direction(step.entered), Direction(d))) {
+                continue;
+            }
+            ivec3 next = step.section + offsets[d];
+            if (next.y < 0 || next.y >= Chunk::SECTION_COUNT ||
+                next.x < minX || next.x >= maxX || next.z < minZ || next.z >= maxZ) {
+                continue;
+            }
+            uint16_t &bits = visible[toKey(next.x, next.z)];
+            if (bits >> next.y & 1) {
+                continue;
+            }
+            if (!frustum.intersectsAABB(vec3(next.x, 16 * next.y, next.z),
+                                        vec3(next.x + 16, 16 * next.y + 16, next.z + 16))) {
+                continue;
+            }
+            bits |= 1 << next.y;
+            frontier.push(Step{next, opposite, step.moved | 1u << d});
+        }
+    }
+}
+
+void Terrain::gatherOccluders(int minX, int maxX, int minZ, int maxZ, const Frustum &frustum,
+                              glm::vec3 eye, float range, std::vector<OccluderBox> &occluders) const {
+    const int cells = 16 / Chunk::OCCLUDER_CELL;
+    for (const RenderEntry &entry : m_renderSet) {
+        int x = entry.origin.x, z = entry.origin.y;
+        if (x < minX || x >= maxX || z < minZ || z >= maxZ) {
+            continue;
+        }
+        const Chunk *chunk = entry.chunk;
+        // Distance from the eye to the Chunk's footprint
+        glm::vec2 nearest = glm::clamp(glm::vec2(eye.x, eye.z), glm::vec2(x, z), glm::vec2(x + 16, z + 16));
+        if (glm::distance(nearest, glm::vec2(eye.x, eye.z)) > range) {
+            continue;
+        }
+        const std::array<glm::ivec2, 4> &spans = chunk->getOccluderSpans();
+        for (int c = 0; c < cells * cells; c++) {
+            if (spans[c].x == spans[c].y) {
+                continue;
+            }
+            glm::vec3 boxMin(x + Chunk::OCCLUDER_CELL * (c % cells), spans[c].x,
+                             z + Chunk::OCCLUDER_CELL * (c / cells));
+            glm::vec3 boxMax = boxMin + glm::vec3(Chunk::OCCLUDER_CELL, 0, Chunk::OCCLUDER_CELL);
+            boxMax.y = spans[c].y;
+            if (frustum.intersectsAABB(boxMin, boxMax)) {
+                occluders.push_back(OccluderBox(boxMin, boxMax));
+            }
+        }
+    }
+}
+
+uint64_t Terrain::getMeshVersion() const {
+    return m_meshVersion;
+}
+
+bool Terrain::hasMeshChangesSince(uint64_t version, int minX, int maxX, int minZ, int maxZ,
+                                  const Frustum &frustum) const {
     for(int x = minX; x < maxX; x += 16) {
         for(int z = minZ; z < maxZ; z += 16) {
+            if (!hasChunkAt(x, z)) {
+                continue;
+            }
             const uPtr<Chunk> &chunk = getChunkAt(x, z);
-            if (chunk == nullptr || chunk->mcr_hasVBOData == false) {
+            if (chunk == nullptr || chunk->getMeshVersion() <= version) {
                 continue;
             }
-             modelMatrix[3] = glm::vec4(x, 0, z, 1);
-             shaderProgram->setModelMatrix(modelMatrix);
-            shaderProgram->drawInterleaved(*(*chunk).transparent);
+            // Bounds from the last meshing, which also cover a Chunk
+            // whose VBOs have just been destroyed
+            glm::ivec2 yBounds = chunk->getVerticalBounds();
+            if (frustum.intersectsAABB(glm::vec3(x, yBounds.x, z),
+                                       glm::vec3(x + 16, yBounds.y + 1, z + 16))) {
+                return true;
+            }
         }
     }
+    return false;
 }
 
 //--------------------------------------------------------------------------------
@@ -245,35 +586,85 @@ void Terrain::draw(int minX, int maxX, int minZ, int maxZ, SurfaceShader *shader
 //--------------------------------------------------------------------------------
 //
 // PRIMARY
+/* Floors the blended height, caps it and snaps it to 1% steps. */
+static int terraceHeight(float height) {
+    int maxHeight = floor(height);
+
+    // Cap the maximum height
+    if (maxHeight > 254) {
+        maxHeight = 254;
+    }
+
+    // Create steps
+    float norMaxHeight = maxHeight / 254.f;
+    norMaxHeight = round(norMaxHeight * 100) / 100;
+    return norMaxHeight * 254;
+}
+
+/* Returns 0 if every sample is at or below the lower smoothstep edge,
+   1 if every sample is at or above the upper edge, and -1 otherwise. */
+template<size_t N>
+static int saturatedSide(const array<array<vec2, N>, N> &climate, int component) {
+    bool allLow = true, allHigh = true;
+    for (const auto &row : climate) {
+        for (const vec2 &c : row) {
+            allLow = allLow && c[component] <= 0.45f;
+            allHigh = allHigh && c[component] >= 0.55f;
+        }
+    }
+    return allLow ? 0 : (allHigh ? 1 : -1);
+}
+
 void Terrain::generateChunkTerrain(int xIn, int zIn) {
     /* xFloor and zFloor represent the lower-left corner of the Chunk */
     int xFloor = static_cast<int>(glm::floor(xIn / 16.f)) * 16;
     int zFloor = static_cast<int>(glm::floor(zIn / 16.f)) * 16;
 
-    /* SETTING BLOCK-TYPES */
-    for (int x = xFloor; x < xFloor + 16; x++) {
-        for (int z = zFloor; z < zFloor + 16; z++) {
-            float temp = interpolateTemperature(x, z);
-            float humidity = interpolateHumidity(x, z);
-            float mountHt = procMountainHt(x, z);
-            float grassHt = procGrasslandHt(x, z);
-            float desertHt = procDesertHt(x, z);
-            float islandHt = procIslandHt(x, z);
+    /* Trees, cacti and mushrooms may reach into neighbouring Chunks, so
+       they are collected here and only committed once the terrain is set. */
+    StructureBatch structures;
 
-            float lowTempMix = mix(mountHt, grassHt, humidity);
-            float highTempMix = mix(desertHt, islandHt, humidity);
+    /* Temperature and humidity vary over hundreds of blocks, so the raw
+       climate noise is only sampled every CLIMATE_STEP blocks (including
+       the far edge of the Chunk) and bilinearly interpolated in between. */
+    ClimateGrid climate = sampleClimate(xFloor, zFloor);
 
-            int maxHeight = floor(mix(lowTempMix, highTempMix, temp));
+    Chunk *chunk;
+    {
+        read_only_lock lock(m_sharedChunksLock);
+        chunk = getChunkAt(xFloor, zFloor).get();
+    }
 
-            // Cap the maximum height
-            if (maxHeight > 254) {
-                maxHeight = 254;
-            }
+    /* The interpolated climate never leaves the range of the samples, so if
+       every sample is saturated the same way, the whole Chunk is one biome. */
+    Biome biome;
+    if (uniformBiome(climate, biome)) {
+        switch (biome) {
+        case Biome::ICE:
+            generateUniformChunk<Biome::ICE>(chunk, structures);
+            break;
+        case Biome::DESERT:
+            generateUniformChunk<Biome::DESERT>(chunk, structures);
+            break;
+        case Biome::MOUNTAIN:
+            generateUniformChunk<Biome::MOUNTAIN>(chunk, structures);
+            break;
+        case Biome::LAKE:
+            generateUniformChunk<Biome::LAKE>(chunk, structures);
+            break;
+        }
+        commitStructures(chunk, structures);
+        return;
+    }
 
-            // Create steps
-            float norMaxHeight = maxHeight / 254.f;
-            norMaxHeight = round(norMaxHeight * 100) / 100;
-            maxHeight = norMaxHeight * 254;
+    /* SETTING BLOCK-TYPES */
+    for (int x = xFloor; x < xFloor + 16; x++) {
+        for (int z = zFloor; z < zFloor + 16; z++) {
+            vec2 weights = gridClimate(climate, x - xFloor, z - zFloor);
+            float temp = weights.x;
+            float humidity = weights.y;
+
+            int maxHeight = blendedHeight(x, z, temp, humidity);
 
             // Set water or ice blocks
             for (int y = 128; y <= 138; y++) {
@@ -290,13 +681,13 @@ void Terrain::generateChunkTerrain(int xIn, int zIn) {
 
             // Render Biomes
             if (temp < 0.5 && humidity >= 0.5) {
-                renderIceBiome(x, z, maxHeight, xFloor, zFloor);
+                renderIceBiome(x, z, maxHeight, structures);
             } else if (temp >= 0.5 && humidity < 0.5) {
-                renderDesertBiome(x, z, maxHeight);
+                renderDesertBiome(x, z, maxHeight, structures);
             } else if (temp < 0.5 && humidity < 0.5) {
                 renderMountainBiome(x, z, maxHeight);
             } else {
-                renderLakeBiome(x, z, maxHeight, xFloor, zFloor);
+                renderLakeBiome(x, z, maxHeight, structures);
             }
 
             m_sharedChunksLock.lock_shared();
@@ -307,6 +698,106 @@ void Terrain::generateChunkTerrain(int xIn, int zIn) {
             renderCaves(x,z);
         }
     }
+
+    commitStructures(chunk, structures);
+}
+
+Terrain::ClimateGrid Terrain::sampleClimate(int xFloor, int zFloor) const {
+    ClimateGrid climate;
+    const int samples = climate.size();
+    for (int i = 0; i < samples; i++) {
+        for (int j = 0; j < samples; j++) {
+            int x = xFloor + i * CLIMATE_STEP;
+            int z = zFloor + j * CLIMATE_STEP;
+            climate[i][j] = vec2(temperatureNoise(x, z), humidityNoise(x, z));
+        }
+    }
+    return climate;
+}
+
+vec2 Terrain::gridClimate(const ClimateGrid &climate, int dx, int dz) {
+    int i = dx / CLIMATE_STEP;
+    int j = dz / CLIMATE_STEP;
+    float u = (dx % CLIMATE_STEP) / float(CLIMATE_STEP);
+    float v = (dz % CLIMATE_STEP) / float(CLIMATE_STEP);
+    vec2 noise = mix(mix(climate[i][j], climate[i + 1][j], u),
+                     mix(climate[i][j + 1], climate[i + 1][j + 1], u), v);
+    return vec2(smoothstep(0.45f, 0.55f, noise.x), smoothstep(0.45f, 0.55f, noise.y));
+}
+
+template<size_t N>
+bool Terrain::uniformBiome(const array<array<vec2, N>, N> &climate, Biome &biome) const {
+    int temp = saturatedSide(climate, 0);
+    int humidity = saturatedSide(climate, 1);
+    if (temp < 0 || humidity < 0) {
+        return false;
+    }
+    if (temp == 0) {
+        biome = humidity == 1 ? Biome::ICE : Biome::MOUNTAIN;
+    } else {
+        biome = humidity == 0 ? Biome::DESERT : Biome::LAKE;
+    }
+    return true;
+}
+
+template<Biome B>
+void Terrain::generateUniformChunk(Chunk *chunk, StructureBatch &structures) {
+    vec2 chunkPos = chunk->getChunkPos();
+    int xFloor = chunkPos.x;
+    int zFloor = chunkPos.y;
+
+    // Every weight is exactly 0 or 1 here, so the blend is a single biome height
+    // and the water surface is the same for the whole Chunk.
+    constexpr bool cold = B == Biome::ICE || B == Biome::MOUNTAIN;
+    constexpr BlockType surface = B == Biome::DESERT ? DESERT : (B == Biome::LAKE ? GRASS : SNOW);
+    constexpr BlockType subsurface = B == Biome::DESERT ? DESERT : (B == Biome::MOUNTAIN ? STONE : DIRT);
+
+    for (int lx = 0; lx < 16; lx++) {
+        for (int lz = 0; lz < 16; lz++) {
+            int x = xFloor + lx;
+            int z = zFloor + lz;
+
+            int height;
+            if constexpr (B == Biome::ICE) {
+                height = procGrasslandHt(x, z);
+            } else if constexpr (B == Biome::DESERT) {
+                height = procDesertHt(x, z);
+            } else if constexpr (B == Biome::MOUNTAIN) {
+                height = procMountainHt(x, z);
+            } else {
+                height = procIslandHt(x, z);
+            }
+            int maxHeight = terraceHeight(height);
+
+            chunk->fillBlockColumn(lx, 128, lz, 11, WATER);
+            if constexpr (cold) {
+                chunk->setBlockAt(lx, 138, lz, ICE);
+            }
+            if (maxHeight >= 128) {
+                chunk->fillBlockColumn(lx, 128, lz, maxHeight - 128, subsurface);
+                chunk->setBlockAt(lx, maxHeight, lz, surface);
+            }
+
+            if constexpr (B == Biome::ICE) {
+                if (maxHeight > 138 && maxHeight < 160 && random1(vec2(x, z)) < 0.02) {
+                    drawSnowTree(x, maxHeight, z, structures);
+                }
+            } else if constexpr (B == Biome::DESERT) {
+                if (maxHeight > 138 && maxHeight < 230 && random1(vec2(x, z)) < 0.00125) {
+                    drawCactus(x, maxHeight + 1, z, structures);
+                }
+            } else if constexpr (B == Biome::LAKE) {
+                if (maxHeight >= 128 && maxHeight < 138 && random1(vec2(x, z)) < 0.01) {
+                    drawMushroom(x, maxHeight, z, structures);
+                }
+            }
+
+            chunk->setBlockAt(lx, 0, lz, BEDROCK); //all y=0 should have unbreakable bedrock terrain
+
+            //cave system
+            renderCaves(x, z);
+        }
+    }
 }
 
 void Terrain::renderCaves(int x, int z) {
@@ -327,16 +818,14 @@ void Terrain::renderCaves(int x, int z) {
     }
 }
 
-void Terrain::renderIceBiome(int x, int z, int maxHeight, int xFloor, int zFloor) {
+void Terrain::renderIceBiome(int x, int z, int maxHeight, StructureBatch &structures) {
     read_only_lock lock(m_sharedChunksLock);
     for (int y = 128; y <= maxHeight; y++) {
         if (y == maxHeight) {
             setBlockAt(x, y, z, SNOW);
             if (random1(vec2(x, z)) < 0.02
-                && maxHeight  > 138 && maxHeight < 160
-                && x - 3 > xFloor && x + 3 < xFloor + 16
-                && z - 3 > zFloor && z + 3 < zFloor + 16) {
-                drawSnowTree(x, y, z);
+                && maxHeight  > 138 && maxHeight < 160) {
+                drawSnowTree(x, y, z, structures);
             }
         } else {
             setBlockAt(x, y, z, DIRT);
@@ -355,26 +844,24 @@ void Terrain::renderMountainBiome(int x, int z, int maxHeight) {
     }
 }
 
-void Terrain::renderDesertBiome(int x, int z, int maxHeight) {
+void Terrain::renderDesertBiome(int x, int z, int maxHeight, StructureBatch &structures) {
     read_only_lock lock(m_sharedChunksLock);
     for (int y = 128; y <= maxHeight; y++) {
-        if (random1(vec2(x, z)) < 0.00125
-            && maxHeight  > 138 && maxHeight < 230) {
-            drawCactus(x, y, z);
-        }
         setBlockAt(x, y, z, DESERT);
     }
+    if (random1(vec2(x, z)) < 0.00125
+        && maxHeight  > 138 && maxHeight < 230) {
+        drawCactus(x, maxHeight + 1, z, structures);
+    }
 }
 
-void Terrain::renderLakeBiome(int x, int z, int maxHeight, int xFloor, int zFloor) {
+void Terrain::renderLakeBiome(int x, int z, int maxHeight, StructureBatch &structures) {
     read_only_lock lock(m_sharedChunksLock);
     for (int y = 128; y <= maxHeight; y++) {
         if (y == maxHeight) {
             if (random1(vec2(x, z)) < 0.01
-                && maxHeight  < 138
-                && x - 6 > xFloor && x + 6 < xFloor + 16
-                && z - 6 > zFloor && z + 6 < zFloor + 16) {
-                drawMushroom(x, y, z);
+                && maxHeight  < 138) {
+                drawMushroom(x, y, z, structures);
             }
             setBlockAt(x, y, z, GRASS);
         } else {
@@ -449,93 +936,177 @@ int Terrain::procIslandHt(int x, int z) const {
     return remap(height, 0.0, 0.30, min, max);
 }
 
-float Terrain::interpolateHumidity(int x, int z) const {
+float Terrain::mixBiomeHeights(int x, int z, float t,
+                               int (Terrain::*procA)(int, int) const,
+                               int (Terrain::*procB)(int, int) const) const {
+    if (t <= 0.f) {
+        return (this->*procA)(x, z);
+    }
+    if (t >= 1.f) {
+        return (this->*procB)(x, z);
+    }
+    return mix(float((this->*procA)(x, z)), float((this->*procB)(x, z)), t);
+}
+
+int Terrain::blendedHeight(int x, int z, float temp, float humidity) const {
+    /* Away from biome borders the weights saturate to exactly 0 or 1,
+       so only evaluate the biome heights that actually contribute. */
+    float lowTempMix = 0.f;
+    float highTempMix = 0.f;
+    if (temp < 1.f) {
+        lowTempMix = mixBiomeHeights(x, z, humidity,
+                                     &Terrain::procMountainHt, &Terrain::procGrasslandHt);
+    }
+    if (temp > 0.f) {
+        highTempMix = mixBiomeHeights(x, z, humidity,
+                                      &Terrain::procDesertHt, &Terrain::procIslandHt);
+    }
+    return terraceHeight(mix(lowTempMix, highTempMix, temp));
+}
+
+int Terrain::surfaceHeightAt(int x, int z, vec2 &climate) const {
+    climate = vec2(interpolateTemperature(x, z), interpolateHumidity(x, z));
+    return blendedHeight(x, z, climate.x, climate.y);
+}
+
+float Terrain::humidityNoise(int x, int z) const {
     float grid_size = 500;
 
     vec2 p = vec2(x, z);
     p = (p + random2(p)) / grid_size;
 
     PerlinNoise pn;
-    float noise = pn.noise(p[0], p[1], 0);
-    return smoothstep(0.45f, 0.55f, noise);
+    return pn.noise(p[0], p[1], 0);
 }
 
-float Terrain::interpolateTemperature(int x, int z) const {
+float Terrain::temperatureNoise(int x, int z) const {
     float grid_size = 500;
 
     vec2 p = vec2(x, z) + 1746.5f;
     p = (p + random2(p)) / grid_size;
 
     PerlinNoise pn;
-    float noise = pn.noise(p[0], p[1], 0);
-    return smoothstep(0.45f, 0.55f, noise);
+    return pn.noise(p[0], p[1], 0);
 }
 
-void Terrain::drawSnowTree(int x, int y, int z) {
-    read_only_lock lock(m_sharedChunksLock);
-    for (int i = 0; i < 10; i++) {
-        int lg_radius = 3;
-        int sm_radius = 2;
-        int shrink = 6;     // higher = slower shrink the radius of foliage
-        int start = remap(random1(vec2(x, y)), 0.f, 1.f, 1, 7);
-        if (i > start && i % 2 == 0) {
-            for (int j = -1 * (lg_radius - i/shrink); j <= lg_radius - i/shrink; j++) {
-                 for (int k = -1 * (lg_radius - i/shrink); k <= lg_radius - i/shrink; k++) {
-                     setBlockAt(x + j, y + i, z + k, LEAF);
-                 }
-            }
-        }
-        else if (i > start && i % 2 == 1) {
-            for (int j = -1 * (sm_radius - i/shrink); j <= sm_radius - i/shrink; j++) {
-                 for (int k = -1 * (sm_radius - i/shrink); k <= sm_radius - i/shrink; k++) {
-                     setBlockAt(x + j, y + i, z + k, LEAF);
-                 }
-            }
-        }
+float Terrain::interpolateHumidity(int x, int z) const {
+    return smoothstep(0.45f, 0.55f, humidityNoise(x, z));
+}
 
-        if (i < 9) {
-            setBlockAt(x, y + i, z, WOOD);
-        }
-    }
+float Terrain::interpolateTemperature(int x, int z) const {
+    return smoothstep(0.45f, 0.55f, temperatureNoise(x, z));
 }
 
-void Terrain::drawCactus(int x, int y, int z) {
-    read_only_lock lock(m_sharedChunksLock);
+void Terrain::drawSnowTree(int x, int y, int z, StructureBatch &structures) const {
+    int start = remap(random1(vec2(x, y)), 0.f, 1.f, 1, 7);
+    placeStamp(snowTreeStamp(start), ivec3(x, y, z), structures);
+}
+
+void Terrain::drawCactus(int x, int y, int z, StructureBatch &structures) const {
     int cactus_height = remap(random1(vec2(x, y)), 0.f, 1.f, 3, 8);
-    for (int i = 0; i < cactus_height; i++) {
-        setBlockAt(x, y + i, z, CACTUS);
-    }
+    placeStamp(cactusStamp(cactus_height), ivec3(x, y, z), structures);
 }
 
-void Terrain::drawMushroom(int x, int y, int z) {
-    read_only_lock lock(m_sharedChunksLock);
+void Terrain::drawMushroom(int x, int y, int z, StructureBatch &structures) const {
     int mushroom_radius = remap(random1(vec2(x, y)), 0.f, 1.f, 3, 6);
-    int cap_height = mushroom_radius * 2.5;
     int mushroom_height = remap(random1(vec2(x, y)), 0.f, 1.f, 15, 35);
-    // Draw the Cap
-    for (int i = 0; i < cap_height - 2; i++) {
-        for (int j = -1 * mushroom_radius; j <= mushroom_radius; j++) {
-             for (int k = -1 * mushroom_radius; k <= mushroom_radius; k++) {
-                 if (abs(j) == mushroom_radius && abs(k) == mushroom_radius) {
-                     setBlockAt(x + j, y + i, z + k, EMPTY);
-                 } else {
-                     setBlockAt(x + j, y + i + mushroom_height - cap_height, z + k, MUSHROOM_CAP);
-                 }
-             }
+    placeStamp(mushroomStamp(mushroom_radius, mushroom_height), ivec3(x, y, z), structures);
+}
+
+void Terrain::placeStamp(const VoxelStamp &stamp, ivec3 anchor, StructureBatch &structures) const {
+    ivec3 lo = anchor + stamp.minCorner();
+    ivec3 hi = anchor + stamp.maxCorner();
+    int xMin = static_cast<int>(glm::floor(lo.x / 16.f)) * 16;
+    int zMin = static_cast<int>(glm::floor(lo.z / 16.f)) * 16;
+    for (int cx = xMin; cx <= hi.x; cx += 16) {
+        for (int cz = zMin; cz <= hi.z; cz += 16) {
+            structures[toKey(cx, cz)].push_back(StructurePlacement(&stamp, anchor));
         }
     }
-    for (int i = cap_height - 2; i < cap_height; i++) {
-        for (int j = -1 * mushroom_radius + 1; j <= mushroom_radius - 1; j++) {
-            for (int k = -1 * mushroom_radius + 1; k <= mushroom_radius - 1; k++) {
-                setBlockAt(x + j, y + i + mushroom_height - cap_height, z + k, MUSHROOM_CAP);
+}
+
+void Terrain::commitStructures(Chunk *chunk, StructureBatch &structures) {
+    vec2 chunkPos = chunk->getChunkPos();
+    ivec3 origin(chunkPos.x, 0, chunkPos.y);
+    auto own = structures.find(toKey(chunkPos.x, chunkPos.y));
+    if (own != structures.end()) {
+        for (const StructurePlacement &p : own->second) {
+            p.stamp->apply(chunk, p.anchor - origin);
+        }
+        structures.erase(own);
+    }
+    m_structureQueue.push(structures);
+}
+
+void Terrain::applyQueuedStructures(const std::vector<Chunk*> &generated) {
+    std::vector<int64_t> keys = m_structureQueue.takePushedKeys();
+    for (Chunk *c : generated) {
+        keys.push_back(toKey(c->getChunkPos().x, c->getChunkPos().y));
+    }
+    std::vector<Chunk*> stale;
+    for (int64_t key : keys) {
+        /* VBO workers read these blocks, and those of the neighbours,
+           under a read_only_lock. */
+        updatable_lock lock(m_sharedChunksLock);
+        auto it = m_chunks.find(key);
+        if (it == m_chunks.end() || it->second == nullptr || !it->second->mcr_hasBlockData) {
+            continue;
+        }
+        std::vector<StructurePlacement> placements = m_structureQueue.take(key);
+        if (placements.empty()) {
+            continue;
+        }
+        Chunk *c = it->second.get();
+        vec2 chunkPos = c->getChunkPos();
+        ivec3 origin(chunkPos.x, 0, chunkPos.y);
+        ivec3 lo(16), hi(-1);
+        for (const StructurePlacement &p : placements) {
+            p.stamp->apply(c, p.anchor - origin);
+            lo = min(lo, p.anchor - origin + p.stamp->minCorner());
+            hi = max(hi, p.anchor - origin + p.stamp->maxCorner());
+        }
+        stale.push_back(c);
+        /* A block on the border changes which faces the neighbour shows. */
+        std::array<std::pair<bool, ivec2>, 4> borders = {{
+            {lo.x <= 0, ivec2(-16, 0)}, {hi.x >= 15, ivec2(16, 0)},
+            {lo.z <= 0, ivec2(0, -16)}, {hi.z >= 15, ivec2(0, 16)},
+        }};
+        for (const auto &border : borders) {
+            auto neighbor = m_chunks.find(toKey(chunkPos.x + border.second.x, chunkPos.y + border.second.y));
+            if (border.first && neighbor != m_chunks.end() && neighbor->second != nullptr) {
+                stale.push_back(neighbor->second.get());
             }
         }
     }
+    std::sort(stale.begin(), stale.end());
+    stale.erase(std::unique(stale.begin(), stale.end()), stale.end());
+    for (Chunk *c : stale) {
+        remeshChunk(c);
+    }
+}
 
-    // Draw the stem
-    for (int i = 0; i <= mushroom_height - 2; i++) {
-        setBlockAt(x, y + i, z, MUSHROOM_STEM);
+void Terrain::dropDistantStructures(ivec2 currZone) {
+    m_structureQueue.dropIf([currZone](int64_t key) {
+        ivec2 coords = toCoords(key);
+        return coords.x < currZone.x - 192 || coords.x >= currZone.x + 256 ||
+               coords.y < currZone.y - 192 || coords.y >= currZone.y + 256;
+    });
+}
+
+void Terrain::remeshChunk(Chunk *c) {
+    if (!c->mcr_hasVBOData && !c->mcr_creatingVBOData) {
+        return;
     }
+    queueMeshJob(c);
+}
+
+void Terrain::queueMeshJob(Chunk *c) {
+    c->creatingVBOData();
+    c->meshJobQueued();
+    m_threadMutexes[m_threadIdx].lock();
+    m_threadQueues[m_threadIdx].push(pair<uint, Chunk*>(VBO, c));
+    m_threadMutexes[m_threadIdx].unlock();
+    m_threadIdx = (m_threadIdx + 1) % m_maxThreads;
 }
 
 //--------------------------------------------------------------------------------
@@ -557,21 +1128,24 @@ void Terrain::tryExpansion(vec3 posCurr, vec3 posPrev) {
     ivec2 prevZone(glm::floor(posPrev.x / 64.f) * 64, glm::floor(posPrev.z / 64.f) * 64);
 
     /* Figure out which Terrain Zones have fallen out of the
-       renderable range, remove chunks from m_chunksWithVBOData. */
+       renderable range, and evict their chunks. */
     for (int i = -128; i < 192; i+= 64) {
         for (int j = -128; j < 192; j+= 64) {
             if (prevZone.x + i < currZone.x - 128
              || prevZone.x + i > currZone.x + 192
              || prevZone.y + j < currZone.y - 128
              || prevZone.y + j > currZone.y + 192) {
-                if (hasZoneAt(prevZone.x + i, prevZone.y + j) &&
-                    getChunkAt(prevZone.x + i, prevZone.y + j)->mcr_hasVBOData) {
-                    destroyZoneAt(prevZone.x + i, prevZone.y + j);
+                if (hasZoneAt(prevZone.x + i, prevZone.y + j)) {
+                    evictZoneAt(prevZone.x + i, prevZone.y + j);
                 }
             }
         }
     }
 
+    if (currZone != prevZone) {
+        dropDistantStructures(currZone);
+    }
+
     /* Figure out which Terrain Zones need to be populated with BlockTypes
      * or sent to VBO workers. */
     for (int i = -128; i < 192; i += 64) {
@@ -581,8 +1155,11 @@ void Terrain::tryExpansion(vec3 posCurr, vec3 posPrev) {
                 int zoneCoordX = (64 * floor((currZone[0] + i) / 64.f));
                 int zoneCoordZ = (64 * floor((currZone[1] + j) / 64.f));
                 instantiateZoneAt(zoneCoordX, zoneCoordZ);
-            /* Terrain zone exists but has no VBO data. */
-            } else if (!getChunkAt(currZone.x + i, currZone.y + j)->mcr_creatingVBOData) {
+            /* Terrain zone exists. Any chunks it kept their meshes
+               through an eviction are drawn again as they were; the
+               rest are sent to VBO workers. */
+            } else {
+                restoreZoneAt(currZone.x + i, currZone.y + j);
                 createZoneBuffers(currZone.x + i, currZone.y + j);
             }
         }
@@ -595,10 +1172,31 @@ void Terrain::checkThreadResults() {
        send information along to VBOWorker. */
     m_chunksThatHaveBlockDataLock.lock();
     for (Chunk* c : m_chunksThatHaveBlockData) {
-        m_threadMutexes[m_threadIdx].lock();
-        m_threadQueues[m_threadIdx].push(pair(VBO, c));
-        m_threadMutexes[m_threadIdx].unlock();
-        m_threadIdx = (m_threadIdx + 1) % m_maxThreads;
+        c->hasBlockData();
+    }
+    /* Now that these Chunks have terrain of their own, lay down any
+       structures their neighbours emitted into them before meshing. */
+    applyQueuedStructures(m_chunksThatHaveBlockData);
+    /* A neighbour meshed before these had blocks took them for empty,
+       and shows its faces along their border. Those neighbours in this
+       batch have no mesh yet, so remeshChunk() passes them over. */
+    std::vector<Chunk*> stale;
+    for (Chunk* c : m_chunksThatHaveBlockData) {
+        vec2 chunkPos = c->getChunkPos();
+        for (ivec2 offset : {ivec2(-16, 0), ivec2(16, 0), ivec2(0, -16), ivec2(0, 16)}) {
+            auto neighbor = m_chunks.find(toKey(chunkPos.x + offset.x, chunkPos.y + offset.y));
+            if (neighbor != m_chunks.end() && neighbor->second != nullptr) {
+                stale.push_back(neighbor->second.get());
+            }
+        }
+    }
+    std::sort(stale.begin(), stale.end());
+    stale.erase(std::unique(stale.begin(), stale.end()), stale.end());
+    for (Chunk *c : stale) {
+        remeshChunk(c);
+    }
+    for (Chunk* c : m_chunksThatHaveBlockData) {
+        queueMeshJob(c);
     }
     m_chunksThatHaveBlockData.clear();
     m_chunksThatHaveBlockDataLock.unlock();
@@ -607,10 +1205,29 @@ void Terrain::checkThreadResults() {
        If so, send the data to the GPU and clear the vector. */
     m_chunksThatHaveVBOsLock.lock();
     for (ChunkVBOData &cd : m_chunksThatHaveVBOs) {
-       cd.mp_chunk->createDouble(cd.m_vboDataOpaque, cd.m_idxDataOpaque, cd.m_vboDataTransparent, cd.m_idxDataTransparent);
+       cd.mp_chunk->meshJobDone();
+       // Free the old meshes first, so a re-meshed Chunk can reuse their space
+       auto meshes = cd.mp_chunk->takeMeshes();
+       m_meshArena.release(meshes.first);
+       m_meshArena.release(meshes.second);
+       cd.mp_chunk->setMeshes(m_meshArena.upload(cd.m_vboDataOpaque, cd.m_idxDataOpaque),
+                              m_meshArena.upload(cd.m_vboDataTransparent, cd.m_idxDataTransparent));
+       cd.mp_chunk->setVerticalBounds(cd.m_minY, cd.m_maxY);
+       cd.mp_chunk->setOccluderSpans(cd.m_occluderSpans);
+       cd.mp_chunk->setSections(cd.m_sectionRanges, cd.m_sectionConnectivity);
+       cd.mp_chunk->setMeshVersion(++m_meshVersion);
+       glm::ivec2 origin(cd.mp_chunk->getChunkPos());
+       int64_t key = toKey(origin.x, origin.y);
+       m_residency.setBytes(key, MeshArena::getByteSize(cd.mp_chunk->getOpaqueMesh()) +
+                                 MeshArena::getByteSize(cd.mp_chunk->getTransparentMesh()));
+       // A Chunk that left range while being meshed isn't drawn
+       if (!m_residency.isEvicted(key)) {
+           addToRenderSet(cd.mp_chunk);
+       }
     }
     m_chunksThatHaveVBOs.clear();
     m_chunksThatHaveVBOsLock.unlock();
+    enforceMeshBudget();
 }
 
 void Terrain::checkForWork(uint thread_idx) {
@@ -642,67 +1259,120 @@ void Terrain::checkForWork(uint thread_idx) {
             m_chunksThatHaveBlockData.push_back(ptr);
             m_chunksThatHaveBlockDataLock.unlock();
         } else if (type == VBO) {
-            ChunkVBOData data(ptr);
-            std::vector<glm::vec4> interleavedData;
-            std::vector<GLuint> idx;
-            uint id = 0;
-
-            std::vector<glm::vec4> interleavedDataTransparent;
-            std::vector<GLuint> idxTransparent;
-            uint idTransparent = 0;
-
-            for(int i = 0; i < 16; ++i) {
-                for(int j = 0; j < 256; ++j) {
-                    read_only_lock lock(m_sharedChunksLock);
-                    for(int k = 0; k < 16; ++k) {
-                        BlockType t = getBlockAt(ptr->getChunkPos()[0] + i, j, ptr->getChunkPos()[1] + k);
-                        if(isBlockOpaque(t)) { // if the current block is not opaque, then check its 6 neighbours to decide if any of its face needs to be drawn
-                            for(const auto &adjacentFace : adjacentBlockFaces) {
-                                BlockType neighbouringBlock = ptr->getAdjacentBlockAt(adjacentFace.direction, i, j, k);
-                                if(!isBlockOpaque(neighbouringBlock)) { //if a neighbouring block is empty, then draw that side of the face
-                                    for(int b = 0; b <= 3; ++b) {
-                                        interleavedData.push_back(adjacentFace.bufferData[b].pos + glm::vec4(i, j, k, 0));// + glm::vec4(ptr->getChunkPos().x, 0, ptr->getChunkPos().y, 0)); //position
-                                        interleavedData.push_back(glm::vec4(adjacentFace.dirVec, 1)); //normal
-                                        interleavedData.push_back(glm::vec4(getUV(t, adjacentFace.direction) + uvOffset(b), 1)); //color
-                                    }
-                                    idx.push_back(id);idx.push_back(id + 1);idx.push_back(id + 2);
-                                    idx.push_back(id);idx.push_back(id + 2);idx.push_back(id + 3);
-                                    id+= 4;
-                                }
+            ChunkVBOData data = createChunkVBOData(ptr);
+            m_chunksThatHaveVBOsLock.lock();
+            m_chunksThatHaveVBOs.push_back(data);
+            m_chunksThatHaveVBOsLock.unlock();
+        }
+    }
+}
+
+/* The [start, end) of the longest run of set bits in a 256-bit mask. */
+static ivec2 longestRun(const array<uint64_t, 4> &mask) {
+    ivec2 best(0, 0);
+    int start = 0;
+    for (int y = 0; y <= 256; y++) {
+        bool set = y < 256 && (mask[y / 64] >> (y % 64)) & 1;
+        if (!set) {
+            if (y - start > best.y - best.x) {
+                best = ivec2(start, y);
+            }
+            start = y + 1;
+        }
+    }
+    return best;
+}
+
+ChunkVBOData Terrain::createChunkVBOData(Chunk *ptr) {
+    ChunkVBOData data(ptr);
+    std::vector<glm::vec4> interleavedData;
+    // Indices are gathered per section, so each section's faces end up
+    // in one contiguous range of the final index buffer
+    array<std::vector<GLuint>, Chunk::SECTION_COUNT> sectionIdx;
+    array<std::bitset<4096>, Chunk::SECTION_COUNT> sectionOpaque;
+    uint id = 0;
+
+    std::vector<glm::vec4> interleavedDataTransparent;
+    std::vector<GLuint> idxTransparent;
+    uint idTransparent = 0;
+
+    int minY = 255, maxY = 0;
+
+    // Per occluder cell, one bit per y that stays set while every
+    // block at that height in the cell is opaque
+    const int cells = 16 / Chunk::OCCLUDER_CELL;
+    array<array<uint64_t, 4>, 4> opaqueCells;
+    for (auto &mask : opaqueCells) {
+        mask.fill(~0ull);
+    }
+
+    for(int i = 0; i < 16; ++i) {
+        for(int j = 0; j < 256; ++j) {
+            read_only_lock lock(m_sharedChunksLock);
+            for(int k = 0; k < 16; ++k) {
+                BlockType t = getBlockAt(ptr->getChunkPos()[0] + i, j, ptr->getChunkPos()[1] + k);
+                if (t != EMPTY) {
+                    minY = std::min(minY, j);
+                    maxY = std::max(maxY, j);
+                }
+                if(isBlockOpaque(t)) { // if the current block is opaque, then check its 6 neighbours to decide if any of its face needs to be drawn
+                    sectionOpaque[j / 16][i + 16 * (j % 16) + 256 * k] = true;
+                    for(const auto &adjacentFace : adjacentBlockFaces) {
+                        BlockType neighbouringBlock = ptr->getAdjacentBlockAt(adjacentFace.direction, i, j, k);
+                        if(!isBlockOpaque(neighbouringBlock)) { //if a neighbouring block is empty, then draw that side of the face
+                            for(int b = 0; b <= 3; ++b) {
+                                interleavedData.push_back(adjacentFace.bufferData[b].pos + glm::vec4(i, j, k, 0));// + glm::vec4(ptr->getChunkPos().x, 0, ptr->getChunkPos().y, 0)); //position
+                                interleavedData.push_back(glm::vec4(adjacentFace.dirVec, 1)); //normal
+                                interleavedData.push_back(blockFaceTexCoord(t, adjacentFace.direction, b)); //texture coordinates
                             }
-                        } else if (t != EMPTY) {
-                            for(const auto &adjacentFace : adjacentBlockFaces) {
-                                BlockType neighbouringBlock = ptr->getAdjacentBlockAt(adjacentFace.direction, i, j, k);
-                                if(neighbouringBlock == EMPTY) { //if a neighbouring block is empty, then draw that side of the face
-                                    for(int b = 0; b <= 3; ++b) {
-                                        interleavedDataTransparent.push_back(adjacentFace.bufferData[b].pos + glm::vec4(i, j, k, 0));// + glm::vec4(ptr->getChunkPos().x, 0, ptr->getChunkPos().y, 0)); //position
-                                        interleavedDataTransparent.push_back(glm::vec4(adjacentFace.dirVec, 1)); //normal
-                                        interleavedDataTransparent.push_back(glm::vec4(getUV(t, adjacentFace.direction) + uvOffset(b), 1)); //color
-                                    }
-                                    idxTransparent.push_back(idTransparent);
-                                    idxTransparent.push_back(idTransparent + 1);
-                                    idxTransparent.push_back(idTransparent + 2);
-                                    idxTransparent.push_back(idTransparent);
-                                    idxTransparent.push_back(idTransparent + 2);
-                                    idxTransparent.push_back(idTransparent + 3);
-                                    idTransparent+= 4;
+                            std::vector<GLuint> &idx = sectionIdx[j / 16];
+                            idx.push_back(id);idx.push_back(id + 1);idx.push_back(id + 2);
+                            idx.push_back(id);idx.push_back(id + 2);idx.push_back(id + 3);
+                            id+= 4;
+                        }
+                    }
+                } else {
+                    int cell = i / Chunk::OCCLUDER_CELL + cells * (k / Chunk::OCCLUDER_CELL);
+                    opaqueCells[cell][j / 64] &= ~(1ull << (j % 64));
+                    if (t != EMPTY) {
+                        for(const auto &adjacentFace : adjacentBlockFaces) {
+                            BlockType neighbouringBlock = ptr->getAdjacentBlockAt(adjacentFace.direction, i, j, k);
+                            if(neighbouringBlock == EMPTY) { //if a neighbouring block is empty, then draw that side of the face
+                                for(int b = 0; b <= 3; ++b) {
+                                    interleavedDataTransparent.push_back(adjacentFace.bufferData[b].pos + glm::vec4(i, j, k, 0));// + glm::vec4(ptr->getChunkPos().x, 0, ptr->getChunkPos().y, 0)); //position
+                                    interleavedDataTransparent.push_back(glm::vec4(adjacentFace.dirVec, 1)); //normal
+                                    interleavedDataTransparent.push_back(blockFaceTexCoord(t, adjacentFace.direction, b)); //texture coordinates
                                 }
+                                idxTransparent.push_back(idTransparent);
+                                idxTransparent.push_back(idTransparent + 1);
+                                idxTransparent.push_back(idTransparent + 2);
+                                idxTransparent.push_back(idTransparent);
+                                idxTransparent.push_back(idTransparent + 2);
+                                idxTransparent.push_back(idTransparent + 3);
+                                idTransparent+= 4;
                             }
                         }
                     }
                 }
             }
-            ptr->transparent->interleavedDataTransparent = interleavedDataTransparent;
-            ptr->transparent->idxTransparent = idxTransparent;
-
-            data.m_vboDataOpaque = interleavedData;
-            data.m_idxDataOpaque = idx;
-            data.m_vboDataTransparent = interleavedDataTransparent;
-            data.m_idxDataTransparent = idxTransparent;
-
-            m_chunksThatHaveVBOsLock.lock();
-            m_chunksThatHaveVBOs.push_back(data);
-            m_chunksThatHaveVBOsLock.unlock();
         }
     }
+    std::vector<GLuint> idx;
+    for (int s = 0; s < Chunk::SECTION_COUNT; s++) {
+        data.m_sectionRanges[s] = ivec2(idx.size(), sectionIdx[s].size());
+        idx.insert(idx.end(), sectionIdx[s].begin(), sectionIdx[s].end());
+        data.m_sectionConnectivity[s] = SectionConnectivity::compute(sectionOpaque[s]);
+    }
+
+    data.m_vboDataOpaque = interleavedData;
+    data.m_idxDataOpaque = idx;
+    data.m_vboDataTransparent = interleavedDataTransparent;
+    data.m_idxDataTransparent = idxTransparent;
+    data.m_minY = minY;
+    data.m_maxY = maxY;
+    for (int c = 0; c < cells * cells; c++) {
+        data.m_occluderSpans[c] = longestRun(opaqueCells[c]);
+    }
+
+    return data;
 }
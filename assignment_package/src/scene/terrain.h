@@ -26,6 +26,13 @@
 #include "cube.h"
 #include "surfaceshader.h"
 #include "perlinnoise.h"
+#include "structurequeue.h"
+#include "structurestamps.h"
+#include "frustum.h"
+#include "occlusionbuffer.h"
+#include "mesharena.h"
+#include "meshresidency.h"
+#include "renderqueue.h"
 
 
 
@@ -40,6 +47,32 @@ using updatable_lock = std::unique_lock<mutex_type>;
 int64_t toKey(int x, int z);
 glm::ivec2 toCoords(int64_t k);
 
+// The four biomes chosen between by temperature and humidity.
+enum class Biome : unsigned char
+{
+    ICE,        // cold, humid
+    DESERT,     // hot, dry
+    MOUNTAIN,   // cold, dry
+    LAKE        // hot, humid
+};
+
+// How many non-empty Chunk sections a single call to Terrain::draw()
+// submitted, culled against the frustum, found hidden behind occluders,
+// or skipped as unreachable from the camera, and how many draw calls
+// it took to submit them.
+struct DrawStats {
+    int drawn;
+    int culled;
+    int occluded;
+    int unreachable;
+    int drawCalls;
+    DrawStats() : drawn(0), culled(0), occluded(0), unreachable(0), drawCalls(0) {}
+};
+
+// For each Chunk, keyed by toKey() of its lower-left corner, one bit
+// per section, bottom to top, that may be visible from the camera.
+using VisibleSections = std::unordered_map<int64_t, uint16_t>;
+
 // The container class for all of the Chunks in the game.
 // Ultimately, while Terrain will always store all Chunks,
 // not all Chunks will be drawn at any given time as the world
@@ -83,6 +116,10 @@ private:
     vector<ChunkVBOData> m_chunksThatHaveVBOs;
     mutex m_chunksThatHaveVBOsLock;
 
+    /* Structure placements that a Chunk's generator emitted for one of
+       its neighbours. Applied on the main thread in checkThreadResults(). */
+    StructureQueue m_structureQueue;
+
     queue<vec2> m_zonesToInstantiate;
     mutex m_zonesToInstantiateLock;
 
@@ -104,14 +141,81 @@ private:
     /* The maximum number of threads the machine can handle concurrently. */
     uint m_maxThreads;
 
+    /* Bumped on the main thread every time a Chunk's VBOs are uploaded
+       or destroyed. Lets renderers that cache an image of the Terrain,
+       such as the shadow map, tell whether it is out of date. */
+    uint64_t m_meshVersion;
+
+    /* Holds every Chunk's opaque and transparent meshes. Main thread only. */
+    MeshArena m_meshArena;
+    /* Size of each of m_meshArena's pages: about 45 Chunks' worth. */
+    static constexpr unsigned int MESH_PAGE_VERTICES = 1 << 20;
+    static constexpr unsigned int MESH_PAGE_INDICES = 1 << 21;
+    /* Reused by every draw() to sort and issue its draw calls. */
+    RenderQueue m_renderQueue;
+    /* The Chunks the last draw() kept, for drawTransparent(). */
+    std::vector<const Chunk*> m_transparentChunks;
+
+    /* Every Chunk that has meshes, with its lower-left corner alongside
+       so draw() can skip those out of bounds without touching them.
+       Updated wherever a Chunk's meshes are set or taken, rather than
+       found by looking up every coordinate each frame. Main thread only. */
+    struct RenderEntry {
+        Chunk *chunk;
+        glm::ivec2 origin;
+    };
+    std::vector<RenderEntry> m_renderSet;
+    /* Each Chunk's index in m_renderSet, by key. */
+    std::unordered_map<int64_t, int> m_renderSetIndex;
+    /* Adds the Chunk to m_renderSet if it isn't there yet. */
+    void addToRenderSet(Chunk *chunk);
+    /* Swaps the Chunk out of m_renderSet, if it is there. */
+    void removeFromRenderSet(Chunk *chunk);
+
+    /* The bytes of every Chunk's meshes, and which Chunks that have left
+       range may keep theirs. Main thread only. */
+    MeshResidency m_residency;
+    /* Frees the meshes of evicted Chunks until m_residency is within its
+       budget. The space goes back to m_meshArena for the next upload. */
+    void enforceMeshBudget();
+
+    /* Spacing, in blocks, of the climate samples taken per Chunk in
+       generateChunkTerrain(). Must divide 16. */
+    static constexpr int CLIMATE_STEP = 4;
+
 public:
-    Terrain(OpenGLContext *context);
+    /* The raw (temperature, humidity) noise of one Chunk, sampled every
+       CLIMATE_STEP blocks, far edge included. */
+    using ClimateGrid = array<array<vec2, 16 / CLIMATE_STEP + 1>, 16 / CLIMATE_STEP + 1>;
+    /* About twice what the 20 x 20 Chunks in range take up on average. */
+    static constexpr std::size_t DEFAULT_MESH_BUDGET = std::size_t(512) << 20;
+
+    /* If spawnWorkers is false, no BlockType/VBO worker threads are
+       started and the caller must drive generation itself. */
+    Terrain(OpenGLContext *context, bool spawnWorkers = true);
     ~Terrain();
 
     // Instantiates a new Chunk and stores it in
     // our chunk map at the given coordinates.
     // Returns a pointer to the created Chunk.
     Chunk* instantiateChunkAt(int x, int z);
+    // Unlinks and deletes the Chunk with its lower-left corner at
+    // (x, z), along with any structures still queued for it.
+    void releaseChunkAt(int x, int z);
+    // Deletes every Chunk's meshes, and the GPU buffers holding them.
+    void destroyMeshes();
+    // How many bytes of meshes may stay resident for Chunks that have
+    // left range, counting those in range too. DEFAULT_MESH_BUDGET
+    // unless set. This counts the meshes, not the arena pages holding
+    // them: a page is only deleted once empty, so the free space left
+    // in partly used pages comes on top.
+    void setMeshBudget(std::size_t bytes);
+    const MeshResidency& getMeshResidency() const;
+    // The GPU memory every mesh arena page takes up, free space included.
+    std::size_t getMeshPageBytes() const;
+    // Drops every queued structure placement, e.g. those aimed at
+    // Chunks that will never be instantiated.
+    void discardQueuedStructures();
     // Do these world-space coordinates lie within
     // a Chunk that exists?
     bool hasChunkAt(int x, int z) const;
@@ -119,7 +223,8 @@ public:
     // an existing Terrain Zone?
     bool hasZoneAt(int x, int z) const;
     // Assuming a Chunk exists at these coords,
-    // return a mutable reference to it
+    // return a mutable reference to it. Throws std::out_of_range
+    // if there is none; never adds an entry to m_chunks.
     uPtr<Chunk>& getChunkAt(int x, int z);
     // Assuming a Chunk exists at these coords,
     // return a const reference to it
@@ -132,27 +237,74 @@ public:
     // values) set the block at that point in space to the
     // given type.
     void setBlockAt(int x, int y, int z, BlockType t);
+    // Main thread only. Like setBlockAt(), but for an edit to a Chunk
+    // that may already be meshed: takes the write lock, and re-meshes
+    // the Chunk, and any neighbour sharing the block's face.
+    void editBlockAt(int x, int y, int z, BlockType t);
     /* Instances a 4x4 chunk terrain zone and spawns BlockType workers. */
     void instantiateZoneAt(int x, int z);
-    /* A helper function that destroys the VBO of all the chunks
-       in the specifieid terrain zone. */
-    void destroyZoneAt(int x, int z);
+    /* Stops drawing the chunks in the specified terrain zone, which
+       has left range. Their meshes stay resident while the mesh
+       budget allows, in case the player comes back. */
+    void evictZoneAt(int x, int z);
+    /* Draws the chunks of an evicted terrain zone that still have
+       their meshes again. */
+    void restoreZoneAt(int x, int z);
     /* For a 4x4 Chunk terrain zone, spawn VBO workers to setup
-       VBO and index buffers. */
+       VBO and index buffers for every Chunk with BlockType data
+       that has none and isn't waiting on any. */
     void createZoneBuffers(int x, int z);
 
     //A functjion to add caves to terrain. Making a separate function mostly so its easier to comment
     //it out and prevent caves from rendering while testing to spead up the process.
     void renderCaves(int x, int z);
-    void renderIceBiome(int x, int z, int maxHeight, int xFloor, int zFloor);
-    void renderDesertBiome(int x, int z, int maxHeight);
+    void renderIceBiome(int x, int z, int maxHeight, StructureBatch &structures);
+    void renderDesertBiome(int x, int z, int maxHeight, StructureBatch &structures);
     void renderMountainBiome(int x, int z, int maxHeight);
-    void renderLakeBiome(int x, int z, int maxHeight, int xFloor, int zFloor);
+    void renderLakeBiome(int x, int z, int maxHeight, StructureBatch &structures);
 
-    // Draws every Chunk that falls within the bounding box
-    // described by the min and max coords, using the provided
-    // ShaderProgram
-    void draw(int minX, int maxX, int minZ, int maxZ, SurfaceShader *shaderProgram);
+    // Draws every Chunk section that falls within the bounding box
+    // described by the min and max coords and intersects the
+    // frustum, using the provided ShaderProgram. If an OcclusionBuffer
+    // is given, sections it finds hidden are skipped too, as are
+    // sections missing from the given VisibleSections. Only the opaque
+    // meshes are drawn, nearest first; given a depthProgram, their depth
+    // is laid down with it before any of them is shaded. shadedSamples,
+    // if given, counts the samples drawn after that. The Chunks drawn
+    // are remembered for drawTransparent().
+    DrawStats draw(int minX, int maxX, int minZ, int maxZ, SurfaceShader *shaderProgram,
+                   const Frustum &frustum, const OcclusionBuffer *occlusion = nullptr,
+                   const VisibleSections *sections = nullptr, SurfaceShader *depthProgram = nullptr,
+                   GpuTimer *shadedSamples = nullptr);
+    // Draws the transparent meshes of the Chunks the last draw() drew,
+    // using the provided ShaderProgram, in no particular order. Returns
+    // the number of draw calls issued. Must come in the same frame as
+    // that draw().
+    int drawTransparent(SurfaceShader *shaderProgram);
+    // Does any meshed Chunk within the bounding box and the frustum have
+    // a transparent mesh? Occlusion is not considered, so a true may
+    // still leave drawTransparent() with nothing to draw, but a false
+    // means it certainly will.
+    bool hasTransparentInView(int minX, int maxX, int minZ, int maxZ, const Frustum &frustum) const;
+    // Flood fills outward from the section holding eye, only passing
+    // through a section between faces its SectionConnectivity joins and
+    // never stepping back toward eye, and marks every section reached
+    // within the bounding box and the frustum. Chunks that are not
+    // meshed yet are treated as empty.
+    void findVisibleSections(int minX, int maxX, int minZ, int maxZ, glm::vec3 eye,
+                             const Frustum &frustum, VisibleSections &visible) const;
+    // Appends an OccluderBox for each non-empty occluder span of every
+    // meshed Chunk within the bounding box that is within range blocks
+    // of eye and intersects the frustum.
+    void gatherOccluders(int minX, int maxX, int minZ, int maxZ, const Frustum &frustum,
+                         glm::vec3 eye, float range, std::vector<OccluderBox> &occluders) const;
+    // The current value of m_meshVersion.
+    uint64_t getMeshVersion() const;
+    // Has any Chunk within the bounding box and the frustum been
+    // (re)meshed or had its VBOs destroyed since getMeshVersion()
+    // returned the given version?
+    bool hasMeshChangesSince(uint64_t version, int minX, int maxX, int minZ, int maxZ,
+                             const Frustum &frustum) const;
 
 //--------------------------------------------------------------------------------
 // Procedural Terrain Generation
@@ -160,6 +312,20 @@ public:
     /* Given these coordinates, populate the corresponding chunk
        with the appropriate BlockTypes. */
     void generateChunkTerrain(int xIn, int zIn);
+    /* The climate grid of the Chunk with this lower-left corner. */
+    ClimateGrid sampleClimate(int xFloor, int zFloor) const;
+    /* The smoothstepped (temperature, humidity) weights of the column at
+       Chunk-local (dx, dz), bilinearly interpolated from the grid. */
+    static vec2 gridClimate(const ClimateGrid &climate, int dx, int dz);
+    /* If every climate sample of a Chunk falls in the same biome, writes it
+       to `biome` and returns true. */
+    template<size_t N>
+    bool uniformBiome(const array<array<vec2, N>, N> &climate, Biome &biome) const;
+    /* Fast path of generateChunkTerrain() for a Chunk that lies entirely in
+       biome B. Writes whole columns straight into the Chunk, with the biome's
+       height function and decorations picked at compile time. */
+    template<Biome B>
+    void generateUniformChunk(Chunk *chunk, StructureBatch &structures);
     /* Given these coords, return the height of the particular biome. */
     int procGrasslandHt(int x, int z) const;
     int procDesertHt(int x, int z) const;
@@ -169,10 +335,52 @@ public:
        temperature and humidity. */
     float interpolateHumidity(int x, int z) const;
     float interpolateTemperature(int x, int z) const;
-    // Functions to draw a asset()
-    void drawSnowTree(int x, int y, int z);
-    void drawCactus(int x, int y, int z);
-    void drawMushroom(int x, int y, int z);
+    /* The raw climate noise behind the two functions above, before smoothstep. */
+    float humidityNoise(int x, int z) const;
+    float temperatureNoise(int x, int z) const;
+    /* Mixes two biome heights by t, only evaluating the heights with a
+       non-zero weight. Equal to mix(procA(x, z), procB(x, z), t). */
+    float mixBiomeHeights(int x, int z, float t,
+                          int (Terrain::*procA)(int, int) const,
+                          int (Terrain::*procB)(int, int) const) const;
+    /* The terraced surface height generateChunkTerrain() gives a column
+       with these temperature and humidity weights. */
+    int blendedHeight(int x, int z, float temp, float humidity) const;
+    /* The surface height generateChunkTerrain() would give this column,
+       along with its (temperature, humidity) weights, straight from the
+       generation noise rather than the per-Chunk climate samples. Needs
+       no Chunk and no lock, so any thread may call it. Leaves out caves
+       and structures. */
+    int surfaceHeightAt(int x, int z, vec2 &climate) const;
+    // Functions to draw a asset(). These pick a precompiled variant from
+    // structurestamps.h and place it into the given batch, so an asset
+    // may straddle a Chunk border.
+    void drawSnowTree(int x, int y, int z, StructureBatch &structures) const;
+    void drawCactus(int x, int y, int z, StructureBatch &structures) const;
+    void drawMushroom(int x, int y, int z, StructureBatch &structures) const;
+    /* Records the stamp, anchored at these world-space coords, under every
+       Chunk it overlaps. */
+    void placeStamp(const VoxelStamp &stamp, ivec3 anchor, StructureBatch &structures) const;
+    /* Stamps the placements belonging to this Chunk straight into it, and
+       hands every other bucket to m_structureQueue. */
+    void commitStructures(Chunk *chunk, StructureBatch &structures);
+    /* Main thread only. Stamps the queued placements of the Chunks that
+       were just given BlockType data, and of any Chunk with BlockType
+       data that placements were pushed for since the last call. Each
+       stamped Chunk that was already meshed (or being meshed) is
+       re-meshed, as are its neighbours across any border it touched. */
+    void applyQueuedStructures(const std::vector<Chunk*> &generated);
+    /* Drops the queued placements aimed more than a zone beyond the
+       renderable range around this zone. A structure crossing into a
+       zone generated long after the player left the area is cut off
+       at the border. */
+    void dropDistantStructures(ivec2 currZone);
+    /* Main thread only. Sends the Chunk back to the VBO workers if it
+       has a mesh (or is getting one) that predates a change to its
+       blocks. */
+    void remeshChunk(Chunk *c);
+    /* Main thread only. Sends the Chunk to the next VBO worker. */
+    void queueMeshJob(Chunk *c);
 
 //--------------------------------------------------------------------------------
 // Multi-threading
@@ -189,4 +397,8 @@ public:
     /* Every worker thread will be passed this function. Checks for
        work in the thread's queue and handles it. */
     void checkForWork(uint i);
+    /* Builds the interleaved opaque and transparent buffers of a Chunk
+       that has BlockType data. Does not touch the GPU, so any thread may
+       call it. */
+    ChunkVBOData createChunkVBOData(Chunk *ptr);
 };
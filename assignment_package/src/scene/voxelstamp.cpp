@@ -0,0 +1,76 @@
+#include "voxelstamp.h"
+#include <limits>
+
+VoxelStamp::VoxelStamp()
+    : m_building(), m_runs(), m_min(0), m_max(0)
+{}
+
+void VoxelStamp::setBlock(glm::ivec3 p, BlockType t, StampRule rule) {
+    m_building[std::make_tuple(p.z, p.y, p.x)] = std::make_pair(t, rule);
+}
+
+void VoxelStamp::setBox(glm::ivec3 lo, glm::ivec3 hi, BlockType t, StampRule rule) {
+    for (int z = lo.z; z <= hi.z; z++) {
+        for (int y = lo.y; y <= hi.y; y++) {
+            for (int x = lo.x; x <= hi.x; x++) {
+                setBlock(glm::ivec3(x, y, z), t, rule);
+            }
+        }
+    }
+}
+
+void VoxelStamp::compile() {
+    m_runs.clear();
+    if (m_building.empty()) {
+        return;
+    }
+    m_min = glm::ivec3(std::numeric_limits<int>::max());
+    m_max = glm::ivec3(std::numeric_limits<int>::min());
+
+    for (const auto &b : m_building) {
+        glm::ivec3 p(std::get<2>(b.first), std::get<1>(b.first), std::get<0>(b.first));
+        m_min = glm::min(m_min, p);
+        m_max = glm::max(m_max, p);
+
+        // Extend the previous run if this block continues it along X.
+        if (!m_runs.empty()) {
+            StampRun &last = m_runs.back();
+            if (last.offset.y == p.y && last.offset.z == p.z
+                && last.offset.x + last.length == p.x
+                && last.type == b.second.first && last.rule == b.second.second) {
+                last.length++;
+                continue;
+            }
+        }
+        m_runs.push_back(StampRun(p, 1, b.second.first, b.second.second));
+    }
+    m_building.clear();
+}
+
+glm::ivec3 VoxelStamp::minCorner() const {
+    return m_min;
+}
+
+glm::ivec3 VoxelStamp::maxCorner() const {
+    return m_max;
+}
+
+const std::vector<StampRun>& VoxelStamp::runs() const {
+    return m_runs;
+}
+
+void VoxelStamp::apply(Chunk *chunk, glm::ivec3 anchor) const {
+    for (const StampRun &r : m_runs) {
+        int y = anchor.y + r.offset.y;
+        int z = anchor.z + r.offset.z;
+        if (y < 0 || y >= 256 || z < 0 || z >= 16) {
+            continue;
+        }
+        int x0 = glm::max(anchor.x + r.offset.x, 0);
+        int x1 = glm::min(anchor.x + r.offset.x + r.length, 16);
+        if (x0 >= x1) {
+            continue;
+        }
+        chunk->fillBlockRow(x0, y, z, x1 - x0, r.type, r.rule == StampRule::REPLACE_ALL);
+    }
+}
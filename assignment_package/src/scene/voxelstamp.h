@@ -0,0 +1,59 @@
+#pragma once
+#include "chunk.h"
+#include "glm_includes.h"
+#include <map>
+#include <tuple>
+#include <vector>
+
+// How a stamped block treats whatever is already in the Chunk.
+enum class StampRule : unsigned char
+{
+    REPLACE_ALL,    // Always overwrite.
+    REPLACE_EMPTY   // Only fill EMPTY blocks (e.g. foliage should not carve terrain).
+};
+
+// A horizontal run of identical blocks, stored relative to the stamp's anchor.
+// Runs go along X since X is the contiguous axis of Chunk::m_blocks.
+struct StampRun {
+    glm::ivec3 offset;
+    int length;
+    BlockType type;
+    StampRule rule;
+    StampRun(glm::ivec3 offset, int length, BlockType type, StampRule rule)
+        : offset(offset), length(length), type(type), rule(rule)
+    {}
+};
+
+// A precomputed voxel structure (tree, cactus, ...). A stamp is built once
+// per variant by setting blocks relative to its anchor; compile() then
+// collapses those blocks into X-runs so that placing the stamp is a
+// handful of clipped row fills rather than one setBlockAt() per block.
+class VoxelStamp {
+private:
+    // Blocks set while building, keyed (z, y, x) so that iterating the map
+    // walks along X first. Later sets replace earlier ones.
+    std::map<std::tuple<int, int, int>, std::pair<BlockType, StampRule>> m_building;
+
+    std::vector<StampRun> m_runs;
+    // Inclusive bounds of the stamp relative to its anchor.
+    glm::ivec3 m_min, m_max;
+
+public:
+    VoxelStamp();
+
+    /* Building. Positions are relative to the anchor. */
+    void setBlock(glm::ivec3 p, BlockType t, StampRule rule = StampRule::REPLACE_ALL);
+    /* Sets every block in the inclusive box [lo, hi]. */
+    void setBox(glm::ivec3 lo, glm::ivec3 hi, BlockType t, StampRule rule = StampRule::REPLACE_ALL);
+    /* Turns the blocks set so far into runs. Must be called before apply(). */
+    void compile();
+
+    glm::ivec3 minCorner() const;
+    glm::ivec3 maxCorner() const;
+    const std::vector<StampRun>& runs() const;
+
+    /* Writes the stamp into the Chunk with its anchor at the given
+       Chunk-local coordinates. The anchor may lie outside the Chunk;
+       only the part of the stamp that overlaps the Chunk is written. */
+    void apply(Chunk *chunk, glm::ivec3 anchor) const;
+};
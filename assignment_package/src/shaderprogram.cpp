@@ -1,4 +1,6 @@
 #include "shaderprogram.h"
+#include "frameuniforms.h"
+#include "programcache.h"
 #include <QFile>
 #include <QStringBuilder>
 #include <QTextStream>
@@ -7,25 +9,52 @@
 
 
 ShaderProgram::ShaderProgram(OpenGLContext *context)
-    : vertShader(), fragShader(), prog(), unifSampler2D(-1), unifHexSampler2D(-1), unifDimensions(-1),
-      context(context)
+    : vertShader(), fragShader(), prog(), unifSampler2D(-1), unifHexSampler2D(-1),
+      m_cacheKey(), m_pending(false), m_fromCache(false), context(context)
 {}
 
 void ShaderProgram::create(const char *vertfile, const char *fragfile)
 {
-    // Allocate space on our GPU for a vertex shader and a fragment shader and a shader program to manage the two
-    vertShader = context->glCreateShader(GL_VERTEX_SHADER);
-    fragShader = context->glCreateShader(GL_FRAGMENT_SHADER);
-    prog = context->glCreateProgram();
+    submit(vertfile, fragfile);
+    finish();
+}
+
+void ShaderProgram::createFromSource(const QString &qVertSource, const QString &qFragSource, const QString &label)
+{
+    submitFromSource(qVertSource, qFragSource, label);
+    finish();
+}
+
+void ShaderProgram::submit(const char *vertfile, const char *fragfile)
+{
     // Get the body of text stored in our two .glsl files
-    QString qVertSource = qTextFileRead(vertfile);
-    QString qFragSource = qTextFileRead(fragfile);
+    submitFromSource(qTextFileRead(vertfile), qTextFileRead(fragfile), QString(vertfile) + " + " + fragfile);
+}
+
+void ShaderProgram::submitFromSource(const QString &qVertSource, const QString &qFragSource, const QString &label)
+{
+    QString vertExpanded = expandIncludes(qVertSource);
+    QString fragExpanded = expandIncludes(qFragSource);
 
-    char* vertSource = new char[qVertSource.size()+1];
-    strcpy(vertSource, qVertSource.toStdString().c_str());
-    char* fragSource = new char[qFragSource.size()+1];
-    strcpy(fragSource, qFragSource.toStdString().c_str());
+    prog = context->glCreateProgram();
+    context->labelObject(GL_PROGRAM, prog, label);
+    m_pending = true;
+
+    ProgramCache &cache = context->getProgramCache();
+    m_cacheKey = cache.key(vertExpanded, fragExpanded);
+    m_fromCache = cache.load(prog, m_cacheKey);
+    if (m_fromCache) {
+        return;
+    }
 
+    // Allocate space on our GPU for a vertex shader and a fragment shader
+    vertShader = context->glCreateShader(GL_VERTEX_SHADER);
+    fragShader = context->glCreateShader(GL_FRAGMENT_SHADER);
+
+    std::string vertText = vertExpanded.toStdString();
+    std::string fragText = fragExpanded.toStdString();
+    const char* vertSource = vertText.c_str();
+    const char* fragSource = fragText.c_str();
 
     // Send the shader text to OpenGL and store it in the shaders specified by the handles vertShader and fragShader
     context->glShaderSource(vertShader, 1, (const char**)&vertSource, 0);
@@ -33,35 +62,56 @@ void ShaderProgram::create(const char *vertfile, const char *fragfile)
     // Tell OpenGL to compile the shader text stored above
     context->glCompileShader(vertShader);
     context->glCompileShader(fragShader);
-    // Check if everything compiled OK
-    GLint compiled;
-    context->glGetShaderiv(vertShader, GL_COMPILE_STATUS, &compiled);
-    if (!compiled) {
-        printShaderInfoLog(vertShader);
-    }
-    context->glGetShaderiv(fragShader, GL_COMPILE_STATUS, &compiled);
-    if (!compiled) {
-        printShaderInfoLog(fragShader);
-    }
 
     // Tell prog that it manages these particular vertex and fragment shaders
     context->glAttachShader(prog, vertShader);
     context->glAttachShader(prog, fragShader);
+    context->glBindAttribLocation(prog, ATTRIB_POS, "vs_Pos");
+    context->glBindAttribLocation(prog, ATTRIB_NOR, "vs_Nor");
+    context->glBindAttribLocation(prog, ATTRIB_COL, "vs_Col");
+    context->glBindAttribLocation(prog, ATTRIB_CHUNK_ORIGIN, "vs_ChunkOrigin");
+    cache.prepare(prog);
+    // Querying any status here would wait for the compile, so that is left to finish()
     context->glLinkProgram(prog);
+}
 
-    // Check for linking success
-    GLint linked;
-    context->glGetProgramiv(prog, GL_LINK_STATUS, &linked);
-    if (!linked) {
-        printLinkInfoLog(prog);
+void ShaderProgram::finish()
+{
+    if (!m_pending) {
+        return;
+    }
+    m_pending = false;
+
+    if (!m_fromCache) {
+        // Check if everything compiled OK
+        GLint compiled;
+        context->glGetShaderiv(vertShader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            printShaderInfoLog(vertShader);
+        }
+        context->glGetShaderiv(fragShader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            printShaderInfoLog(fragShader);
+        }
+
+        // Check for linking success
+        GLint linked;
+        context->glGetProgramiv(prog, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            printLinkInfoLog(prog);
+        } else {
+            context->getProgramCache().save(prog, m_cacheKey);
+        }
+    }
+
+    // The per-frame state lives in a buffer shared by every program
+    GLuint frameBlock = context->glGetUniformBlockIndex(prog, "FrameUniforms");
+    if (frameBlock != GL_INVALID_INDEX) {
+        context->glUniformBlockBinding(prog, frameBlock, FrameUniforms::BINDING);
     }
 
     setupMemberVars();
 
-    unifTime       = context->glGetUniformLocation(prog, "u_Time");    
-    unifHexCenter  = context->glGetUniformLocation(prog, "u_HexCenter");
-    unifHexRadius  = context->glGetUniformLocation(prog, "u_HexRadius");
-    unifDimensions = context->glGetUniformLocation(prog, "u_Dimensions");
     unifHexSampler2D = context->glGetUniformLocation(prog, "u_Hexture");
 
 }
@@ -71,16 +121,6 @@ void ShaderProgram::useMe()
     context->glUseProgram(prog);
 }
 
-void ShaderProgram::setTime(float t)
-{
-    useMe();
-
-    if(unifTime != -1)
-    {
-        context->glUniform1f(unifTime, t);
-    }
-}
-
 void ShaderProgram::setTextureSampler2D(int textureSlot = 0) {
     useMe();
 
@@ -100,36 +140,6 @@ void ShaderProgram::setHextureSampler2D(int textureSlot) {
 }
 
 
-void ShaderProgram::setDimensions(glm::ivec2 dims)
-{
-    useMe();
-
-    if(unifDimensions != -1)
-    {
-        context->glUniform2i(unifDimensions, dims.x, dims.y);
-    }
-}
-
-void ShaderProgram::setHexCenter(const glm::vec2 &center)
-{
-    useMe();
-
-    if(unifHexCenter != -1)
-    {
-        context->glUniform2fv(unifHexCenter, 1, &center[0]);
-    }
-}
-
-void ShaderProgram::setHexRadius(float r)
-{
-    useMe();
-
-    if(unifHexRadius != -1)
-    {
-        context->glUniform1f(unifHexRadius, r);
-    }
-}
-
 char* ShaderProgram::textFileRead(const char* fileName) {
     char* text;
 
@@ -165,6 +175,30 @@ QString ShaderProgram::qTextFileRead(const char *fileName)
     return text;
 }
 
+QString ShaderProgram::expandIncludes(const QString &source)
+{
+    // GLSL has no #include of its own, so each is spliced in here
+    static const QString DIRECTIVE = "#include \"";
+    QString expanded = source;
+    int start;
+    while ((start = expanded.indexOf(DIRECTIVE)) != -1) {
+        int nameStart = start + DIRECTIVE.size();
+        int nameEnd = expanded.indexOf('"', nameStart);
+        if (nameEnd == -1) {
+            throw std::runtime_error("ShaderProgram::expandIncludes: unterminated #include");
+        }
+        QString fileName = ":/glsl/" + expanded.mid(nameStart, nameEnd - nameStart);
+        QString text = qTextFileRead(fileName.toStdString().c_str());
+        if (text.isEmpty()) {
+            throw std::runtime_error("ShaderProgram::expandIncludes: cannot read " + fileName.toStdString());
+        }
+        // Drop the null character qTextFileRead() ends the text with
+        text.chop(1);
+        expanded.replace(start, nameEnd + 1 - start, text);
+    }
+    return expanded;
+}
+
 void ShaderProgram::printShaderInfoLog(int shader)
 {
     int infoLogLen = 0;
@@ -11,21 +11,41 @@
 class ShaderProgram
 {
 public:
+    // Locations every program binds vs_Pos, vs_Nor and vs_Col to, so a
+    // single VAO can feed them all (see MeshArena)
+    static const GLuint ATTRIB_POS = 0;
+    static const GLuint ATTRIB_NOR = 1;
+    static const GLuint ATTRIB_COL = 2;
+    // Location of vs_ChunkOrigin, which is never fed from an array but
+    // set per draw with glVertexAttrib3f (see RenderQueue)
+    static const GLuint ATTRIB_CHUNK_ORIGIN = 3;
+
     GLuint vertShader; // A handle for the vertex shader stored in this shader program
     GLuint fragShader; // A handle for the fragment shader stored in this shader program
     GLuint prog;       // A handle for the linked shader program stored in this class
 
     int unifSampler2D; // A handle to the "uniform" sampler2D that will be used to read the texture containing the scene render
     int unifHexSampler2D; // A handle to the "uniform" sampler2D that will be used to read the hex b/w map
-    int unifTime; // A handle for the "uniform" float representing time in the shader
-    int unifHexCenter; //A handle for the uniform vec2 representing the hex's center as (x,z)
-    int unifHexRadius; //A hanlde for the uniform float representing the hex's radius
-    int unifDimensions; // A handle to the "uniform" ivec2 that stores the width and height of the texture being rendered
 
 public:
     ShaderProgram(OpenGLContext* context);
     // Sets up the requisite GL data and shaders from the given .glsl files
     void create(const char *vertfile, const char *fragfile);
+    // As create(), but from shader source already in memory. The label
+    // names the program in GL debug output. Each line of the form
+    // #include "file.glsl" is replaced by :/glsl/file.glsl first, and the
+    // program's FrameUniforms block, if it has one, is bound to
+    // FrameUniforms::BINDING.
+    void createFromSource(const QString &vertSource, const QString &fragSource, const QString &label);
+    // create() is submit() then finish(). submit() loads the program from
+    // the context's ProgramCache, or else starts compiling and linking it
+    // without waiting for the result, so submitting every program before
+    // finishing any lets the driver work on them all at once.
+    void submit(const char *vertfile, const char *fragfile);
+    void submitFromSource(const QString &vertSource, const QString &fragSource, const QString &label);
+    // Waits for the program submitted last, reports any errors, caches it,
+    // and sets up its handles. Does nothing if nothing is pending.
+    void finish();
     // Sets up shader-specific handles
     virtual void setupMemberVars() = 0;
     // Tells our OpenGL context to use this shader to draw things
@@ -35,14 +55,6 @@ public:
     void setTextureSampler2D(int textureSlot);
     //Pass the hex b/w map to the shader on the GPU
     void setHextureSampler2D(int textureSlot);
-    // Pass the time to the shader on the GPU
-    void setTime(float t);
-    //Pass the hex's center (x,z) to the GPU
-    void setHexCenter(const glm::vec2 &center);
-    //set screen dimensions
-    void setDimensions(glm::ivec2 dims);
-    //Pass the hex's radius to the GPU
-    void setHexRadius(float r);
     // Draw the given object to our screen using this ShaderProgram's shaders
     void draw(Drawable &d);
     //Draw the given object to our screen using one single interleaved Vertex Buffer Object
@@ -59,6 +71,13 @@ public:
     void printLinkInfoLog(int prog);
 
     QString qTextFileRead(const char*);
+    // Expands the #include lines in the given shader source
+    QString expandIncludes(const QString &source);
+
+private:
+    QByteArray m_cacheKey; // The submitted program's ProgramCache key
+    bool m_pending;        // Submitted, but not yet finished
+    bool m_fromCache;      // Loaded from the ProgramCache rather than compiled
 
 protected:
     OpenGLContext* context;   // Since Qt's OpenGL support is done through classes like QOpenGLFunctions_3_2_Core,
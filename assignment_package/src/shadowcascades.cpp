@@ -0,0 +1,104 @@
+#include "shadowcascades.h"
+#include <algorithm>
+
+// Must match lightDir in the surface shaders
+static const glm::vec3 LIGHT_DIRECTION = glm::normalize(glm::vec3(0.5, 1, 0.75));
+static const float LIGHT_DISTANCE = 100.f;
+static const float NEAR_PLANE = 1.f, FAR_PLANE = 300.f;
+
+ShadowCascades::ShadowCascades(int count)
+    : m_cascades(), m_count(1), m_resolution(2048), m_divisor(1),
+      m_lightView(glm::lookAt(LIGHT_DIRECTION * LIGHT_DISTANCE, glm::vec3(0), glm::vec3(0, 1, 0)))
+{
+    setCascadeCount(count);
+}
+
+void ShadowCascades::setCascadeCount(int count) {
+    m_count = glm::clamp(count, 1, MAX_CASCADES);
+
+    // A single cascade covers the whole 300 x 300 area at full resolution.
+    // With more, every layer is smaller, so the total texel count drops,
+    // while the near layers still get several times the texel density.
+    switch(m_count) {
+        case(1) : {
+            m_resolution = 2048;
+            m_cascades[0].halfExtent = 150.f;
+            break;
+        }
+        case(2) : {
+            m_resolution = 1024;
+            m_cascades[0].halfExtent = 48.f;
+            m_cascades[1].halfExtent = 150.f;
+            break;
+        }
+        default : {
+            m_resolution = 1024;
+            m_cascades[0].halfExtent = 24.f;
+            m_cascades[1].halfExtent = 64.f;
+            m_cascades[2].halfExtent = 150.f;
+            break;
+        }
+    }
+    m_resolution /= m_divisor;
+    invalidate();
+}
+
+void ShadowCascades::setResolutionDivisor(unsigned int divisor) {
+    m_divisor = std::max(divisor, 1u);
+    setCascadeCount(m_count);
+}
+
+int ShadowCascades::getCascadeCount() const {
+    return m_count;
+}
+
+unsigned int ShadowCascades::getResolution() const {
+    return m_resolution;
+}
+
+void ShadowCascades::update(glm::vec3 focus) {
+    // Where the focus lies relative to a box centered on the origin.
+    // Moving the box there is a plain translation in light space.
+    glm::vec3 lightSpaceFocus = glm::mat3(m_lightView) * focus;
+
+    for (int i = 0; i < m_count; i++) {
+        ShadowCascade &c = m_cascades[i];
+        float step = SNAP_TEXELS * 2.f * c.halfExtent / m_resolution;
+        c.cell = glm::ivec3(glm::round(lightSpaceFocus / step));
+        glm::mat4 view = glm::translate(glm::mat4(1.f), -glm::vec3(c.cell) * step) * m_lightView;
+        glm::mat4 proj = glm::ortho(-c.halfExtent, c.halfExtent, -c.halfExtent, c.halfExtent,
+                                    NEAR_PLANE, FAR_PLANE);
+        c.viewProj = proj * view;
+    }
+}
+
+const ShadowCascade& ShadowCascades::getCascade(int i) const {
+    return m_cascades[i];
+}
+
+std::vector<glm::mat4> ShadowCascades::getViewProjs() const {
+    std::vector<glm::mat4> viewProjs;
+    for (int i = 0; i < m_count; i++) {
+        viewProjs.push_back(m_cascades[i].viewProj);
+    }
+    return viewProjs;
+}
+
+bool ShadowCascades::isStale(int i, glm::ivec2 zone) const {
+    const ShadowCascade &c = m_cascades[i];
+    return !c.rendered || c.cell != c.renderedCell || zone != c.renderedZone;
+}
+
+void ShadowCascades::markRendered(int i, glm::ivec2 zone, uint64_t meshVersion) {
+    ShadowCascade &c = m_cascades[i];
+    c.rendered = true;
+    c.renderedCell = c.cell;
+    c.renderedZone = zone;
+    c.renderedMeshVersion = meshVersion;
+}
+
+void ShadowCascades::invalidate() {
+    for (ShadowCascade &c : m_cascades) {
+        c.rendered = false;
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "glm_includes.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// One layer of the shadow map: an orthographic box around the player,
+// seen from the (fixed) light direction.
+struct ShadowCascade {
+    float halfExtent;       // Half the side of the box, in blocks
+    glm::mat4 viewProj;     // The light's view-projection, snapped to whole texels
+    glm::ivec3 cell;        // Light-space position of the box, in snap steps
+
+    // What this cascade's layer was last rendered with
+    bool rendered;
+    glm::ivec3 renderedCell;
+    glm::ivec2 renderedZone;
+    uint64_t renderedMeshVersion;
+};
+
+// Computes the light matrices of 1 to MAX_CASCADES shadow cascades
+// and remembers what each was last rendered with, so that the shadow
+// map pass only redraws a cascade when it is actually out of date.
+//
+// Each box is moved in steps of SNAP_TEXELS whole texels in light space
+// rather than following the player exactly. This keeps texels fixed to
+// the world (no shimmering as the player moves), and means that between
+// steps the matrix, and so the cached depth image, stays the same.
+// Cascades are ordered nearest (smallest, sharpest) first.
+class ShadowCascades {
+public:
+    static const int MAX_CASCADES = 3;
+    // How far, in texels, a box moves each time it is re-snapped
+    static const int SNAP_TEXELS = 32;
+
+private:
+    std::array<ShadowCascade, MAX_CASCADES> m_cascades;
+    int m_count;
+    unsigned int m_resolution;  // Texels per side of every cascade
+    unsigned int m_divisor;     // m_resolution is the count's best resolution over this
+    glm::mat4 m_lightView;      // The light's view, looking at the world origin
+
+public:
+    ShadowCascades(int count);
+
+    // Switches between 1 and MAX_CASCADES cascades, and marks every
+    // cascade as needing to be rendered.
+    void setCascadeCount(int count);
+    int getCascadeCount() const;
+    // Divides the resolution setCascadeCount() picks, for speed at the
+    // cost of blurrier shadows, and marks every cascade as needing to be
+    // rendered.
+    void setResolutionDivisor(unsigned int divisor);
+    // The side of each cascade's layer of the shadow map, in texels
+    unsigned int getResolution() const;
+
+    // Moves every box to the snap step nearest the focus point.
+    void update(glm::vec3 focus);
+    const ShadowCascade& getCascade(int i) const;
+    // The view-projection of each active cascade, nearest first
+    std::vector<glm::mat4> getViewProjs() const;
+
+    // Has cascade i moved, or has the terrain draw area moved, since
+    // it was last rendered? Mesh changes are checked by the caller.
+    bool isStale(int i, glm::ivec2 zone) const;
+    void markRendered(int i, glm::ivec2 zone, uint64_t meshVersion);
+    void invalidate();
+};
@@ -4,22 +4,43 @@ DEPENDPATH += $$PWD
 SOURCES += \
     $$PWD/chunkvbodata.cpp \
     $$PWD/framebuffer.cpp \
+    $$PWD/frameuniforms.cpp \
+    $$PWD/gputimer.cpp \
     $$PWD/main.cpp \
     $$PWD/mainwindow.cpp \
     $$PWD/mygl.cpp \
     $$PWD/scene/hex.cpp \
     $$PWD/perlinnoise.cpp \
     $$PWD/surfaceshader.cpp \
+    $$PWD/postprocesscomposer.cpp \
     $$PWD/postprocessshader.cpp \
     $$PWD/proceduralterrainhelp.cpp \
+    $$PWD/programcache.cpp \
+    $$PWD/rendergraph.cpp \
+    $$PWD/qualitygovernor.cpp \
+    $$PWD/scene/frustum.cpp \
+    $$PWD/scene/farterrain.cpp \
+    $$PWD/scene/occlusionbuffer.cpp \
+    $$PWD/scene/occlusionworker.cpp \
+    $$PWD/scene/particlesystem.cpp \
+    $$PWD/scene/sectionconnectivity.cpp \
     $$PWD/scene/quad.cpp \
     $$PWD/scene/sceneutils.cpp \
     $$PWD/shaderprogram.cpp \
+    $$PWD/shadowcascades.cpp \
     $$PWD/drawable.cpp \
+    $$PWD/freelistallocator.cpp \
+    $$PWD/mesharena.cpp \
+    $$PWD/meshresidency.cpp \
+    $$PWD/renderqueue.cpp \
     $$PWD/cameracontrolshelp.cpp \
     $$PWD/scene/cube.cpp \
     $$PWD/openglcontext.cpp \
     $$PWD/scene/terrain.cpp \
+    $$PWD/scene/regionfile.cpp \
+    $$PWD/scene/structurequeue.cpp \
+    $$PWD/scene/structurestamps.cpp \
+    $$PWD/scene/voxelstamp.cpp \
     $$PWD/scene/worldaxes.cpp \
     $$PWD/scene/entity.cpp \
     $$PWD/scene/player.cpp \
@@ -30,20 +51,41 @@ SOURCES += \
 
 HEADERS += \
     $$PWD/framebuffer.h \
+    $$PWD/frameuniforms.h \
+    $$PWD/gputimer.h \
     $$PWD/mainwindow.h \
     $$PWD/mygl.h \
     $$PWD/perlinnoise.h \
+    $$PWD/postprocesscomposer.h \
     $$PWD/postprocessshader.h \
     $$PWD/proceduralterrainhelp.h \
+    $$PWD/programcache.h \
+    $$PWD/rendergraph.h \
+    $$PWD/qualitygovernor.h \
     $$PWD/scene/hex.h \
+    $$PWD/scene/frustum.h \
+    $$PWD/scene/farterrain.h \
+    $$PWD/scene/occlusionbuffer.h \
+    $$PWD/scene/occlusionworker.h \
+    $$PWD/scene/particlesystem.h \
+    $$PWD/scene/sectionconnectivity.h \
     $$PWD/scene/quad.h \
     $$PWD/scene/sceneutils.h \
     $$PWD/shaderprogram.h \
+    $$PWD/shadowcascades.h \
     $$PWD/drawable.h \
+    $$PWD/freelistallocator.h \
+    $$PWD/mesharena.h \
+    $$PWD/meshresidency.h \
+    $$PWD/renderqueue.h \
     $$PWD/cameracontrolshelp.h \
     $$PWD/scene/cube.h \
     $$PWD/openglcontext.h \
     $$PWD/scene/terrain.h \
+    $$PWD/scene/regionfile.h \
+    $$PWD/scene/structurequeue.h \
+    $$PWD/scene/structurestamps.h \
+    $$PWD/scene/voxelstamp.h \
     $$PWD/scene/worldaxes.h \
     $$PWD/smartpointerhelp.h \
     $$PWD/glm_includes.h \
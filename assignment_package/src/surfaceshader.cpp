@@ -3,7 +3,8 @@
 
 SurfaceShader::SurfaceShader(OpenGLContext *context)
     : ShaderProgram(context), attrPos(-1), attrNor(-1), attrCol(-1), attrPosOffset(-1), attrUV(-1),
-      unifModel(-1), unifModelInvTr(-1), unifViewProj(-1), unifColor(-1), unifDepthMVP(-1), unifDepthBiasMVP(-1), unifShadowMap(-1)
+      unifModel(-1), unifModelInvTr(-1), unifColor(-1), unifCascade(-1),
+      unifShadowMap(-1), unifNearBounds(-1), unifFarFade(-1)
 {}
 
 SurfaceShader::~SurfaceShader()
@@ -20,11 +21,12 @@ void SurfaceShader::setupMemberVars()
 
     unifModel      = context->glGetUniformLocation(prog, "u_Model");
     unifModelInvTr = context->glGetUniformLocation(prog, "u_ModelInvTr");
-    unifViewProj   = context->glGetUniformLocation(prog, "u_ViewProj");
     unifColor      = context->glGetUniformLocation(prog, "u_Color");
     unifSampler2D  = context->glGetUniformLocation(prog, "u_Texture");
-    unifDepthMVP       = context->glGetUniformLocation(prog, "u_DepthMVP");
+    unifCascade        = context->glGetUniformLocation(prog, "u_Cascade");
     unifShadowMap      = context->glGetUniformLocation(prog, "u_ShadowMap");
+    unifNearBounds     = context->glGetUniformLocation(prog, "u_NearBounds");
+    unifFarFade        = context->glGetUniformLocation(prog, "u_FarFade");
 
     context->printGLErrorLog();
 }
@@ -103,25 +105,6 @@ void SurfaceShader::setModelMatrix(const glm::mat4 &model)
     }
 }
 
-void SurfaceShader::setViewProjMatrix(const glm::mat4 &vp)
-{
-    // Tell OpenGL to use this shader program for subsequent function calls
-    useMe();
-
-    if(unifViewProj != -1) {
-    // Pass a 4x4 matrix into a uniform variable in our shader
-                    // Handle to the matrix variable on the GPU
-    context->glUniformMatrix4fv(unifViewProj,
-                    // How many matrices to pass
-                       1,
-                    // Transpose the matrix? OpenGL uses column-major, so no.
-                       GL_FALSE,
-                    // Pointer to the first element of the matrix
-                       &vp[0][0]);
-    }
-}
-
-
 //This function, as its name implies, uses the passed in GL widget
 void SurfaceShader::draw(Drawable &d)
 {
@@ -251,8 +234,16 @@ void SurfaceShader::drawInstanced(InstancedDrawable &d)
 
     if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
     if (attrNor != -1) context->glDisableVertexAttribArray(attrNor);
-    if (attrCol != -1) context->glDisableVertexAttribArray(attrCol);
-    if (attrPosOffset != -1) context->glDisableVertexAttribArray(attrPosOffset);
+    // The VAO is shared, so the other shaders' draws must not be left
+    // stepping these attributes per instance
+    if (attrCol != -1) {
+        context->glVertexAttribDivisor(attrCol, 0);
+        context->glDisableVertexAttribArray(attrCol);
+    }
+    if (attrPosOffset != -1) {
+        context->glVertexAttribDivisor(attrPosOffset, 0);
+        context->glDisableVertexAttribArray(attrPosOffset);
+    }
 
 }
 
@@ -266,46 +257,40 @@ void SurfaceShader::setGeometryColor(glm::vec4 color)
     }
 }
 
-void SurfaceShader::setCameraWorldPosition(const glm::vec3 &v)
+void SurfaceShader::setShadowCascade(int cascade)
 {
-    // Tell OpenGL to use this shader program for subsequent function calls
     useMe();
 
-    if(unifCamera != -1) {
-    // Pass a vec3 into a uniform variable in our shader
-                    // Handle to the vec3 variable on the GPU
-    context->glUniform3fv(unifCamera,
-                    // How many vectors to pass
-                       1,
-                    // Pointer to the first element of the vector
-                       &v[0]);
+    if(unifCascade != -1)
+    {
+        context->glUniform1i(unifCascade, cascade);
     }
 }
 
-void SurfaceShader::setDepthMVP(const glm::mat4 &mvp)
+void SurfaceShader::setShadowMapDepthTexture(int textureSlot)
 {
-    // Tell OpenGL to use this shader program for subsequent function calls
     useMe();
 
-    if(unifDepthMVP != -1) {
-    // Pass a 4x4 matrix into a uniform variable in our shader
-                    // Handle to the matrix variable on the GPU
-    context->glUniformMatrix4fv(unifDepthMVP,
-                    // How many matrices to pass
-                       1,
-                    // Transpose the matrix? OpenGL uses column-major, so no.
-                       GL_FALSE,
-                    // Pointer to the first element of the matrix
-                       &mvp[0][0]);
+    if(unifShadowMap != -1)
+    {
+        context->glUniform1i(unifShadowMap, /*GL_TEXTURE*/textureSlot);
     }
 }
 
-void SurfaceShader::setShadowMapDepthTexture(int textureSlot)
+void SurfaceShader::setNearBounds(const glm::vec4 &bounds)
 {
     useMe();
 
-    if(unifShadowMap != -1)
-    {
-        context->glUniform1i(unifShadowMap, /*GL_TEXTURE*/textureSlot);
+    if(unifNearBounds != -1) {
+        context->glUniform4fv(unifNearBounds, 1, &bounds[0]);
+    }
+}
+
+void SurfaceShader::setFarFade(float bandWidth, float distance)
+{
+    useMe();
+
+    if(unifFarFade != -1) {
+        context->glUniform2f(unifFarFade, bandWidth, distance);
     }
 }
@@ -2,6 +2,8 @@
 
 #include "shaderprogram.h"
 
+#include <vector>
+
 class SurfaceShader : public ShaderProgram
 {
 public:
@@ -14,13 +16,12 @@ public:
 
     int unifModel; // A handle for the "uniform" mat4 representing model matrix in the vertex shader
     int unifModelInvTr; // A handle for the "uniform" mat4 representing inverse transpose of the model matrix in the vertex shader
-    int unifViewProj; // A handle for the "uniform" mat4 representing the view matrix in the vertex shader
     int unifColor; // A handle for the "uniform" vec4 representing color of geometry in the vertex shader
-    int unifCamera; // A handle for the "uniform" vec3 representing the camera's position in world space
 
-    int unifDepthMVP; // A handle for the "uniform" mat4 representing the depth MVP used in shadow mapping
-    int unifDepthBiasMVP; // A handle for the "uniform" mat4 representing the depth bias MVP used in shadow mapping
-    int unifShadowMap; // A handle for the "uniform" sampler2D texture we get out from the shadowMapFBO
+    int unifCascade; // A handle for the "uniform" int choosing the shadow cascade the shadow map pass renders
+    int unifShadowMap; // A handle for the "uniform" sampler2DArray texture we get out from the shadowMapFBO
+    int unifNearBounds; // A handle for the "uniform" vec4 holding the xz bounds of the loaded Chunks, for the far terrain
+    int unifFarFade; // A handle for the "uniform" vec2 holding the far terrain's fade-in band and fade-out distance
 
 public:
     SurfaceShader(OpenGLContext* context);
@@ -38,14 +39,14 @@ public:
     void drawInstanced(InstancedDrawable &d);
     // Pass the given model matrix to this shader on the GPU
     void setModelMatrix(const glm::mat4 &model);
-    // Pass the given Projection * View matrix to this shader on the GPU
-    void setViewProjMatrix(const glm::mat4 &vp);
     // Pass the given color to this shader on the GPU
     void setGeometryColor(glm::vec4 color);
-    // Pass the camera's world coordinates to the GPU
-    void setCameraWorldPosition(const glm::vec3 &v);
-    // Pass the depthMVP * depthBiasMVP matrix to the GPU
-    void setDepthMVP(const glm::mat4 &mvp);
-    void setDepthBiasMVP(const glm::mat4 &mvp);
+    // Pass the index of the shadow cascade to render into to the GPU.
+    // The cascades' matrices themselves are in FrameUniforms.
+    void setShadowCascade(int cascade);
     void setShadowMapDepthTexture(int textureSlot);
+    // Pass the (min x, min z, max x, max z) bounds of the loaded Chunks to the GPU
+    void setNearBounds(const glm::vec4 &bounds);
+    // Pass the width of the far terrain's fade-in band, and the distance it fades out by, to the GPU
+    void setFarFade(float bandWidth, float distance);
 };
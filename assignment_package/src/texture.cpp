@@ -1,9 +1,11 @@
 #include "texture.h"
 #include <QImage>
 #include <QOpenGLWidget>
+#include <algorithm>
+#include <stdexcept>
 
 Texture::Texture(OpenGLContext *context)
-    : context(context), m_textureHandle(-1), m_textureImage(nullptr)
+    : context(context), m_textureHandle(-1), m_textureImage(nullptr), m_texturePath()
 {}
 
 Texture::~Texture()
@@ -17,6 +19,7 @@ void Texture::create(const char *texturePath)
     img = img.convertToFormat(QImage::Format_ARGB32);
     img = img.mirrored();
     m_textureImage = std::make_shared<QImage>(img);
+    m_texturePath = texturePath;
     context->glGenTextures(1, &m_textureHandle);
 
     context->printGLErrorLog();
@@ -28,6 +31,8 @@ void Texture::load(int texSlot = 0)
 
     context->glActiveTexture(GL_TEXTURE0 + texSlot);
     context->glBindTexture(GL_TEXTURE_2D, m_textureHandle);
+    // Only now that it is bound does the texture exist to be labelled
+    context->labelObject(GL_TEXTURE, m_textureHandle, m_texturePath);
 
     // These parameters need to be set for EVERY texture you create
     // They don't always have to be set to the values given here, but they do need
@@ -49,3 +54,125 @@ void Texture::bind(int texSlot = 0)
     context->glActiveTexture(GL_TEXTURE0);
     context->glBindTexture(GL_TEXTURE_2D, m_textureHandle);
 }
+
+TextureArray::TextureArray(OpenGLContext *context)
+    : context(context), m_textureHandle(0), m_tileSize(0), m_layerCount(0), m_levels()
+{}
+
+TextureArray::~TextureArray()
+{}
+
+void TextureArray::create(const char *atlasPath, int tilesPerRow)
+{
+    QImage img(atlasPath);
+    if (img.isNull()) {
+        throw std::runtime_error(std::string("TextureArray::create: could not load ") + atlasPath);
+    }
+    img = img.convertToFormat(QImage::Format_ARGB32);
+    // Flipped so the first scanline is the bottom one, as in Texture
+    img = img.mirrored();
+
+    m_tileSize = img.width() / tilesPerRow;
+    m_layerCount = tilesPerRow * (img.height() / m_tileSize);
+    int tilePixels = m_tileSize * m_tileSize;
+
+    std::vector<uint32_t> base(m_layerCount * tilePixels);
+    for (int layer = 0; layer < m_layerCount; layer++) {
+        int column = layer % tilesPerRow, row = layer / tilesPerRow;
+        for (int y = 0; y < m_tileSize; y++) {
+            const uint32_t *line = reinterpret_cast<const uint32_t*>(img.constScanLine(row * m_tileSize + y));
+            std::copy(line + column * m_tileSize, line + (column + 1) * m_tileSize,
+                      base.begin() + layer * tilePixels + y * m_tileSize);
+        }
+    }
+
+    m_levels.clear();
+    m_levels.push_back(std::move(base));
+    for (int size = m_tileSize; size > 1; size /= 2) {
+        m_levels.push_back(downsample(m_levels.back(), size, m_layerCount));
+    }
+    context->glGenTextures(1, &m_textureHandle);
+}
+
+std::vector<uint32_t> TextureArray::downsample(const std::vector<uint32_t> &level, int size, int layers)
+{
+    int half = std::max(size / 2, 1);
+    std::vector<uint32_t> next(layers * half * half);
+    for (int layer = 0; layer < layers; layer++) {
+        const uint32_t *src = level.data() + layer * size * size;
+        uint32_t *dst = next.data() + layer * half * half;
+        for (int y = 0; y < half; y++) {
+            for (int x = 0; x < half; x++) {
+                // Colours are weighted by alpha, so the clear texels around
+                // leaves and the like don't darken their edges
+                uint32_t alpha = 0, red = 0, green = 0, blue = 0, plain[3] = {0, 0, 0};
+                for (int i = 0; i < 4; i++) {
+                    uint32_t p = src[std::min(2 * y + i / 2, size - 1) * size + std::min(2 * x + i % 2, size - 1)];
+                    uint32_t a = p >> 24, r = (p >> 16) & 0xff, g = (p >> 8) & 0xff, b = p & 0xff;
+                    alpha += a;
+                    red += r * a;
+                    green += g * a;
+                    blue += b * a;
+                    plain[0] += r;
+                    plain[1] += g;
+                    plain[2] += b;
+                }
+                uint32_t r, g, b;
+                if (alpha > 0) {
+                    r = red / alpha;
+                    g = green / alpha;
+                    b = blue / alpha;
+                } else {
+                    r = plain[0] / 4;
+                    g = plain[1] / 4;
+                    b = plain[2] / 4;
+                }
+                dst[y * half + x] = ((alpha / 4) << 24) | (r << 16) | (g << 8) | b;
+            }
+        }
+    }
+    return next;
+}
+
+void TextureArray::load(int texSlot)
+{
+    context->glActiveTexture(GL_TEXTURE0 + texSlot);
+    context->glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureHandle);
+    context->labelObject(GL_TEXTURE, m_textureHandle, "Block texture array");
+
+    // Blocks stay crisp up close and filter smoothly between mips far away.
+    // Repeating lets a mesh stretch one tile across several blocks.
+    context->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    context->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+    context->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    context->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    context->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+    context->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, m_levels.size() - 1);
+
+    for (unsigned int level = 0; level < m_levels.size(); level++) {
+        int size = std::max(m_tileSize >> level, 1);
+        context->glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size, size, m_layerCount,
+                              0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, m_levels[level].data());
+    }
+    context->printGLErrorLog();
+
+    // The GPU has its own copy now
+    m_levels.clear();
+}
+
+void TextureArray::bind(int texSlot)
+{
+    context->glActiveTexture(GL_TEXTURE0 + texSlot);
+    context->glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureHandle);
+}
+
+void TextureArray::destroy()
+{
+    context->glDeleteTextures(1, &m_textureHandle);
+    m_textureHandle = 0;
+}
+
+int TextureArray::getLayerCount() const
+{
+    return m_layerCount;
+}
@@ -2,6 +2,7 @@
 
 #include <openglcontext.h>
 #include <memory>
+#include <vector>
 
 class Texture
 {
@@ -17,4 +18,38 @@ private:
     OpenGLContext* context;
     GLuint m_textureHandle;
     std::shared_ptr<QImage> m_textureImage;
+    QString m_texturePath; // Names the texture in GL debug output
+};
+
+// An atlas of equally sized tiles, such as the block textures, sliced
+// into the layers of a GL_TEXTURE_2D_ARRAY. Tile (column, row), counted
+// from the atlas's lower-left corner, becomes layer column + row *
+// tilesPerRow. Each layer gets a full mip chain, built on the CPU with
+// a box filter. Distant surfaces then sample a small mip instead of the
+// whole atlas, and no filter ever bleeds into a neighbouring tile.
+class TextureArray
+{
+public:
+    TextureArray(OpenGLContext* context);
+    ~TextureArray();
+
+    // Loads the atlas image and builds every layer's mip chain.
+    void create(const char *atlasPath, int tilesPerRow);
+    // Uploads the layers to the GPU, leaving the array bound to texSlot.
+    void load(int texSlot);
+    void bind(int texSlot);
+    void destroy();
+
+    int getLayerCount() const;
+
+private:
+    OpenGLContext* context;
+    GLuint m_textureHandle;
+    int m_tileSize;
+    int m_layerCount;
+    // One entry per mip level: every layer's pixels in turn, as ARGB32
+    std::vector<std::vector<uint32_t>> m_levels;
+
+    // Halves a level of m_levels into the next
+    static std::vector<uint32_t> downsample(const std::vector<uint32_t> &level, int size, int layers);
 };
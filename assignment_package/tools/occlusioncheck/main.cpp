@@ -0,0 +1,88 @@
+#include "scene/occlusionbuffer.h"
+#include "scene/occlusionworker.h"
+
+#include <cstdio>
+#include <vector>
+
+// Hand-built scenes with an obvious answer, seen from a camera at the
+// origin looking down -Z with the game's field of view and aspect ratio.
+
+static int failures = 0;
+
+static void check(bool passed, const char *what) {
+    std::printf("%s  %s\n", passed ? "pass" : "FAIL", what);
+    failures += !passed;
+}
+
+static glm::mat4 cameraViewProj() {
+    glm::mat4 proj = glm::perspective(glm::radians(45.f), 2.f, 0.1f, 1000.f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f));
+    return proj * view;
+}
+
+int main() {
+    glm::mat4 viewProj = cameraViewProj();
+    // A wall 16 blocks away, far wider than the view at that distance
+    std::vector<OccluderBox> wall = {OccluderBox(glm::vec3(-64.f, -32.f, -17.f), glm::vec3(64.f, 32.f, -16.f))};
+    // A wall that only covers the left half of the view
+    std::vector<OccluderBox> leftWall = {OccluderBox(glm::vec3(-64.f, -32.f, -17.f), glm::vec3(-2.f, 32.f, -16.f))};
+
+    OcclusionBuffer buffer;
+    buffer.rasterize(viewProj, {});
+    check(buffer.isVisible(glm::vec3(-1.f, -1.f, -40.f), glm::vec3(1.f, 1.f, -38.f)),
+          "with no occluders, a box ahead is visible");
+
+    buffer.rasterize(viewProj, wall);
+    check(!buffer.isVisible(glm::vec3(-1.f, -1.f, -40.f), glm::vec3(1.f, 1.f, -38.f)),
+          "a box behind the wall is hidden");
+    check(buffer.isVisible(glm::vec3(-1.f, -1.f, -10.f), glm::vec3(1.f, 1.f, -8.f)),
+          "a box in front of the wall is visible");
+    check(buffer.isVisible(glm::vec3(-1.f, -1.f, -20.f), glm::vec3(1.f, 1.f, -15.f)),
+          "a box reaching through the wall is visible");
+    check(buffer.isVisible(glm::vec3(-1.f, -1.f, -40.f), glm::vec3(1.f, 1.f, 1.f)),
+          "a box reaching past the near plane is visible");
+
+    buffer.rasterize(viewProj, leftWall);
+    check(!buffer.isVisible(glm::vec3(-12.f, -1.f, -40.f), glm::vec3(-10.f, 1.f, -38.f)),
+          "a box behind the half wall is hidden");
+    check(buffer.isVisible(glm::vec3(10.f, -1.f, -40.f), glm::vec3(12.f, 1.f, -38.f)),
+          "a box beside the half wall is visible");
+    check(buffer.isVisible(glm::vec3(-4.f, -1.f, -40.f), glm::vec3(4.f, 1.f, -38.f)),
+          "a box only partly behind the half wall is visible");
+
+    // At 16 blocks a pixel is about 0.1 blocks wide, and the centre of
+    // the view is a pixel's left edge. The gap between these walls lies
+    // within one pixel and misses its centre, which the right wall covers.
+    std::vector<OccluderBox> gappedWall = {
+        OccluderBox(glm::vec3(-64.f, -32.f, -17.f), glm::vec3(0.01f, 32.f, -16.f)),
+        OccluderBox(glm::vec3(0.05f, -32.f, -17.f), glm::vec3(64.f, 32.f, -16.f))
+    };
+    buffer.rasterize(viewProj, gappedWall);
+    check(buffer.isVisible(glm::vec3(0.05f, -1.f, -40.f), glm::vec3(0.09f, 1.f, -38.f)),
+          "a box seen through a gap narrower than a pixel is visible");
+    check(!buffer.isVisible(glm::vec3(-12.f, -1.f, -40.f), glm::vec3(-10.f, 1.f, -38.f)),
+          "a box behind one of the gapped walls is hidden");
+
+    // Seen from above and to the side, so three faces show; the edges
+    // between them must not let anything through
+    glm::mat4 obliqueViewProj = glm::perspective(glm::radians(45.f), 2.f, 0.1f, 1000.f) *
+        glm::lookAt(glm::vec3(20.f, 20.f, 20.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+    buffer.rasterize(obliqueViewProj, {OccluderBox(glm::vec3(-4.f), glm::vec3(4.f))});
+    // Straight behind the corner nearest the camera, where all three meet
+    check(!buffer.isVisible(glm::vec3(-0.5f), glm::vec3(0.5f)),
+          "a box behind the corner of a cube is hidden");
+
+    // The worker must leave the buffer as rasterize() would, job after job
+    OcclusionBuffer threaded;
+    {
+        OcclusionWorker worker(threaded);
+        worker.start(viewProj, leftWall);
+        worker.start(viewProj, wall);
+        worker.wait();
+    }
+    check(!threaded.isVisible(glm::vec3(10.f, -1.f, -40.f), glm::vec3(12.f, 1.f, -38.f)),
+          "the worker's buffer holds its last job");
+
+    std::printf("%d check(s) failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,28 @@
+# Checks OcclusionBuffer (and the OcclusionWorker that fills it) against
+# a few hand-built scenes, on the CPU alone. Needs no window, no GL
+# context and no GPU. Exits with a non-zero status if any check fails.
+#
+#   qmake occlusioncheck.pro && make
+#   ./OcclusionCheck
+
+TARGET = OcclusionCheck
+TEMPLATE = app
+QT -= core gui
+CONFIG += console
+CONFIG -= app_bundle qt
+CONFIG += c++1z
+CONFIG += warn_on
+CONFIG += thread
+
+SRC = $$PWD/../../src
+
+INCLUDEPATH += $$PWD/../../include $$SRC $$SRC/scene
+
+SOURCES += \
+    $$PWD/main.cpp \
+    $$SRC/scene/occlusionbuffer.cpp \
+    $$SRC/scene/occlusionworker.cpp
+
+HEADERS += \
+    $$SRC/scene/occlusionbuffer.h \
+    $$SRC/scene/occlusionworker.h
@@ -0,0 +1,343 @@
+#include "scene/terrain.h"
+#include "scene/regionfile.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX    // Or windows.h breaks std::min and std::max
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Headless pregeneration of a square area of the world.
+//
+// The area is processed one region (RegionFile::REGION_SIZE^2 Chunks) at a
+// time. Each region is generated together with a one-Chunk ring around it,
+// so that structures reaching in from outside and the mesher's neighbour
+// lookups see the same blocks they would in-game. The ring is thrown away
+// with the rest of the region once its file is written, so memory stays
+// bounded no matter how large the area is. Regions whose file already
+// exists are skipped, which makes an interrupted run resumable.
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    QString outDir = "world";
+    int originX = -2048;
+    int originZ = -2048;
+    int size = 4096;
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    bool mesh = false;
+    bool checkClimate = false;
+};
+
+struct StageTimes {
+    double generate = 0;    // summed over threads
+    double structures = 0;
+    double mesh = 0;        // summed over threads
+    double write = 0;
+};
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static long peakRssKiB() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // Bytes on macOS
+#else
+    return usage.ru_maxrss;         // KiB on Linux
+#endif
+#endif
+}
+
+static void printUsage(const char *exe) {
+    std::printf("Usage: %s [--out DIR] [--origin X Z] [--size BLOCKS] [--threads N] [--mesh] [--check-climate]\n"
+                "  --out DIR         output directory for region files (default: world)\n"
+                "  --origin X Z      lower-left corner of the area in blocks (default: -2048 -2048)\n"
+                "  --size BLOCKS     side length of the area in blocks (default: 4096)\n"
+                "  --threads N       worker threads (default: all cores)\n"
+                "  --mesh            also build and store Chunk meshes\n"
+                "  --check-climate   write nothing; time and compare the climate grid over the area\n"
+                "The area is rounded outwards to whole regions of %d x %d blocks.\n",
+                exe, RegionFile::REGION_SIZE * 16, RegionFile::REGION_SIZE * 16);
+}
+
+static bool parseOptions(int argc, char *argv[], Options &opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--out" && hasValue) {
+            opt.outDir = argv[++i];
+        } else if (arg == "--origin" && i + 2 < argc) {
+            opt.originX = std::atoi(argv[++i]);
+            opt.originZ = std::atoi(argv[++i]);
+        } else if (arg == "--size" && hasValue) {
+            opt.size = std::atoi(argv[++i]);
+        } else if (arg == "--threads" && hasValue) {
+            opt.threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--mesh") {
+            opt.mesh = true;
+        } else if (arg == "--check-climate") {
+            opt.checkClimate = true;
+        } else {
+            return false;
+        }
+    }
+    return opt.size > 0;
+}
+
+/* Runs work(i) for every i in [0, count) across the given number of threads
+   and returns the summed per-thread busy time in seconds. */
+static double parallelFor(size_t count, unsigned int threads, const std::function<void(size_t)> &work) {
+    std::atomic<size_t> next(0);
+    std::vector<double> busy(threads, 0.0);
+    std::vector<std::thread> pool;
+    for (unsigned int t = 0; t < threads; t++) {
+        pool.push_back(std::thread([&, t]() {
+            Clock::time_point start = Clock::now();
+            for (size_t i = next++; i < count; i = next++) {
+                work(i);
+            }
+            busy[t] = secondsSince(start);
+        }));
+    }
+    double total = 0;
+    for (unsigned int t = 0; t < threads; t++) {
+        pool[t].join();
+        total += busy[t];
+    }
+    return total;
+}
+
+static int floorDiv(int a, int b) {
+    return static_cast<int>(std::floor(a / static_cast<float>(b)));
+}
+
+/* Times generateChunkTerrain()'s climate grid against sampling the
+   climate and evaluating all four biome heights for every column, as it
+   did before the grid, on one thread. Then counts the columns whose
+   surface height or biome the grid changes, relative to the exact
+   per-column climate. */
+static int checkClimate(const Terrain &terrain, const Options &opt) {
+    int x0 = floorDiv(opt.originX, 16) * 16;
+    int z0 = floorDiv(opt.originZ, 16) * 16;
+    int side = (opt.originX + opt.size - x0 + 15) / 16;
+    double perColumnTime = 0, gridTime = 0;
+    long columns = 0, heightsChanged = 0, biomesChanged = 0;
+    int maxDelta = 0;
+    volatile float sink = 0;    // Keeps the per-column heights from being optimised out
+
+    for (int cx = 0; cx < side; cx++) {
+        for (int cz = 0; cz < side; cz++) {
+            int xFloor = x0 + 16 * cx, zFloor = z0 + 16 * cz;
+
+            Clock::time_point start = Clock::now();
+            for (int x = xFloor; x < xFloor + 16; x++) {
+                for (int z = zFloor; z < zFloor + 16; z++) {
+                    float temp = terrain.interpolateTemperature(x, z);
+                    float humidity = terrain.interpolateHumidity(x, z);
+                    float low = glm::mix(float(terrain.procMountainHt(x, z)), float(terrain.procGrasslandHt(x, z)), humidity);
+                    float high = glm::mix(float(terrain.procDesertHt(x, z)), float(terrain.procIslandHt(x, z)), humidity);
+                    sink = sink + glm::mix(low, high, temp);
+                }
+            }
+            perColumnTime += secondsSince(start);
+
+            std::array<glm::vec2, 256> weights;
+            std::array<int, 256> heights;
+            start = Clock::now();
+            Terrain::ClimateGrid grid = terrain.sampleClimate(xFloor, zFloor);
+            for (int dx = 0; dx < 16; dx++) {
+                for (int dz = 0; dz < 16; dz++) {
+                    glm::vec2 w = Terrain::gridClimate(grid, dx, dz);
+                    weights[dx + 16 * dz] = w;
+                    heights[dx + 16 * dz] = terrain.blendedHeight(xFloor + dx, zFloor + dz, w.x, w.y);
+                }
+            }
+            gridTime += secondsSince(start);
+
+            for (int dx = 0; dx < 16; dx++) {
+                for (int dz = 0; dz < 16; dz++) {
+                    glm::vec2 exact;
+                    int height = terrain.surfaceHeightAt(xFloor + dx, zFloor + dz, exact);
+                    glm::vec2 w = weights[dx + 16 * dz];
+                    int delta = std::abs(height - heights[dx + 16 * dz]);
+                    heightsChanged += delta != 0;
+                    maxDelta = std::max(maxDelta, delta);
+                    biomesChanged += (exact.x < 0.5f) != (w.x < 0.5f) || (exact.y < 0.5f) != (w.y < 0.5f);
+                    columns++;
+                }
+            }
+        }
+    }
+
+    std::printf("Climate check over %d x %d Chunks from (%d, %d), one thread\n", side, side, x0, z0);
+    std::printf("  per column:  %.2f us/column (climate noise and all four biome heights)\n",
+                1e6 * perColumnTime / columns);
+    std::printf("  grid:        %.2f us/column\n", 1e6 * gridTime / columns);
+    std::printf("  surface height differs in %.2f%% of columns, by at most %d blocks\n",
+                100.0 * heightsChanged / columns, maxDelta);
+    std::printf("  biome differs in %.2f%% of columns\n", 100.0 * biomesChanged / columns);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (opt.checkClimate) {
+        Terrain terrain(nullptr, false);
+        return checkClimate(terrain, opt);
+    }
+
+    QDir out(opt.outDir);
+    if (!out.mkpath(".")) {
+        std::fprintf(stderr, "Could not create output directory %s\n", opt.outDir.toLocal8Bit().constData());
+        return 1;
+    }
+
+    const int regionBlocks = RegionFile::REGION_SIZE * 16;
+    int rxMin = floorDiv(opt.originX, regionBlocks);
+    int rzMin = floorDiv(opt.originZ, regionBlocks);
+    int rxMax = floorDiv(opt.originX + opt.size - 1, regionBlocks);
+    int rzMax = floorDiv(opt.originZ + opt.size - 1, regionBlocks);
+    int regionCount = (rxMax - rxMin + 1) * (rzMax - rzMin + 1);
+
+    std::printf("Pregenerating %d regions (%d x %d blocks) into %s with %u threads%s\n",
+                regionCount, (rxMax - rxMin + 1) * regionBlocks, (rzMax - rzMin + 1) * regionBlocks,
+                opt.outDir.toLocal8Bit().constData(), opt.threads, opt.mesh ? ", meshing" : "");
+
+    // No GL context and no built-in workers; this tool drives generation itself.
+    Terrain terrain(nullptr, false);
+
+    StageTimes times;
+    long chunksDone = 0, chunksGenerated = 0;
+    int regionsDone = 0, regionsSkipped = 0;
+    Clock::time_point runStart = Clock::now();
+
+    for (int rz = rzMin; rz <= rzMax; rz++) {
+        for (int rx = rxMin; rx <= rxMax; rx++) {
+            QString path = out.filePath(RegionFile::fileName(rx, rz));
+            if (QFile::exists(path)) {
+                regionsSkipped++;
+                continue;
+            }
+
+            // The region plus a one-Chunk ring, in Chunk-corner world coords.
+            int x0 = rx * regionBlocks - 16, z0 = rz * regionBlocks - 16;
+            int side = RegionFile::REGION_SIZE + 2;
+            std::vector<Chunk*> all;
+            std::vector<Chunk*> interior;
+            for (int i = 0; i < side; i++) {
+                for (int j = 0; j < side; j++) {
+                    Chunk *c = terrain.instantiateChunkAt(x0 + 16 * i, z0 + 16 * j);
+                    all.push_back(c);
+                    if (i > 0 && j > 0 && i < side - 1 && j < side - 1) {
+                        interior.push_back(c);
+                    }
+                }
+            }
+
+            times.generate += parallelFor(all.size(), opt.threads, [&](size_t i) {
+                glm::vec2 pos = all[i]->getChunkPos();
+                terrain.generateChunkTerrain(pos.x, pos.y);
+            });
+
+            Clock::time_point start = Clock::now();
+            for (Chunk *c : all) {
+                c->hasBlockData();
+            }
+            terrain.applyQueuedStructures(all);
+            times.structures += secondsSince(start);
+
+            // Meshes are large, so they are built and written in batches
+            // rather than held for the whole region.
+            RegionFile file(path, rx, rz, interior.size(), opt.mesh);
+            bool written = file.open();
+            size_t batch = opt.mesh ? 4 * opt.threads : interior.size();
+            for (size_t first = 0; written && first < interior.size(); first += batch) {
+                size_t count = std::min(batch, interior.size() - first);
+                std::vector<ChunkVBOData> meshes;
+                if (opt.mesh) {
+                    meshes.resize(count, ChunkVBOData(nullptr));
+                    times.mesh += parallelFor(count, opt.threads, [&](size_t i) {
+                        meshes[i] = terrain.createChunkVBOData(interior[first + i]);
+                    });
+                }
+                start = Clock::now();
+                for (size_t i = 0; written && i < count; i++) {
+                    written = file.writeChunk(interior[first + i], opt.mesh ? &meshes[i] : nullptr);
+                }
+                times.write += secondsSince(start);
+            }
+            start = Clock::now();
+            written = written && file.commit();
+            times.write += secondsSince(start);
+            if (!written) {
+                std::fprintf(stderr, "Failed to write %s\n", path.toLocal8Bit().constData());
+                return 1;
+            }
+
+            for (Chunk *c : all) {
+                glm::vec2 pos = c->getChunkPos();
+                terrain.releaseChunkAt(pos.x, pos.y);
+            }
+            terrain.discardQueuedStructures();
+
+            chunksDone += interior.size();
+            chunksGenerated += all.size();
+            regionsDone++;
+            double elapsed = secondsSince(runStart);
+            std::printf("[%d/%d] region (%d, %d): %.1f chunks/s, peak RSS %ld MiB\n",
+                        regionsDone + regionsSkipped, regionCount, rx, rz,
+                        chunksDone / elapsed, peakRssKiB() / 1024);
+            std::fflush(stdout);
+        }
+    }
+
+    double elapsed = secondsSince(runStart);
+    std::printf("\nDone: %ld chunks in %d regions (%d already present) in %.1f s\n",
+                chunksDone, regionsDone, regionsSkipped, elapsed);
+    if (chunksDone > 0) {
+        std::printf("  throughput:  %.1f chunks/s\n", chunksDone / elapsed);
+        std::printf("  generate:    %.1f thread-s (%.2f ms/chunk incl. ring)\n",
+                    times.generate, 1000 * times.generate / chunksGenerated);
+        std::printf("  structures:  %.1f s\n", times.structures);
+        if (opt.mesh) {
+            std::printf("  mesh:        %.1f thread-s (%.2f ms/chunk)\n",
+                        times.mesh, 1000 * times.mesh / chunksDone);
+        }
+        std::printf("  write:       %.1f s\n", times.write);
+    }
+    std::printf("  peak RSS:    %ld MiB\n", peakRssKiB() / 1024);
+    return 0;
+}
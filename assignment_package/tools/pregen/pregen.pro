@@ -0,0 +1,71 @@
+# Headless world pregeneration tool. Drives Terrain generation (and,
+# optionally, meshing) over a fixed area without opening a window, and
+# writes the result as region files (see src/scene/regionfile.h).
+#
+#   qmake pregen.pro && make
+#   ./MiniMinecraftPregen --out world --size 4096 --mesh
+
+# Chunk is a Drawable, so the OpenGL wrappers still have to link,
+# even though no context is ever created.
+QT += core widgets opengl openglwidgets
+
+TARGET = MiniMinecraftPregen
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG += c++1z
+CONFIG += warn_on
+CONFIG += release
+
+SRC = $$PWD/../../src
+
+INCLUDEPATH += $$PWD/../../include $$SRC $$SRC/scene
+
+SOURCES += \
+    $$PWD/main.cpp \
+    $$SRC/chunkvbodata.cpp \
+    $$SRC/drawable.cpp \
+    $$SRC/freelistallocator.cpp \
+    $$SRC/gputimer.cpp \
+    $$SRC/mesharena.cpp \
+    $$SRC/meshresidency.cpp \
+    $$SRC/renderqueue.cpp \
+    $$SRC/openglcontext.cpp \
+    $$SRC/perlinnoise.cpp \
+    $$SRC/proceduralterrainhelp.cpp \
+    $$SRC/programcache.cpp \
+    $$SRC/shaderprogram.cpp \
+    $$SRC/surfaceshader.cpp \
+    $$SRC/scene/chunk.cpp \
+    $$SRC/scene/frustum.cpp \
+    $$SRC/scene/occlusionbuffer.cpp \
+    $$SRC/scene/sectionconnectivity.cpp \
+    $$SRC/scene/regionfile.cpp \
+    $$SRC/scene/structurequeue.cpp \
+    $$SRC/scene/structurestamps.cpp \
+    $$SRC/scene/terrain.cpp \
+    $$SRC/scene/voxelstamp.cpp
+
+HEADERS += \
+    $$SRC/chunkvbodata.h \
+    $$SRC/drawable.h \
+    $$SRC/freelistallocator.h \
+    $$SRC/gputimer.h \
+    $$SRC/mesharena.h \
+    $$SRC/meshresidency.h \
+    $$SRC/renderqueue.h \
+    $$SRC/openglcontext.h \
+    $$SRC/programcache.h \
+    $$SRC/scene/chunk.h \
+    $$SRC/scene/frustum.h \
+    $$SRC/scene/occlusionbuffer.h \
+    $$SRC/scene/sectionconnectivity.h \
+    $$SRC/scene/regionfile.h \
+    $$SRC/scene/structurequeue.h \
+    $$SRC/scene/structurestamps.h \
+    $$SRC/scene/terrain.h \
+    $$SRC/scene/voxelstamp.h
+
+win32 {
+    LIBS += -lopengl32 -lpsapi
+}
@@ -0,0 +1,173 @@
+#include "frameuniforms.h"
+#include "mesharena.h"
+#include "openglcontext.h"
+#include "renderqueue.h"
+#include "surfaceshader.h"
+
+#include <QApplication>
+#include <QSurfaceFormat>
+#include <QTimer>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Times the CPU cost of submitting a frame of terrain draws, the way
+// Terrain::draw() used to and through the RenderQueue it uses now, on
+// the machine's own driver.
+//
+// Every Chunk is a square grid around the camera, all in view, each with
+// an opaque mesh split into sections and a small transparent one. The
+// meshes are tiny, as only the calls they take are measured, but they
+// are spread over arena pages as the game's are, about 45 Chunks apiece.
+// glFinish() is called before each frame and left out of its time, so
+// the GPU's own work never shows up in the CPU's.
+
+using Clock = std::chrono::steady_clock;
+
+static const int VERTICES = 256;         // Per opaque mesh
+static const int SECTIONS = 13;          // Non-empty sections per opaque mesh
+static const int SECTION_INDICES = 30;   // Per section
+static const int CHUNKS_PER_PAGE = 45;
+
+struct BenchChunk {
+    MeshAllocation opaque, transparent;
+    glm::vec3 origin;
+    float distance;
+};
+
+class SubmitBench : public OpenGLContext {
+private:
+    int m_frames;
+    SurfaceShader m_prog;
+    FrameUniforms m_frameUniforms;
+
+    // The submission from before the RenderQueue: every Chunk's program
+    // bound, its model matrix and that matrix's inverse transpose
+    // uploaded, then its meshes drawn, the transparent ones after the rest
+    int submitWithMatrices(MeshArena &arena, const std::vector<BenchChunk> &chunks,
+                           const std::vector<glm::ivec2> &ranges) {
+        int draws = 0;
+        arena.beginDraws();
+        for (const BenchChunk &chunk : chunks) {
+            m_prog.setModelMatrix(glm::translate(glm::mat4(1.f), chunk.origin));
+            arena.draw(chunk.opaque, ranges.data(), ranges.size());
+            draws++;
+        }
+        for (const BenchChunk &chunk : chunks) {
+            m_prog.setModelMatrix(glm::translate(glm::mat4(1.f), chunk.origin));
+            arena.draw(chunk.transparent);
+            draws++;
+        }
+        arena.endDraws();
+        return draws;
+    }
+
+    int submitWithQueue(MeshArena &arena, RenderQueue &queue, const std::vector<BenchChunk> &chunks,
+                        const std::vector<glm::ivec2> &ranges) {
+        for (const BenchChunk &chunk : chunks) {
+            queue.push(RenderQueue::OPAQUE_PASS, &m_prog, chunk.opaque, chunk.origin, ranges, chunk.distance);
+        }
+        int draws = queue.submit(arena, this);
+        for (const BenchChunk &chunk : chunks) {
+            queue.push(RenderQueue::TRANSPARENT_PASS, &m_prog, chunk.transparent, chunk.origin);
+        }
+        return draws + queue.submit(arena, this);
+    }
+
+    // The median of m_frames frames, in milliseconds
+    template<typename F>
+    double medianMs(F &&submit) {
+        std::vector<double> times;
+        for (int i = 0; i < m_frames; i++) {
+            glFinish();
+            Clock::time_point start = Clock::now();
+            submit();
+            times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+
+    void run(int side) {
+        MeshArena arena(this, CHUNKS_PER_PAGE * VERTICES, CHUNKS_PER_PAGE * SECTIONS * SECTION_INDICES);
+        // Degenerate triangles, so the GPU has next to nothing to do
+        std::vector<glm::vec4> vertices(VERTICES * MeshArena::FLOATS_PER_VERTEX / 4, glm::vec4(0.f));
+        std::vector<GLuint> indices(SECTIONS * SECTION_INDICES, 0);
+        std::vector<GLuint> transparentIndices(SECTION_INDICES, 0);
+        std::vector<glm::ivec2> ranges;
+        for (int s = 0; s < SECTIONS; s++) {
+            ranges.push_back(glm::ivec2(s * SECTION_INDICES, SECTION_INDICES));
+        }
+
+        std::vector<BenchChunk> chunks;
+        for (int x = 0; x < side; x++) {
+            for (int z = 0; z < side; z++) {
+                BenchChunk chunk;
+                chunk.opaque = arena.upload(vertices, indices);
+                chunk.transparent = arena.upload(vertices, transparentIndices);
+                chunk.origin = glm::vec3(16 * (x - side / 2), 0, 16 * (z - side / 2));
+                chunk.distance = glm::length(glm::vec2(chunk.origin.x, chunk.origin.z));
+                chunks.push_back(chunk);
+            }
+        }
+        // Queued in the order Terrain::draw() finds them, not by distance
+        RenderQueue queue;
+
+        int matrixDraws = 0, queueDraws = 0;
+        double matrixMs = medianMs([&]() { matrixDraws = submitWithMatrices(arena, chunks, ranges); });
+        double queueMs = medianMs([&]() { queueDraws = submitWithQueue(arena, queue, chunks, ranges); });
+        std::printf("%5d chunks  %2d pages  matrices %.3f ms (%d draws)  queue %.3f ms (%d draws)\n",
+                    side * side, arena.getPageCount(), matrixMs, matrixDraws, queueMs, queueDraws);
+        arena.destroy();
+    }
+
+public:
+    SubmitBench(int frames)
+        : OpenGLContext(nullptr), m_frames(frames), m_prog(this), m_frameUniforms(this)
+    {}
+
+    void initializeGL() override {
+        initializeOpenGLFunctions();
+        debugContextVersion();
+        glEnable(GL_DEPTH_TEST);
+
+        m_frameUniforms.create();
+        m_frameUniforms.upload();
+        m_prog.create(":/glsl/lambert.vert.glsl", ":/glsl/lambert.frag.glsl");
+
+        std::printf("Median CPU submission time of %d frames:\n", m_frames);
+        for (int side : {20, 40}) {
+            run(side);
+        }
+        m_frameUniforms.destroy();
+        // Once the event loop is running
+        QTimer::singleShot(0, &QApplication::quit);
+    }
+};
+
+int main(int argc, char *argv[]) {
+    QApplication app(argc, argv);
+    int frames = 300;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::max(1, std::atoi(argv[++i]));
+        }
+    }
+
+    // As in the game, see src/main.cpp
+    QSurfaceFormat format;
+    format.setVersion(4, 0);
+    format.setOption(QSurfaceFormat::DeprecatedFunctions, false);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    QSurfaceFormat::setDefaultFormat(format);
+
+    // The context only exists once the widget is shown
+    SubmitBench bench(frames);
+    bench.resize(64, 64);
+    bench.show();
+    return app.exec();
+}
@@ -0,0 +1,52 @@
+# Times the CPU cost of submitting 400 and 1600 Chunks' worth of terrain
+# draws, with a model matrix per Chunk as before and through the
+# RenderQueue. Opens a small window for its GL context, prints the median
+# of each and exits.
+#
+#   qmake submitbench.pro && make
+#   ./SubmitBench --frames 300
+
+QT += core widgets opengl openglwidgets
+
+TARGET = SubmitBench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG += c++1z
+CONFIG += warn_on
+CONFIG += release
+
+SRC = $$PWD/../../src
+
+INCLUDEPATH += $$PWD/../../include $$SRC $$SRC/scene
+
+RESOURCES += $$PWD/../../glsl.qrc
+
+SOURCES += \
+    $$PWD/main.cpp \
+    $$SRC/drawable.cpp \
+    $$SRC/frameuniforms.cpp \
+    $$SRC/freelistallocator.cpp \
+    $$SRC/gputimer.cpp \
+    $$SRC/mesharena.cpp \
+    $$SRC/openglcontext.cpp \
+    $$SRC/programcache.cpp \
+    $$SRC/renderqueue.cpp \
+    $$SRC/shaderprogram.cpp \
+    $$SRC/surfaceshader.cpp
+
+HEADERS += \
+    $$SRC/drawable.h \
+    $$SRC/frameuniforms.h \
+    $$SRC/freelistallocator.h \
+    $$SRC/gputimer.h \
+    $$SRC/mesharena.h \
+    $$SRC/openglcontext.h \
+    $$SRC/programcache.h \
+    $$SRC/renderqueue.h \
+    $$SRC/shaderprogram.h \
+    $$SRC/surfaceshader.h
+
+win32 {
+    LIBS += -lopengl32
+}